@@ -0,0 +1,363 @@
+/**
+ * @file bench_converter.c
+ * @brief File converter throughput benchmark
+ * @author Jaden Mardini
+ *
+ * Generates synthetic text inputs of the requested sizes (mixed-case
+ * words, trailing blanks and CRLF line ends from a fixed seed, so every
+ * run converts the same bytes), then times the converter binary on each
+ * for every transform and I/O mode.  Each case runs several times and
+ * the median is reported as JSON on stdout.
+ */
+
+#define _DEFAULT_SOURCE /* realpath */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MAX_SIZES 16
+#define MAX_REPEAT 99
+#define MAX_ARGS 16
+#define IO_CHUNK ((size_t)1 << 20)
+#define INPUT_NAME "bench_input.txt"
+#define OUTPUT_NAME "bench_output.txt"
+
+typedef struct {
+    const char* name;
+    const char* args[4];                /* Transform options, NULL-terminated */
+} BenchTransform;
+
+static const BenchTransform TRANSFORMS[] = {
+    { "lowercase", { "-l", NULL } },
+    { "uppercase", { "-u", NULL } },
+    { "capitalize", { "-C", NULL } },
+    { "copy", { "-c", NULL } },
+    { "chain_crlf_trim_upper", { "-n", "-t", "-u", NULL } },
+};
+
+typedef enum {
+    MODE_FILE,                          /* File to file on one thread */
+    MODE_PARALLEL,                      /* File to file with -j */
+    MODE_PIPE                           /* Through pipes on stdin and stdout */
+} BenchMode;
+
+static const char* const MODE_NAMES[] = { "file", "parallel", "pipe" };
+
+typedef struct {
+    const char* converter;
+    uint64_t sizes[MAX_SIZES];
+    size_t size_count;
+    unsigned int repeat;
+    unsigned int jobs;
+} BenchConfig;
+
+static uint64_t next_random(uint64_t* state) {
+    /* xorshift64 */
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static bool write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes size bytes of reproducible text to path
+ */
+static bool generate_input(const char* path, uint64_t size) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    char* chunk = malloc(IO_CHUNK + 64);
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    bool ok = chunk != NULL;
+    for (uint64_t done = 0; ok && done < size; ) {
+        size_t fill = 0;
+        while (fill < IO_CHUNK) {
+            uint64_t draw = next_random(&state);
+            unsigned int word = 1 + (unsigned int)(draw % 12);
+            for (unsigned int i = 0; i < word; i++) {
+                char letter = (char)('a' + (draw >> (8 + i)) % 26);
+                chunk[fill++] = (draw >> (40 + i)) & 1 ? (char)(letter - ('a' - 'A')) : letter;
+            }
+            switch ((draw >> 56) % 16) {
+                case 0: memcpy(chunk + fill, "  \r\n", 4); fill += 4; break;
+                case 1: memcpy(chunk + fill, "\r\n", 2); fill += 2; break;
+                case 2: chunk[fill++] = '\n'; break;
+                default: chunk[fill++] = ' ';
+            }
+        }
+        size_t length = size - done < IO_CHUNK ? (size_t)(size - done) : IO_CHUNK;
+        ok = write_all(fd, chunk, length);
+        done += length;
+    }
+
+    free(chunk);
+    return close(fd) == 0 && ok;
+}
+
+/* Feeds the input file into a pipe while the converter runs */
+typedef struct {
+    int source_fd;
+    int pipe_fd;
+} Feeder;
+
+static void* feed_pipe(void* arg) {
+    Feeder* feeder = arg;
+    char* chunk = malloc(IO_CHUNK);
+    ssize_t got = 0;
+    while (chunk && (got = read(feeder->source_fd, chunk, IO_CHUNK)) > 0 &&
+           write_all(feeder->pipe_fd, chunk, (size_t)got)) {
+    }
+    free(chunk);
+    close(feeder->pipe_fd);
+    return NULL;
+}
+
+/**
+ * @brief Runs the converter once and returns its wall time, or a negative value
+ */
+static double run_once(const BenchConfig* config, const BenchTransform* transform,
+                       BenchMode mode) {
+    const char* argv[MAX_ARGS];
+    char jobs[16];
+    size_t argc = 0;
+    argv[argc++] = config->converter;
+    for (size_t i = 0; transform->args[i]; i++) {
+        argv[argc++] = transform->args[i];
+    }
+    if (mode == MODE_PARALLEL) {
+        snprintf(jobs, sizeof(jobs), "%u", config->jobs);
+        argv[argc++] = "-j";
+        argv[argc++] = jobs;
+    }
+    argv[argc++] = mode == MODE_PIPE ? "-" : INPUT_NAME;
+    argv[argc++] = mode == MODE_PIPE ? "-" : OUTPUT_NAME;
+    argv[argc] = NULL;
+
+    int in_pipe[2] = { -1, -1 }, out_pipe[2] = { -1, -1 };
+    int source_fd = -1;
+    if (mode == MODE_PIPE) {
+        source_fd = open(INPUT_NAME, O_RDONLY);
+        if (source_fd < 0) return -1;
+        if (pipe(in_pipe) != 0 || pipe(out_pipe) != 0) {
+            if (in_pipe[0] >= 0) close(in_pipe[0]);
+            if (in_pipe[1] >= 0) close(in_pipe[1]);
+            close(source_fd);
+            return -1;
+        }
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t child = fork();
+    if (child == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(mode == MODE_PIPE ? in_pipe[0] : STDIN_FILENO, STDIN_FILENO);
+        dup2(mode == MODE_PIPE ? out_pipe[1] : null_fd, STDOUT_FILENO);
+        if (mode == MODE_PIPE) {
+            close(in_pipe[0]);
+            close(in_pipe[1]);
+            close(out_pipe[0]);
+            close(out_pipe[1]);
+        }
+        execv(config->converter, (char* const*)argv);
+        _exit(127);
+    }
+    if (child < 0) return -1;
+
+    bool ok = true;
+    if (mode == MODE_PIPE) {
+        close(in_pipe[0]);
+        close(out_pipe[1]);
+        Feeder feeder = { source_fd, in_pipe[1] };
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, feed_pipe, &feeder) != 0) {
+            close(in_pipe[1]);
+            ok = false;
+        }
+
+        /* Drain the output as a downstream stage would */
+        char* chunk = malloc(IO_CHUNK);
+        ssize_t got;
+        while (chunk && ((got = read(out_pipe[0], chunk, IO_CHUNK)) > 0 ||
+                         (got < 0 && errno == EINTR))) {
+        }
+        free(chunk);
+        close(out_pipe[0]);
+        if (ok) pthread_join(thread, NULL);
+        close(source_fd);
+    }
+
+    int status;
+    while (waitpid(child, &status, 0) < 0 && errno == EINTR) {
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Times one case and prints its JSON object
+ */
+static bool run_case(const BenchConfig* config, uint64_t size, const BenchTransform* transform,
+                     BenchMode mode, bool first) {
+    double times[MAX_REPEAT];
+    for (unsigned int i = 0; i < config->repeat; i++) {
+        times[i] = run_once(config, transform, mode);
+        if (times[i] < 0) {
+            fprintf(stderr, "Error: %s %s run on %" PRIu64 " bytes failed\n", transform->name,
+                    MODE_NAMES[mode], size);
+            return false;
+        }
+    }
+    qsort(times, config->repeat, sizeof(double), compare_doubles);
+    double median = times[config->repeat / 2];
+    double rate = (double)size / (1 << 20) / median;
+
+    printf("%s    {\"size\": %" PRIu64 ", \"transform\": \"%s\", \"mode\": \"%s\", "
+           "\"threads\": %u, \"seconds\": %.6f, \"min_seconds\": %.6f, \"mb_per_sec\": %.1f}",
+           first ? "" : ",\n", size, transform->name, MODE_NAMES[mode],
+           mode == MODE_PARALLEL ? config->jobs : 1, median, times[0], rate);
+    fflush(stdout);
+    fprintf(stderr, "file_converter %-21s %-8s %11" PRIu64 " bytes %9.1f MB/s\n",
+            transform->name, MODE_NAMES[mode], size, rate);
+    return true;
+}
+
+/**
+ * @brief Parses a comma-separated list of sizes such as 1M,64M,4G
+ */
+static size_t parse_sizes(const char* text, uint64_t* sizes) {
+    size_t count = 0;
+    while (*text != '\0' && count < MAX_SIZES) {
+        char* end;
+        errno = 0;
+        unsigned long long value = strtoull(text, &end, 10);
+        if (errno != 0 || end == text || value == 0) return 0;
+        switch (*end) {
+            case 'K': case 'k': value <<= 10; end++; break;
+            case 'M': case 'm': value <<= 20; end++; break;
+            case 'G': case 'g': value <<= 30; end++; break;
+            default: break;
+        }
+        if (*end != ',' && *end != '\0') return 0;
+        sizes[count++] = value;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return *text == '\0' ? count : 0;
+}
+
+static void show_usage(const char* program_name) {
+    printf("Usage: %s [OPTIONS] <file_converter>\n\n", program_name);
+    printf("Options:\n");
+    printf("  -s, --sizes LIST     Input sizes, K/M/G suffixes (default: 1M,64M,256M)\n");
+    printf("  -r, --repeat N       Timed runs per case, median reported (default: 3)\n");
+    printf("  -j, --jobs N         Threads of the parallel mode (default: online CPUs)\n");
+    printf("  -w, --work-dir DIR   Directory for inputs and outputs (default: a new one in /tmp)\n");
+    printf("  -h, --help           Show this help message\n");
+}
+
+int main(int argc, char* argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    BenchConfig config = { NULL, { 1 << 20, 64 << 20, 256 << 20 }, 3, 3,
+                           cpus > 1 ? (unsigned int)cpus : 2 };
+    const char* work_dir = NULL;
+    char scratch[] = "/tmp/bench_converter.XXXXXX";
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sizes") == 0) && has_value) {
+            config.size_count = parse_sizes(argv[++i], config.sizes);
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--repeat") == 0) &&
+                   has_value) {
+            long repeat = strtol(argv[++i], NULL, 10);
+            config.repeat = repeat >= 1 && repeat <= MAX_REPEAT ? (unsigned int)repeat : 0;
+        } else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) &&
+                   has_value) {
+            long jobs = strtol(argv[++i], NULL, 10);
+            config.jobs = jobs >= 1 && jobs <= 256 ? (unsigned int)jobs : 0;
+        } else if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--work-dir") == 0) &&
+                   has_value) {
+            work_dir = argv[++i];
+        } else if (argv[i][0] != '-' && !config.converter) {
+            config.converter = argv[i];
+        } else {
+            show_usage(argv[0]);
+            return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0
+                       ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (!config.converter || config.size_count == 0 || config.repeat == 0 ||
+        config.jobs == 0) {
+        show_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* The converter runs from the work directory */
+    char* converter = realpath(config.converter, NULL);
+    if (!converter) {
+        fprintf(stderr, "Error: Cannot find '%s': %s\n", config.converter, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    config.converter = converter;
+    if ((!work_dir && !(work_dir = mkdtemp(scratch))) || chdir(work_dir) != 0) {
+        fprintf(stderr, "Error: Cannot use work directory: %s\n", strerror(errno));
+        free(converter);
+        return EXIT_FAILURE;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("{\n  \"benchmark\": \"file_converter\",\n  \"schema\": 1,\n");
+    printf("  \"cpus\": %ld,\n  \"repeat\": %u,\n  \"cases\": [\n", cpus, config.repeat);
+
+    bool ok = true, first = true;
+    for (size_t s = 0; ok && s < config.size_count; s++) {
+        ok = generate_input(INPUT_NAME, config.sizes[s]);
+        if (!ok) {
+            fprintf(stderr, "Error: Cannot generate %" PRIu64 "-byte input: %s\n",
+                    config.sizes[s], strerror(errno));
+        }
+        for (size_t t = 0; ok && t < sizeof(TRANSFORMS) / sizeof(TRANSFORMS[0]); t++) {
+            for (int mode = MODE_FILE; ok && mode <= MODE_PIPE; mode++) {
+                ok = run_case(&config, config.sizes[s], &TRANSFORMS[t], (BenchMode)mode, first);
+                first = false;
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    unlink(INPUT_NAME);
+    unlink(OUTPUT_NAME);
+    if (work_dir == scratch) rmdir(scratch);
+    free(converter);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
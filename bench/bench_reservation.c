@@ -0,0 +1,325 @@
+/**
+ * @file bench_reservation.c
+ * @brief Reservation engine throughput benchmark
+ * @author Jaden Mardini
+ *
+ * Runs make/cancel/query mixes against one flight for every combination
+ * of seat count, thread count and durability setting, each for a fixed
+ * time, and prints the results as JSON on stdout.  Workers draw seats and
+ * operations from per-thread generators with fixed seeds, so a run is
+ * repeatable up to scheduling.  Durable cases run in a scratch directory
+ * with their own snapshot and journal.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reservation_system.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_FLIGHT 1
+#define MAX_LIST 16
+#define MAX_THREADS 64
+#define CLOCK_CHECK_OPS 16              /* Operations between deadline checks */
+#define PREFILL_BATCH 1024              /* Seats booked per journal record during setup */
+
+/* Operation mix in percent; the rest are queries */
+typedef struct {
+    const char* name;
+    unsigned int make_percent;
+    unsigned int cancel_percent;
+} BenchMix;
+
+static const BenchMix MIXES[] = {
+    { "write_heavy", 50, 40 },
+    { "balanced", 25, 25 },
+    { "read_heavy", 5, 5 },
+};
+
+/* Journal settings of a case; journaled cases load a fresh store first */
+typedef struct {
+    const char* name;
+    bool journaled;
+    ReservationDurability durability;
+} BenchDurability;
+
+static const BenchDurability DURABILITIES[] = {
+    { "memory", false, { 0, 0, 0 } },
+    { "group_256", true, { 256, 0, RESERVATION_DEFAULT_COMPACT_OPS } },
+    { "sync_every_op", true, { 1, 0, RESERVATION_DEFAULT_COMPACT_OPS } },
+};
+
+typedef struct {
+    int seat_counts[MAX_LIST];
+    size_t seat_count_total;
+    unsigned int threads[MAX_LIST];
+    size_t thread_total;
+    unsigned int duration_ms;
+} BenchConfig;
+
+/* One worker of a case */
+typedef struct {
+    ReservationSystem* system;
+    const BenchMix* mix;
+    int seats;
+    uint64_t seed;
+    const struct timespec* deadline;
+    const int* start;                   /* Set once the deadline is known (atomic) */
+    uint64_t ops;
+    uint64_t successes;
+} BenchWorker;
+
+static uint64_t next_random(uint64_t* state) {
+    /* xorshift64 */
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static double seconds_since(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static bool past(const struct timespec* deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > deadline->tv_sec ||
+           (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+static void* bench_worker(void* arg) {
+    BenchWorker* worker = arg;
+    uint64_t state = worker->seed;
+    Reservation reservation;
+
+    while (!__atomic_load_n(worker->start, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+    do {
+        for (int i = 0; i < CLOCK_CHECK_OPS; i++) {
+            uint64_t draw = next_random(&state);
+            int seat = (int)((draw >> 8) % (uint64_t)worker->seats) + 1;
+            unsigned int percent = (unsigned int)(draw % 100);
+            ReservationResult result;
+            if (percent < worker->mix->make_percent) {
+                result = reservation_flight_make(worker->system, BENCH_FLIGHT, seat,
+                                                 "Bench", "Passenger");
+            } else if (percent < worker->mix->make_percent + worker->mix->cancel_percent) {
+                result = reservation_flight_cancel(worker->system, BENCH_FLIGHT, seat);
+            } else {
+                result = reservation_flight_get(worker->system, BENCH_FLIGHT, seat,
+                                                &reservation);
+            }
+            worker->successes += result == RESERVATION_SUCCESS;
+        }
+        worker->ops += CLOCK_CHECK_OPS;
+    } while (!past(worker->deadline));
+    return NULL;
+}
+
+/**
+ * @brief Removes the files a journaled case leaves in the scratch directory
+ */
+static void remove_store(void) {
+    unlink(RESERVATION_FILE);
+    unlink(RESERVATION_JOURNAL_FILE);
+    unlink(RESERVATION_MAP_FILE);
+}
+
+/**
+ * @brief Runs one case and prints its JSON object
+ */
+static bool run_case(const BenchConfig* config, const BenchMix* mix,
+                     const BenchDurability* durability, int seats, unsigned int threads,
+                     bool first) {
+    ReservationSystem* system = reservation_system_create();
+    if (!system) return false;
+
+    bool ok = true;
+    if (durability->journaled) {
+        remove_store();
+        reservation_system_set_durability(system, &durability->durability);
+        ok = reservation_system_load(system) == RESERVATION_SUCCESS;
+    }
+    ok = ok && reservation_flight_add(system, BENCH_FLIGHT, seats) == RESERVATION_SUCCESS;
+
+    /* Half full, so makes and cancels both find work; batches keep setup syncs few */
+    ReservationRequest requests[PREFILL_BATCH];
+    size_t count = 0;
+    for (int seat = 1; ok && seat <= seats; seat += 2) {
+        ReservationRequest request = { seat, "Bench", "Passenger" };
+        requests[count++] = request;
+        if (count == PREFILL_BATCH || seat + 2 > seats) {
+            ok = reservation_flight_make_batch(system, BENCH_FLIGHT, requests, count, NULL) ==
+                 RESERVATION_SUCCESS;
+            count = 0;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Cannot set up %d-seat case\n", seats);
+        reservation_system_destroy(system);
+        return false;
+    }
+
+    BenchWorker workers[MAX_THREADS];
+    pthread_t handles[MAX_THREADS];
+    struct timespec begin, deadline;
+    int start = 0;
+    unsigned int started = 0;
+    for (; started < threads; started++) {
+        BenchWorker worker = { system, mix, seats, 0x9e3779b97f4a7c15ULL * (started + 1),
+                               &deadline, &start, 0, 0 };
+        workers[started] = worker;
+        if (pthread_create(&handles[started], NULL, bench_worker, &workers[started]) != 0) {
+            fprintf(stderr, "Error: Cannot start %u threads\n", threads);
+            ok = false;
+            break;
+        }
+    }
+
+    /* Every worker runs from the same start to the same deadline */
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    deadline.tv_sec = begin.tv_sec + config->duration_ms / 1000;
+    deadline.tv_nsec = begin.tv_nsec + (long)(config->duration_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    __atomic_store_n(&start, 1, __ATOMIC_RELEASE);
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(handles[i], NULL);
+    }
+    double elapsed = seconds_since(&begin);
+
+    if (ok && durability->journaled) {
+        ok = reservation_system_flush(system) == RESERVATION_SUCCESS;
+        elapsed = seconds_since(&begin);
+    }
+    reservation_system_destroy(system);
+    if (durability->journaled) remove_store();
+    if (!ok) return false;
+
+    uint64_t ops = 0, successes = 0;
+    for (unsigned int i = 0; i < threads; i++) {
+        ops += workers[i].ops;
+        successes += workers[i].successes;
+    }
+    printf("%s    {\"mix\": \"%s\", \"durability\": \"%s\", \"seats\": %d, \"threads\": %u, "
+           "\"ops\": %" PRIu64 ", \"successes\": %" PRIu64 ", \"seconds\": %.6f, "
+           "\"ops_per_sec\": %.1f}",
+           first ? "" : ",\n", mix->name, durability->name, seats, threads, ops, successes,
+           elapsed, (double)ops / elapsed);
+    fflush(stdout);
+    fprintf(stderr, "reservation %-11s %-13s seats=%-5d threads=%-2u %12.0f ops/s\n", mix->name,
+            durability->name, seats, threads, (double)ops / elapsed);
+    return true;
+}
+
+/**
+ * @brief Parses a comma-separated list of positive integers up to limit
+ */
+static size_t parse_list(const char* text, unsigned long limit, unsigned long* values) {
+    size_t count = 0;
+    while (*text != '\0' && count < MAX_LIST) {
+        char* end;
+        errno = 0;
+        unsigned long value = strtoul(text, &end, 10);
+        if (errno != 0 || end == text || value < 1 || value > limit ||
+            (*end != ',' && *end != '\0')) {
+            return 0;
+        }
+        values[count++] = value;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return *text == '\0' ? count : 0;
+}
+
+static void show_usage(const char* program_name) {
+    printf("Usage: %s [OPTIONS]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -s, --seats LIST     Seat counts per flight (default: 64,4096,65535)\n");
+    printf("  -t, --threads LIST   Thread counts, up to 64 (default: 1,2,4,8)\n");
+    printf("  -d, --duration MS    Time per case in milliseconds (default: 500)\n");
+    printf("  -w, --work-dir DIR   Directory for journaled cases (default: a new one in /tmp)\n");
+    printf("  -h, --help           Show this help message\n");
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config = { { 64, 4096, MAX_FLIGHT_SEATS }, 3, { 1, 2, 4, 8 }, 4, 500 };
+    const char* work_dir = NULL;
+    char scratch[] = "/tmp/bench_reservation.XXXXXX";
+    unsigned long values[MAX_LIST];
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--seats") == 0) && has_value) {
+            config.seat_count_total = parse_list(argv[++i], MAX_FLIGHT_SEATS, values);
+            for (size_t j = 0; j < config.seat_count_total; j++) {
+                config.seat_counts[j] = (int)values[j];
+            }
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--threads") == 0) &&
+                   has_value) {
+            config.thread_total = parse_list(argv[++i], MAX_THREADS, values);
+            for (size_t j = 0; j < config.thread_total; j++) {
+                config.threads[j] = (unsigned int)values[j];
+            }
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--duration") == 0) &&
+                   has_value) {
+            config.duration_ms = parse_list(argv[++i], 600000, values) == 1
+                                     ? (unsigned int)values[0] : 0;
+        } else if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--work-dir") == 0) &&
+                   has_value) {
+            work_dir = argv[++i];
+        } else {
+            show_usage(argv[0]);
+            return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0
+                       ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (config.seat_count_total == 0 || config.thread_total == 0 || config.duration_ms == 0) {
+        fprintf(stderr, "Error: Invalid seat list, thread list or duration\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!work_dir && !(work_dir = mkdtemp(scratch))) {
+        fprintf(stderr, "Error: Cannot create scratch directory: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (chdir(work_dir) != 0) {
+        fprintf(stderr, "Error: Cannot enter '%s': %s\n", work_dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    printf("{\n  \"benchmark\": \"reservation\",\n  \"schema\": 1,\n");
+    printf("  \"cpus\": %ld,\n  \"duration_ms\": %u,\n  \"cases\": [\n",
+           sysconf(_SC_NPROCESSORS_ONLN), config.duration_ms);
+
+    bool ok = true, first = true;
+    for (size_t m = 0; ok && m < sizeof(MIXES) / sizeof(MIXES[0]); m++) {
+        for (size_t d = 0; ok && d < sizeof(DURABILITIES) / sizeof(DURABILITIES[0]); d++) {
+            for (size_t s = 0; ok && s < config.seat_count_total; s++) {
+                for (size_t t = 0; ok && t < config.thread_total; t++) {
+                    ok = run_case(&config, &MIXES[m], &DURABILITIES[d], config.seat_counts[s],
+                                  config.threads[t], first);
+                    first = false;
+                }
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    if (work_dir == scratch) rmdir(scratch);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -12,11 +12,18 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 /* Constants */
 #define MAX_NAME_LENGTH 64
-#define MAX_SEATS 12
+#define MAX_SEATS 12                    /* Seat count of the default flight */
+#define MAX_FLIGHTS 65536               /* Flight ids range 0..MAX_FLIGHTS-1 */
+#define MAX_FLIGHT_SEATS 65535          /* Upper bound on seats per flight */
+#define DEFAULT_FLIGHT_ID 0
 #define RESERVATION_FILE "reservations.dat"
+#define RESERVATION_JOURNAL_FILE "reservations.journal"
+#define RESERVATION_MAP_FILE "reservations.map"
 
 /* Error codes */
 typedef enum {
@@ -27,20 +34,164 @@ typedef enum {
     RESERVATION_ERROR_INVALID_NAME,
     RESERVATION_ERROR_FILE_IO,
     RESERVATION_ERROR_MEMORY,
-    RESERVATION_ERROR_SYSTEM
+    RESERVATION_ERROR_SYSTEM,
+    RESERVATION_ERROR_INVALID_FLIGHT,
+    RESERVATION_ERROR_NO_ADJACENT_SEATS,
+    RESERVATION_ERROR_DUPLICATE_PASSENGER
 } ReservationResult;
 
+#define RESERVATION_RESULT_COUNT (RESERVATION_ERROR_DUPLICATE_PASSENGER + 1)
+
 /* Reservation structure */
 typedef struct {
-    int seat_number;                    /* Seat number (1-MAX_SEATS) */
+    int seat_number;                    /* Seat number (1-seat count of flight) */
     bool is_reserved;                   /* Reservation status */
     char first_name[MAX_NAME_LENGTH];   /* Passenger first name */
     char last_name[MAX_NAME_LENGTH];    /* Passenger last name */
 } Reservation;
 
-/* System structure */
+/* One seat of a batch booking */
+typedef struct {
+    int seat_number;
+    const char* first_name;
+    const char* last_name;
+} ReservationRequest;
+
+/* A seat held by a passenger */
+typedef struct {
+    int flight_id;
+    int seat_number;
+} ReservationSeat;
+
+#define RESERVATION_ANY_FLIGHT (-1)
+
+/*
+ * Duplicate booking policy.  Passengers are identified by first and last
+ * name, compared ignoring ASCII case.
+ */
+typedef enum {
+    RESERVATION_DUPLICATES_ALLOW = 0,   /* Any number of seats per passenger (default) */
+    RESERVATION_DUPLICATES_PER_FLIGHT,  /* One seat per passenger on each flight */
+    RESERVATION_DUPLICATES_NONE         /* One seat per passenger in the whole inventory */
+} ReservationDuplicates;
+
+/*
+ * Cabin layout for adjacent-seat allocation.  Seats are numbered row by
+ * row; a block of adjacent seats never spans two rows or an aisle.
+ */
+#define MAX_ROW_AISLES 4
+
+typedef struct {
+    int seats_per_row;                  /* 0 treats the flight as a single row */
+    int aisle_count;
+    int aisles[MAX_ROW_AISLES];         /* Aisle after this seat of a row (1-based) */
+} SeatLayout;
+
+/*
+ * Journal durability policy.  Each booking change is appended to
+ * RESERVATION_JOURNAL_FILE before it is applied; these settings control
+ * when appended records are forced to disk and when the journal is folded
+ * back into the RESERVATION_FILE snapshot.  A zero disables that trigger.
+ */
+typedef struct {
+    unsigned int sync_every_ops;        /* fsync after this many records (1 = every op) */
+    unsigned int sync_interval_ms;      /* fsync once the oldest unsynced record is this old,
+                                           from a background thread if no append comes */
+    unsigned int compact_every_ops;     /* Snapshot and truncate after this many records */
+} ReservationDurability;
+
+#define RESERVATION_DEFAULT_COMPACT_OPS 4096
+
+/*
+ * Persistent storage modes.  In memory a seat holds two 32-bit handles
+ * into a shared name pool in either mode.  A mapped flight additionally
+ * keeps a full Reservation record per seat in RESERVATION_MAP_FILE (the
+ * durable copy the pool is refilled from on load), so its mapped pages
+ * are not shrunk by name interning.
+ */
+typedef enum {
+    RESERVATION_STORAGE_STREAM = 0,     /* Read/write RESERVATION_FILE (default) */
+    RESERVATION_STORAGE_MAPPED          /* Use RESERVATION_MAP_FILE in place via mmap */
+} ReservationStorage;
+
+/* Operations counted by the statistics */
+typedef enum {
+    RESERVATION_OP_MAKE = 0,            /* Single, batch and adjacent bookings */
+    RESERVATION_OP_CANCEL,
+    RESERVATION_OP_QUERY,               /* Seat lookups */
+    RESERVATION_OP_SAVE,                /* Snapshots, including compactions */
+    RESERVATION_OP_LOAD,
+    RESERVATION_OP_COUNT
+} ReservationOp;
+
+/* Latency of one operation in nanoseconds; percentiles and the maximum
+   are upper bounds within 1/16 of the true value.  Bookings,
+   cancellations and queries are timed on a sample basis. */
+typedef struct {
+    uint64_t count;                     /* Operations timed */
+    uint64_t mean_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+} ReservationLatency;
+
+/*
+ * Statistics report.  Counting is on unless the library is built with
+ * -DRESERVATION_NO_STATS, in which case everything reads zero.
+ */
+typedef struct {
+    bool enabled;
+    uint64_t results[RESERVATION_OP_COUNT][RESERVATION_RESULT_COUNT]; /* Outcomes per op */
+    ReservationLatency latency[RESERVATION_OP_COUNT];
+    uint64_t journal_bytes;             /* Bytes appended to the journal */
+    uint64_t snapshot_bytes;            /* Snapshot bytes and mapped store pages written */
+    uint64_t syncs;                     /* fsync, fdatasync and msync calls */
+} ReservationStats;
+
+/* Statistics output formats */
+typedef enum {
+    RESERVATION_STATS_TEXT = 0,         /* Aligned table */
+    RESERVATION_STATS_JSON              /* One JSON object per line */
+} ReservationStatsFormat;
+
+/*
+ * System structure.  Every function taking a system may be called from
+ * several threads at once, except reservation_system_destroy.  Bookings
+ * and queries on different seats proceed in parallel; of two threads
+ * booking the same seat, exactly one succeeds.
+ */
 typedef struct ReservationSystem ReservationSystem;
 
+/* Read-only view of a reserved seat; the names belong to the system */
+typedef struct {
+    int seat_number;
+    const char* first_name;
+    const char* last_name;
+} ReservationView;
+
+/*
+ * Read cursor over the reserved seats of one flight, in seat order.  The
+ * fields are internal; use reservation_cursor_open/next/close.
+ */
+typedef struct {
+    const ReservationSystem* system;    /* NULL once closed */
+    const void* flight;
+    size_t word;                        /* Seat block being visited */
+    uint64_t pending;                   /* Its reserved seats not yet returned */
+    bool locked;                        /* Holding that block's lock */
+    ReservationView view;               /* Last seat returned */
+} ReservationCursor;
+
+/*
+ * Point-in-time view of one flight's seats for reports.  Bookings go on
+ * while it is open: the first change to a 64-seat block after it was
+ * taken copies that block's old contents into it, so reading a snapshot
+ * takes no seat lock and never waits for a booking.
+ */
+typedef struct ReservationSnapshot ReservationSnapshot;
+
 /**
  * @brief Creates a new reservation system
  * @return Pointer to system or NULL on failure
@@ -57,6 +208,9 @@ void reservation_system_destroy(ReservationSystem* system);
  * @brief Loads reservations from persistent storage
  * @param system Pointer to system
  * @return RESERVATION_SUCCESS on success, error code on failure
+ *
+ * Reads the snapshot, replays the journal on top of it and then opens the
+ * journal so that every later change is logged before it is applied.
  */
 ReservationResult reservation_system_load(ReservationSystem* system);
 
@@ -64,11 +218,408 @@ ReservationResult reservation_system_load(ReservationSystem* system);
  * @brief Saves reservations to persistent storage
  * @param system Pointer to system
  * @return RESERVATION_SUCCESS on success, error code on failure
+ *
+ * Writes a full snapshot and truncates the journal (compaction).  Changes
+ * are already durable through the journal, so this only bounds its size.
  */
 ReservationResult reservation_system_save(const ReservationSystem* system);
 
 /**
- * @brief Makes a seat reservation
+ * @brief Selects the storage mode used by the next load
+ * @param system Pointer to system
+ * @param storage Storage mode
+ * @return RESERVATION_SUCCESS, or RESERVATION_ERROR_SYSTEM once a mapped
+ *         store is already open
+ *
+ * In mapped mode the load only reads the store header and flight
+ * directory; seat pages fault in on first access and saves msync just the
+ * pages changed since the previous save.  When RESERVATION_MAP_FILE does
+ * not exist yet it is created from RESERVATION_FILE.
+ */
+ReservationResult reservation_system_set_storage(ReservationSystem* system,
+                                               ReservationStorage storage);
+
+/**
+ * @brief Sets the journal fsync and compaction policy
+ * @param system Pointer to system
+ * @param durability Policy to apply (defaults: sync every op, compact
+ *                   every RESERVATION_DEFAULT_COMPACT_OPS records)
+ */
+void reservation_system_set_durability(ReservationSystem* system,
+                                       const ReservationDurability* durability);
+
+/**
+ * @brief Forces journal records not yet synced by the policy to disk
+ * @param system Pointer to system
+ * @return RESERVATION_SUCCESS on success, error code on failure
+ */
+ReservationResult reservation_system_flush(ReservationSystem* system);
+
+/**
+ * @brief Sets which bookings are rejected as duplicates
+ * @param system Pointer to system
+ * @param duplicates Policy; bookings it rejects fail with
+ *                   RESERVATION_ERROR_DUPLICATE_PASSENGER
+ *
+ * Only new bookings are checked; seats already held are kept.
+ */
+void reservation_system_set_duplicates(ReservationSystem* system,
+                                       ReservationDuplicates duplicates);
+
+/**
+ * @brief Gets the operation counters, latencies and I/O totals
+ * @param system Pointer to system
+ * @param stats Report to fill
+ * @return RESERVATION_SUCCESS on success, error code on failure
+ *
+ * Counters are read without stopping other threads, so the report may
+ * be a few operations apart across fields.
+ */
+ReservationResult reservation_system_get_stats(const ReservationSystem* system,
+                                             ReservationStats* stats);
+
+/**
+ * @brief Zeroes the statistics
+ * @param system Pointer to system
+ */
+void reservation_system_reset_stats(ReservationSystem* system);
+
+/**
+ * @brief Writes the statistics to a stream periodically
+ * @param system Pointer to system
+ * @param out Stream written from a background thread (kept open by the caller)
+ * @param interval_ms Time between reports; 0 stops the dump after one last
+ *                    report, as reservation_system_destroy does
+ * @param format Report format
+ * @return RESERVATION_SUCCESS, or RESERVATION_ERROR_SYSTEM if the thread
+ *         could not be started or statistics are compiled out
+ */
+ReservationResult reservation_system_dump_stats(ReservationSystem* system, FILE* out,
+                                              unsigned int interval_ms,
+                                              ReservationStatsFormat format);
+
+/**
+ * @brief Writes a statistics report
+ * @return true on success
+ */
+bool reservation_stats_print(const ReservationStats* stats, ReservationStatsFormat format,
+                             FILE* out);
+
+/**
+ * @brief Gets the lowercase name of an operation ("make", "cancel", ...)
+ */
+const char* reservation_op_name(ReservationOp op);
+
+/**
+ * @brief Adds a flight with the given seat count
+ * @param system Pointer to system
+ * @param flight_id Flight identifier (0-MAX_FLIGHTS-1)
+ * @param seat_count Number of seats on the flight (1-MAX_FLIGHT_SEATS)
+ * @return RESERVATION_SUCCESS on success, error code on failure
+ */
+ReservationResult reservation_flight_add(ReservationSystem* system,
+                                       int flight_id,
+                                       int seat_count);
+
+/**
+ * @brief Removes a flight and all of its reservations
+ * @param system Pointer to system
+ * @param flight_id Flight to remove (the default flight cannot be removed)
+ * @return RESERVATION_SUCCESS on success, error code on failure
+ */
+ReservationResult reservation_flight_remove(ReservationSystem* system, int flight_id);
+
+/**
+ * @brief Gets the seat count of a flight
+ * @param system Pointer to system
+ * @param flight_id Flight to query
+ * @return Number of seats, or -1 if the flight does not exist
+ */
+int reservation_flight_seat_count(const ReservationSystem* system, int flight_id);
+
+/**
+ * @brief Gets the ids of all flights in ascending order
+ * @param system Pointer to system
+ * @param flight_ids Array to store flight ids
+ * @param max_flights Maximum number of ids to return
+ * @return Number of ids stored, or -1 on error
+ */
+int reservation_flight_list(const ReservationSystem* system,
+                          int* flight_ids,
+                          size_t max_flights);
+
+/**
+ * @brief Makes a seat reservation on a specific flight
+ * @param system Pointer to system
+ * @param flight_id Flight to book on
+ * @param seat_number Seat number (1-seat count of flight)
+ * @param first_name Passenger first name
+ * @param last_name Passenger last name
+ * @return RESERVATION_SUCCESS on success, error code on failure
+ */
+ReservationResult reservation_flight_make(ReservationSystem* system,
+                                        int flight_id,
+                                        int seat_number,
+                                        const char* first_name,
+                                        const char* last_name);
+
+/**
+ * @brief Books several seats on a flight, all or nothing
+ * @param system Pointer to system
+ * @param flight_id Flight to book on
+ * @param requests Seats and passengers to book
+ * @param count Number of requests
+ * @param results Optional array of count entries receiving each item's
+ *                result; on failure the offending items hold their error
+ *                and the others RESERVATION_SUCCESS
+ * @return RESERVATION_SUCCESS if every seat was booked, otherwise the
+ *         first error, in which case no seat was booked
+ *
+ * The whole batch is journaled as one record (a single write and sync)
+ * and is replayed entirely or not at all after a crash.  A seat listed
+ * twice fails the second time with RESERVATION_ERROR_SEAT_OCCUPIED.
+ */
+ReservationResult reservation_flight_make_batch(ReservationSystem* system,
+                                              int flight_id,
+                                              const ReservationRequest* requests,
+                                              size_t count,
+                                              ReservationResult* results);
+
+/**
+ * @brief Cancels a seat reservation on a specific flight
+ * @param system Pointer to system
+ * @param flight_id Flight the seat belongs to
+ * @param seat_number Seat number to cancel
+ * @return RESERVATION_SUCCESS on success, error code on failure
+ */
+ReservationResult reservation_flight_cancel(ReservationSystem* system,
+                                          int flight_id,
+                                          int seat_number);
+
+/**
+ * @brief Gets reservation information for a seat on a specific flight
+ * @param system Pointer to system
+ * @param flight_id Flight the seat belongs to
+ * @param seat_number Seat number to query
+ * @param reservation Pointer to store reservation data
+ * @return RESERVATION_SUCCESS on success, error code on failure
+ */
+ReservationResult reservation_flight_get(const ReservationSystem* system,
+                                       int flight_id,
+                                       int seat_number,
+                                       Reservation* reservation);
+
+/**
+ * @brief Checks if a seat on a specific flight is available
+ * @param system Pointer to system
+ * @param flight_id Flight the seat belongs to
+ * @param seat_number Seat number to check
+ * @return true if available, false otherwise
+ */
+bool reservation_flight_is_available(const ReservationSystem* system,
+                                   int flight_id,
+                                   int seat_number);
+
+/**
+ * @brief Gets count of available seats on a specific flight
+ * @param system Pointer to system
+ * @param flight_id Flight to query
+ * @return Number of available seats, or -1 on error
+ *
+ * Reads a counter that a batch booking updates once, so the count never
+ * includes part of a batch.
+ */
+int reservation_flight_count_available(const ReservationSystem* system, int flight_id);
+
+/**
+ * @brief Gets the next free seats on a flight, starting at a given seat
+ * @param system Pointer to system
+ * @param flight_id Flight to query
+ * @param from_seat First seat number to consider
+ * @param seats Array to store available seat numbers in ascending order
+ * @param max_seats Maximum number of seats to return
+ * @return Number of available seats found, or -1 on error
+ */
+int reservation_flight_find_available(const ReservationSystem* system,
+                                    int flight_id,
+                                    int from_seat,
+                                    int* seats,
+                                    size_t max_seats);
+
+/**
+ * @brief Finds the best block of adjacent free seats on a flight
+ * @param system Pointer to system
+ * @param flight_id Flight to query
+ * @param count Number of seats wanted together
+ * @param layout Cabin layout, or NULL for a single row
+ * @return First seat number of the block, 0 if no block is free, or -1
+ *         on error
+ *
+ * Best fit: the block starts the smallest free stretch (between occupied
+ * seats, row ends and aisles) that holds count seats, lowest seat first.
+ */
+int reservation_flight_find_adjacent(const ReservationSystem* system,
+                                   int flight_id,
+                                   int count,
+                                   const SeatLayout* layout);
+
+/**
+ * @brief Books a block of adjacent seats, all or nothing
+ * @param system Pointer to system
+ * @param flight_id Flight to book on
+ * @param layout Cabin layout, or NULL for a single row
+ * @param passengers Passenger names; on success seat_number is set to each
+ *                   booked seat, otherwise it is left unchanged
+ * @param count Number of passengers
+ * @return RESERVATION_SUCCESS, RESERVATION_ERROR_NO_ADJACENT_SEATS, or
+ *         another error code
+ */
+ReservationResult reservation_flight_book_adjacent(ReservationSystem* system,
+                                                 int flight_id,
+                                                 const SeatLayout* layout,
+                                                 ReservationRequest* passengers,
+                                                 size_t count);
+
+/**
+ * @brief Gets list of available seat numbers on a specific flight
+ * @param system Pointer to system
+ * @param flight_id Flight to query
+ * @param seats Array to store available seat numbers
+ * @param max_seats Maximum number of seats to return
+ * @return Number of available seats found, or -1 on error
+ */
+int reservation_flight_list_available(const ReservationSystem* system,
+                                    int flight_id,
+                                    int* seats,
+                                    size_t max_seats);
+
+/**
+ * @brief Gets reservations on a specific flight sorted by last name
+ * @param system Pointer to system
+ * @param flight_id Flight to query
+ * @param reservations Array to store reservations
+ * @param max_reservations Maximum number of reservations to return
+ * @return Number of reservations found, or -1 on error
+ *
+ * Ordering is by last name, then first name (case-insensitive), then seat.
+ */
+int reservation_flight_list_sorted(const ReservationSystem* system,
+                                 int flight_id,
+                                 Reservation* reservations,
+                                 size_t max_reservations);
+
+/**
+ * @brief Finds the seats held by a passenger in O(1) expected time
+ * @param system Pointer to system
+ * @param flight_id Flight to search, or RESERVATION_ANY_FLIGHT
+ * @param first_name Passenger first name, matched ignoring ASCII case
+ * @param last_name Passenger last name, matched ignoring ASCII case
+ * @param seats Array to store seats ordered by flight and seat (may be
+ *              NULL when max_seats is 0)
+ * @param max_seats Maximum number of seats to store
+ * @return Number of seats the passenger holds, which may exceed
+ *         max_seats, or -1 on error
+ */
+int reservation_find_passenger(const ReservationSystem* system, int flight_id,
+                               const char* first_name, const char* last_name,
+                               ReservationSeat* seats, size_t max_seats);
+
+/**
+ * @brief Opens a cursor over the reserved seats of a flight
+ * @param system Pointer to system
+ * @param flight_id Flight to visit
+ * @param cursor Cursor to initialize
+ * @return RESERVATION_SUCCESS, or an error code with the cursor closed
+ *
+ * The cursor holds the system read lock until it is closed and the lock
+ * of the seat block it is in, so bookings on that block wait for it.
+ * Make no other reservation calls on this thread while it is open.
+ */
+ReservationResult reservation_cursor_open(const ReservationSystem* system, int flight_id,
+                                          ReservationCursor* cursor);
+
+/**
+ * @brief Advances to the next reserved seat
+ * @param cursor Open cursor
+ * @return View of the seat, valid until the next call or close, or NULL
+ *         when there are no more
+ *
+ * Empty seat blocks are skipped from the occupancy bitmap, and the names
+ * point into the system's name storage; nothing is copied.
+ */
+const ReservationView* reservation_cursor_next(ReservationCursor* cursor);
+
+/**
+ * @brief Releases the cursor's locks; closing twice is harmless
+ * @param cursor Cursor to close
+ */
+void reservation_cursor_close(ReservationCursor* cursor);
+
+/**
+ * @brief Takes a snapshot of a flight's seats
+ * @param system Pointer to system
+ * @param flight_id Flight to capture
+ * @param snapshot Receives the snapshot, or NULL on failure
+ * @return RESERVATION_SUCCESS on success, error code on failure
+ *
+ * Nothing is copied up front.  Opening and closing lock each seat block
+ * of the flight once, so they wait for bookings in progress on it and
+ * briefly hold up new ones.  A snapshot outlives the removal or reload of
+ * its flight; close every snapshot before destroying the system.
+ */
+ReservationResult reservation_snapshot_open(const ReservationSystem* system, int flight_id,
+                                            ReservationSnapshot** snapshot);
+
+/**
+ * @brief Gets a seat as it was when the snapshot was taken
+ * @param snapshot Open snapshot
+ * @param seat_number Seat number to query
+ * @param reservation Pointer to store reservation data
+ * @return RESERVATION_SUCCESS on success, error code on failure
+ */
+ReservationResult reservation_snapshot_get(const ReservationSnapshot* snapshot, int seat_number,
+                                           Reservation* reservation);
+
+/**
+ * @brief Gets the number of seats that were free when the snapshot was taken
+ * @param snapshot Open snapshot
+ * @return Number of available seats, or -1 on error
+ */
+int reservation_snapshot_count_available(const ReservationSnapshot* snapshot);
+
+/**
+ * @brief Gets every seat as it was when the snapshot was taken
+ * @param snapshot Open snapshot
+ * @param reservations Array to store all seat data in seat order
+ * @param max_seats Size of the array; at least the flight's seat count
+ * @return Number of seats returned, or -1 on error
+ */
+int reservation_snapshot_get_all(const ReservationSnapshot* snapshot,
+                                 Reservation* reservations, size_t max_seats);
+
+/**
+ * @brief Releases a snapshot (may be NULL)
+ * @param snapshot Snapshot to close
+ */
+void reservation_snapshot_close(ReservationSnapshot* snapshot);
+
+/**
+ * @brief Gets reservations whose last name starts with a prefix
+ * @param system Pointer to system
+ * @param flight_id Flight to query
+ * @param prefix Last name prefix, matched case-insensitively
+ * @param reservations Array to store matches in sorted order
+ * @param max_reservations Maximum number of reservations to return
+ * @return Number of reservations found, or -1 on error
+ */
+int reservation_flight_find_by_last_name(const ReservationSystem* system,
+                                       int flight_id,
+                                       const char* prefix,
+                                       Reservation* reservations,
+                                       size_t max_reservations);
+
+/**
+ * @brief Makes a seat reservation on the default flight
  * @param system Pointer to system
  * @param seat_number Seat number (1-MAX_SEATS)
  * @param first_name Passenger first name
@@ -81,7 +632,16 @@ ReservationResult reservation_make(ReservationSystem* system,
                                  const char* last_name);
 
 /**
- * @brief Cancels a seat reservation
+ * @brief Books several seats on the default flight, all or nothing
+ * @see reservation_flight_make_batch
+ */
+ReservationResult reservation_make_batch(ReservationSystem* system,
+                                       const ReservationRequest* requests,
+                                       size_t count,
+                                       ReservationResult* results);
+
+/**
+ * @brief Cancels a seat reservation on the default flight
  * @param system Pointer to system
  * @param seat_number Seat number to cancel
  * @return RESERVATION_SUCCESS on success, error code on failure
@@ -89,7 +649,7 @@ ReservationResult reservation_make(ReservationSystem* system,
 ReservationResult reservation_cancel(ReservationSystem* system, int seat_number);
 
 /**
- * @brief Gets reservation information for a seat
+ * @brief Gets reservation information for a seat on the default flight
  * @param system Pointer to system
  * @param seat_number Seat number to query
  * @param reservation Pointer to store reservation data
@@ -100,18 +660,21 @@ ReservationResult reservation_get(const ReservationSystem* system,
                                 Reservation* reservation);
 
 /**
- * @brief Gets all reservations for display purposes
+ * @brief Gets all seats of the default flight for display purposes
  * @param system Pointer to system
  * @param reservations Array to store all seat data
  * @param max_seats Maximum number of seats to return
  * @return Number of seats returned, or -1 on error
+ *
+ * The seats are read through a snapshot, so they show the flight at one
+ * point in time while bookings continue.
  */
 int reservation_get_all_seats(const ReservationSystem* system, 
                             Reservation* reservations, 
                             size_t max_seats);
 
 /**
- * @brief Checks if a seat is available
+ * @brief Checks if a seat on the default flight is available
  * @param system Pointer to system
  * @param seat_number Seat number to check
  * @return true if available, false otherwise
@@ -119,14 +682,14 @@ int reservation_get_all_seats(const ReservationSystem* system,
 bool reservation_is_available(const ReservationSystem* system, int seat_number);
 
 /**
- * @brief Gets count of available seats
+ * @brief Gets count of available seats on the default flight
  * @param system Pointer to system
  * @return Number of available seats, or -1 on error
  */
 int reservation_count_available(const ReservationSystem* system);
 
 /**
- * @brief Gets list of available seat numbers
+ * @brief Gets list of available seat numbers on the default flight
  * @param system Pointer to system
  * @param seats Array to store available seat numbers
  * @param max_seats Maximum number of seats to return
@@ -137,7 +700,7 @@ int reservation_list_available(const ReservationSystem* system,
                              size_t max_seats);
 
 /**
- * @brief Gets list of all reservations sorted by last name
+ * @brief Gets reservations on the default flight sorted by last name
  * @param system Pointer to system
  * @param reservations Array to store reservations
  * @param max_reservations Maximum number of reservations to return
@@ -155,7 +718,7 @@ int reservation_list_sorted(const ReservationSystem* system,
 const char* reservation_error_string(ReservationResult result);
 
 /**
- * @brief Validates seat number
+ * @brief Validates seat number against the default flight
  * @param seat_number Seat number to validate
  * @return true if valid, false otherwise
  */
@@ -0,0 +1,389 @@
+/**
+ * @file converter_batch.c
+ * @brief Many-File Conversion Implementation
+ * @author Jaden Mardini
+ */
+
+#define _DEFAULT_SOURCE /* d_type */
+
+#include "converter_batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* Source and destination path of every file to convert */
+typedef struct {
+    char** sources;
+    char** dests;
+    size_t count;
+    size_t capacity;
+    dev_t output_device;                /* Output directory, never walked into */
+    ino_t output_inode;
+} JobList;
+
+static char* join_path(const char* dir, const char* name) {
+    size_t dir_length = strlen(dir);
+    size_t name_length = strlen(name);
+    char* path = malloc(dir_length + name_length + 2);
+    if (!path) return NULL;
+
+    memcpy(path, dir, dir_length);
+    path[dir_length] = '/';
+    memcpy(path + dir_length + 1, name, name_length + 1);
+    return path;
+}
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+/**
+ * @brief Appends a job, taking ownership of both paths
+ */
+static bool job_add(JobList* jobs, char* source, char* dest) {
+    if (!source || !dest) {
+        free(source);
+        free(dest);
+        fprintf(stderr, "Error: Out of memory\n");
+        return false;
+    }
+
+    if (jobs->count == jobs->capacity) {
+        size_t capacity = jobs->capacity ? jobs->capacity * 2 : 256;
+        char** sources = realloc(jobs->sources, capacity * sizeof(char*));
+        if (sources) jobs->sources = sources;
+        char** dests = sources ? realloc(jobs->dests, capacity * sizeof(char*)) : NULL;
+        if (!dests) {
+            free(source);
+            free(dest);
+            fprintf(stderr, "Error: Out of memory\n");
+            return false;
+        }
+        jobs->dests = dests;
+        jobs->capacity = capacity;
+    }
+
+    jobs->sources[jobs->count] = source;
+    jobs->dests[jobs->count] = dest;
+    jobs->count++;
+    return true;
+}
+
+static void job_list_free(JobList* jobs) {
+    for (size_t i = 0; i < jobs->count; i++) {
+        free(jobs->sources[i]);
+        free(jobs->dests[i]);
+    }
+    free(jobs->sources);
+    free(jobs->dests);
+}
+
+/* A destination and the job that writes it */
+typedef struct {
+    const char* dest;
+    size_t index;
+} DestEntry;
+
+static int compare_dests(const void* a, const void* b) {
+    const DestEntry* x = a;
+    const DestEntry* y = b;
+    int order = strcmp(x->dest, y->dest);
+    return order ? order : (x->index > y->index) - (x->index < y->index);
+}
+
+/**
+ * @brief Drops every job whose destination an earlier job already writes
+ * @param dropped Receives the number of jobs dropped, each one reported
+ * @return false if out of memory
+ */
+static bool job_list_drop_duplicates(JobList* jobs, size_t* dropped) {
+    *dropped = 0;
+    if (jobs->count < 2) return true;
+
+    DestEntry* entries = malloc(jobs->count * sizeof(DestEntry));
+    bool* duplicate = calloc(jobs->count, sizeof(bool));
+    if (!entries || !duplicate) {
+        free(entries);
+        free(duplicate);
+        fprintf(stderr, "Error: Out of memory\n");
+        return false;
+    }
+
+    for (size_t i = 0; i < jobs->count; i++) {
+        entries[i].dest = jobs->dests[i];
+        entries[i].index = i;
+    }
+    qsort(entries, jobs->count, sizeof(DestEntry), compare_dests);
+    size_t first = entries[0].index;
+    for (size_t i = 1; i < jobs->count; i++) {
+        size_t index = entries[i].index;
+        if (strcmp(entries[i].dest, jobs->dests[first]) != 0) {
+            first = index;
+            continue;
+        }
+        fprintf(stderr, "Error: '%s' would overwrite the output of '%s' in '%s'\n",
+                jobs->sources[index], jobs->sources[first], jobs->dests[index]);
+        duplicate[index] = true;
+    }
+
+    /* Keep the survivors in input order */
+    size_t kept = 0;
+    for (size_t i = 0; i < jobs->count; i++) {
+        if (duplicate[i]) {
+            free(jobs->sources[i]);
+            free(jobs->dests[i]);
+        } else {
+            jobs->sources[kept] = jobs->sources[i];
+            jobs->dests[kept] = jobs->dests[i];
+            kept++;
+        }
+    }
+    *dropped = jobs->count - kept;
+    jobs->count = kept;
+
+    free(entries);
+    free(duplicate);
+    return true;
+}
+
+static bool make_directory(const char* path) {
+    if (mkdir(path, 0777) == 0 || errno == EEXIST) return true;
+    fprintf(stderr, "Error: Cannot create directory '%s': %s\n", path, strerror(errno));
+    return false;
+}
+
+/**
+ * @brief Adds every regular file below source_dir, mirrored under dest_dir
+ */
+static bool walk_directory(JobList* jobs, const char* source_dir, const char* dest_dir) {
+    DIR* dir = opendir(source_dir);
+    if (!dir) {
+        fprintf(stderr, "Error: Cannot open directory '%s': %s\n", source_dir, strerror(errno));
+        return false;
+    }
+
+    bool ok = true;
+    struct dirent* entry;
+    while (ok && (entry = readdir(dir))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        char* source = join_path(source_dir, entry->d_name);
+        char* dest = join_path(dest_dir, entry->d_name);
+        struct stat info;
+        bool is_file = entry->d_type == DT_REG;
+        bool is_dir = entry->d_type == DT_DIR;
+        if (source && (entry->d_type == DT_UNKNOWN || is_dir) && lstat(source, &info) == 0) {
+            is_file = S_ISREG(info.st_mode);
+            is_dir = S_ISDIR(info.st_mode) &&
+                     !(info.st_dev == jobs->output_device && info.st_ino == jobs->output_inode);
+        } else if (source && entry->d_type == DT_LNK) {
+            /* Follow links to files, never to directories */
+            is_file = stat(source, &info) == 0 && S_ISREG(info.st_mode);
+        }
+
+        if (is_file) {
+            ok = job_add(jobs, source, dest);
+        } else {
+            if (is_dir) {
+                ok = source && dest && make_directory(dest) && walk_directory(jobs, source, dest);
+            }
+            free(source);
+            free(dest);
+        }
+    }
+
+    closedir(dir);
+    return ok;
+}
+
+/**
+ * @brief Adds every path listed one per line in list_path
+ */
+static bool read_list(JobList* jobs, const char* list_path, const char* output_dir) {
+    FILE* list = strcmp(list_path, "-") == 0 ? stdin : fopen(list_path, "r");
+    if (!list) {
+        fprintf(stderr, "Error: Cannot open list file '%s': %s\n", list_path, strerror(errno));
+        return false;
+    }
+
+    bool ok = true;
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while (ok && (length = getline(&line, &capacity, list)) > 0) {
+        if (line[length - 1] == '\n') line[--length] = '\0';
+        if (length > 0 && line[length - 1] == '\r') line[--length] = '\0';
+        if (length == 0) continue;
+
+        char* source = strdup(line);
+        ok = job_add(jobs, source, source ? join_path(output_dir, base_name(source)) : NULL);
+    }
+    if (ok && ferror(list)) {
+        fprintf(stderr, "Error: Failed to read list file '%s'\n", list_path);
+        ok = false;
+    }
+
+    free(line);
+    if (list != stdin) fclose(list);
+    return ok;
+}
+
+/* Shared state of the worker pool */
+typedef struct {
+    const JobList* jobs;
+    const StreamTransform* transform;
+    const BatchOptions* options;
+    size_t next;                        /* Next job to claim (atomic) */
+    size_t failures;                    /* (atomic) */
+    uint64_t bytes;                     /* (atomic) */
+} BatchPool;
+
+/**
+ * @brief Converts one file, opening each side exactly once
+ */
+static bool convert_one(const char* source_path, const char* dest_path,
+                        const StreamTransform* transform, const StreamOptions* options,
+                        uint64_t* bytes) {
+    int source = open(source_path, O_RDONLY);
+    if (source < 0) {
+        fprintf(stderr, "Error: Cannot open source file '%s': %s\n", source_path, strerror(errno));
+        return false;
+    }
+    struct stat info;
+    uint64_t expected_size = fstat(source, &info) == 0 && S_ISREG(info.st_mode)
+                                 ? (uint64_t)info.st_size : 0;
+    StreamOutput output;
+    if (!stream_output_open(&output, dest_path, expected_size)) {
+        fprintf(stderr, "Error: Cannot create '%s': %s\n", dest_path, strerror(errno));
+        close(source);
+        return false;
+    }
+
+    /* Directory entries are synced once for the whole run */
+    bool ok = stream_convert(source, output.fd, transform, options, bytes);
+    close(source);
+    if (ok) {
+        ok = stream_output_commit(&output, *bytes, false);
+    } else {
+        stream_output_abort(&output);
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to convert '%s': %s\n", source_path, strerror(errno));
+    }
+    return ok;
+}
+
+static void* pool_worker(void* arg) {
+    BatchPool* pool = arg;
+    const JobList* jobs = pool->jobs;
+    StreamTransform transform = *pool->transform;
+    unsigned char* block = malloc(pool->options->block_size);
+    unsigned char* filtered = transform.filter
+                                  ? malloc(pool->options->block_size + STREAM_FILTER_SLACK)
+                                  : NULL;
+    void* state = transform.state_size ? malloc(transform.state_size) : transform.context;
+    if (!block || (transform.filter && !filtered) || (transform.state_size && !state)) {
+        /* Unclaimed jobs are counted as failures by batch_convert */
+        if (transform.state_size) free(state);
+        free(filtered);
+        free(block);
+        return NULL;
+    }
+    transform.context = state;
+
+    StreamOptions options = { pool->options->block_size, 1, block, filtered };
+    for (;;) {
+        size_t index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (index >= jobs->count) break;
+
+        if (transform.state_size) {
+            memcpy(state, pool->transform->context, transform.state_size);
+        }
+        uint64_t bytes = 0;
+        if (convert_one(jobs->sources[index], jobs->dests[index], &transform, &options, &bytes)) {
+            __atomic_fetch_add(&pool->bytes, bytes, __ATOMIC_RELAXED);
+            if (pool->options->verbose) {
+                printf("%s -> %s (%" PRIu64 " bytes)\n", jobs->sources[index],
+                       jobs->dests[index], bytes);
+            }
+        } else {
+            __atomic_fetch_add(&pool->failures, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (transform.state_size) free(state);
+    free(filtered);
+    free(block);
+    return NULL;
+}
+
+bool batch_convert(char* const* inputs, size_t input_count, const StreamTransform* transform,
+                   const BatchOptions* options, BatchResult* result) {
+    JobList jobs = { NULL, NULL, 0, 0, 0, 0 };
+    BatchResult counters = { 0, 0, 0 };
+    struct stat info;
+
+    bool ok = make_directory(options->output_dir) && stat(options->output_dir, &info) == 0;
+    if (ok) {
+        jobs.output_device = info.st_dev;
+        jobs.output_inode = info.st_ino;
+    }
+    for (size_t i = 0; ok && i < input_count; i++) {
+        if (stat(inputs[i], &info) == 0 && S_ISDIR(info.st_mode)) {
+            ok = walk_directory(&jobs, inputs[i], options->output_dir);
+        } else {
+            /* Open errors are reported when the file is converted */
+            char* source = strdup(inputs[i]);
+            ok = job_add(&jobs, source,
+                         source ? join_path(options->output_dir, base_name(source)) : NULL);
+        }
+    }
+    if (ok && options->list_path) {
+        ok = read_list(&jobs, options->list_path, options->output_dir);
+    }
+    size_t duplicates = 0;
+    if (ok) {
+        ok = job_list_drop_duplicates(&jobs, &duplicates);
+    }
+
+    if (ok) {
+        BatchPool pool = { &jobs, transform, options, 0, 0, 0 };
+        pthread_t workers[STREAM_MAX_THREADS];
+        unsigned int started = 0;
+        unsigned int threads = options->threads < STREAM_MAX_THREADS ? options->threads
+                                                                     : STREAM_MAX_THREADS;
+        while (started + 1 < threads && started + 1 < jobs.count &&
+               pthread_create(&workers[started], NULL, pool_worker, &pool) == 0) {
+            started++;
+        }
+        pool_worker(&pool);
+        for (unsigned int i = 0; i < started; i++) {
+            pthread_join(workers[i], NULL);
+        }
+
+        if (pool.next < jobs.count) {
+            fprintf(stderr, "Error: Out of memory\n");
+            pool.failures += jobs.count - pool.next;
+        }
+        if (jobs.count > 0 && !stream_sync_filesystem(options->output_dir)) {
+            fprintf(stderr, "Error: Cannot sync '%s': %s\n", options->output_dir, strerror(errno));
+            pool.failures = jobs.count;
+        }
+        counters.files = jobs.count + duplicates;
+        counters.failures = pool.failures + duplicates;
+        counters.bytes = pool.bytes;
+        ok = counters.failures == 0;
+    }
+
+    job_list_free(&jobs);
+    if (result) *result = counters;
+    return ok;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file converter_batch.h
+ * @brief Many-file conversion for the file converter
+ * @author Jaden Mardini
+ *
+ * Inputs are files, directories (walked recursively) and list files with
+ * one path per line.  Every file lands in the output directory: a file
+ * named directly or in a list under its base name, a file found in a
+ * directory under its path relative to that directory.  Subdirectories
+ * are created as needed.  Two inputs that would land on the same output
+ * path are an error: the first one listed is converted and every later
+ * one counts as a failure.
+ *
+ * The whole job list is collected first, then a pool of threads claims
+ * files one at a time.  Each thread owns one block buffer for all of its
+ * files, and each source is opened exactly once.
+ */
+
+#ifndef CONVERTER_BATCH_H
+#define CONVERTER_BATCH_H
+
+#include "converter_stream.h"
+
+typedef struct {
+    const char* output_dir;
+    const char* list_path;              /* File of input paths, "-" for stdin, or NULL */
+    size_t block_size;
+    unsigned int threads;
+    bool verbose;                       /* Print each conversion */
+} BatchOptions;
+
+/* Counters of a batch run */
+typedef struct {
+    size_t files;                       /* Files attempted */
+    size_t failures;                    /* Files not converted */
+    uint64_t bytes;                     /* Bytes written */
+} BatchResult;
+
+/**
+ * @brief Converts every input file into the output directory
+ * @param inputs Files and directories to convert
+ * @param input_count Number of inputs
+ * @param transform Transform applied to every file; a stateful one starts
+ *                  each file from its context
+ * @param options Output directory, list file and pool settings
+ * @param result Filled with counters of the run
+ * @return false if the job list could not be built or any file failed
+ */
+bool batch_convert(char* const* inputs, size_t input_count, const StreamTransform* transform,
+                   const BatchOptions* options, BatchResult* result);
+
+#endif /* CONVERTER_BATCH_H */
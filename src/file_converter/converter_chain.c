@@ -0,0 +1,344 @@
+/**
+ * @file converter_chain.c
+ * @brief Fused Transform Chain Implementation
+ * @author Jaden Mardini
+ *
+ * Folding: a map stage deletes by input byte, then maps.  Appending map M
+ * to (drop, T) gives (drop, M[T[c]]); appending deletion D gives
+ * (drop | D[T[c]], T).  Any run of maps and deletions is one stage.
+ */
+
+#include "converter_chain.h"
+#include "converter_transform.h"
+#include <string.h>
+
+#define CHAIN_TILE ((size_t)16 << 10)   /* Bytes taken through all stages at a time */
+
+_Static_assert(CHAIN_STATE_SIZE + CHAIN_HELD_MAX <= STREAM_FILTER_SLACK,
+               "held bytes must fit in the filter slack");
+
+/* Blanks held back by a trim stage until their line turns out to go on */
+typedef struct {
+    size_t held;                        /* Blanks held */
+    size_t first;                       /* Ring position of the oldest one */
+    size_t limit;                       /* Most blanks held; the chain splits CHAIN_HELD_MAX */
+    unsigned char tabs[CHAIN_HELD_MAX / 8]; /* Ring of one bit per blank, set for a tab */
+} TrimState;
+
+/* CR seen at the end of the previous call */
+typedef struct {
+    bool pending_cr;
+} CrlfState;
+
+static bool drops(const unsigned char* drop, unsigned char c) {
+    return (drop[c >> 3] >> (c & 7)) & 1;
+}
+
+static bool is_blank(unsigned char c) {
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * @brief Picks the kernel for a map stage after it changed
+ */
+static void classify_map(ChainStage* stage) {
+    bool lower = true, upper = true;
+    for (int c = 0; c < 256; c++) {
+        int folded_lower = c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+        int folded_upper = c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c;
+        lower = lower && stage->table[c] == folded_lower;
+        upper = upper && stage->table[c] == folded_upper;
+    }
+    stage->map = lower ? transform_lowercase : upper ? transform_uppercase : transform_table;
+}
+
+static size_t run_map(const ChainStage* stage, unsigned char* dest, const unsigned char* source,
+                      size_t length) {
+    if (!stage->drops) {
+        stage->map(dest, source, length, (void*)stage->table);
+        return length;
+    }
+
+    /* Branch-free: every byte is stored, dropped ones are overwritten */
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = source[i];
+        dest[count] = stage->table[c];
+        count += !drops(stage->drop, c);
+    }
+    return count;
+}
+
+static size_t capitalize_apply(unsigned char* dest, const unsigned char* source, size_t length,
+                               void* state) {
+    if (source) transform_capitalize(dest, source, length, state);
+    return length;
+}
+
+static size_t crlf_apply(unsigned char* dest, const unsigned char* source, size_t length,
+                         void* state) {
+    CrlfState* crlf = state;
+    size_t count = 0;
+    if (source && length == 0) return 0;
+    if (crlf->pending_cr && (!source || source[0] != '\n')) {
+        dest[count++] = '\r';
+    }
+    crlf->pending_cr = false;
+    if (!source) return count;
+
+    const unsigned char* end = source + length;
+    while (source < end) {
+        const unsigned char* cr = memchr(source, '\r', (size_t)(end - source));
+        size_t span = (size_t)((cr ? cr : end) - source);
+        memcpy(dest + count, source, span);
+        count += span;
+        if (!cr) break;
+
+        if (cr + 1 == end) {
+            crlf->pending_cr = true;
+        } else if (cr[1] != '\n') {
+            dest[count++] = '\r';
+        }
+        source = cr + 1;
+    }
+    return count;
+}
+
+/**
+ * @brief Writes the oldest count held blanks to dest
+ */
+static size_t trim_release(TrimState* trim, unsigned char* dest, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        size_t at = (trim->first + i) % CHAIN_HELD_MAX;
+        dest[i] = (trim->tabs[at >> 3] >> (at & 7)) & 1 ? '\t' : ' ';
+    }
+    trim->first = (trim->first + count) % CHAIN_HELD_MAX;
+    trim->held -= count;
+    return count;
+}
+
+/**
+ * @brief Adds blanks to the held run, passing on the oldest ones that no longer fit
+ */
+static size_t trim_hold(TrimState* trim, unsigned char* dest, const unsigned char* blanks,
+                        size_t length) {
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (trim->held == trim->limit) count += trim_release(trim, dest + count, 1);
+
+        size_t at = (trim->first + trim->held++) % CHAIN_HELD_MAX;
+        unsigned char bit = (unsigned char)(1u << (at & 7));
+        trim->tabs[at >> 3] = blanks[i] == '\t' ? trim->tabs[at >> 3] | bit
+                                                : trim->tabs[at >> 3] & (unsigned char)~bit;
+    }
+    return count;
+}
+
+static void trim_drop(TrimState* trim) {
+    trim->held = 0;
+}
+
+static size_t trim_apply(unsigned char* dest, const unsigned char* source, size_t length,
+                         void* state) {
+    TrimState* trim = state;
+    size_t count = 0;
+    if (!source) {
+        trim_drop(trim);
+        return 0;
+    }
+
+    const unsigned char* end = source + length;
+    while (source < end) {
+        const unsigned char* newline = memchr(source, '\n', (size_t)(end - source));
+        const unsigned char* line_end = newline ? newline : end;
+        const unsigned char* last = line_end;
+        while (last > source && is_blank(last[-1])) last--;
+
+        /* Blanks held from before stand only if this piece has more text */
+        if (last > source) {
+            count += trim_release(trim, dest + count, trim->held);
+            memcpy(dest + count, source, (size_t)(last - source));
+            count += (size_t)(last - source);
+        }
+        if (newline) {
+            trim_drop(trim);
+            dest[count++] = '\n';
+            source = newline + 1;
+        } else {
+            count += trim_hold(trim, dest + count, last, (size_t)(end - last));
+            source = end;
+        }
+    }
+    return count;
+}
+
+static size_t run_stage(Chain* chain, const ChainStage* stage, unsigned char* dest,
+                        const unsigned char* source, size_t length) {
+    if (!stage->apply) return source ? run_map(stage, dest, source, length) : 0;
+    return stage->apply(dest, source, length, chain->state + stage->state_offset);
+}
+
+/**
+ * @brief Runs a block through every stage, one cache-sized tile at a time
+ */
+static size_t chain_filter(unsigned char* dest, const unsigned char* source, size_t length,
+                           void* context) {
+    Chain* chain = context;
+    unsigned char tiles[2][CHAIN_TILE + CHAIN_STATE_SIZE + CHAIN_HELD_MAX];
+    size_t written = 0;
+    size_t offset = 0;
+
+    do {
+        size_t count = length - offset < CHAIN_TILE ? length - offset : CHAIN_TILE;
+        const unsigned char* in = source ? source + offset : NULL;
+        for (size_t i = 0; i < chain->stage_count; i++) {
+            const ChainStage* stage = &chain->stages[i];
+            unsigned char* out = i + 1 == chain->stage_count ? dest + written : tiles[i & 1];
+            count = in ? run_stage(chain, stage, out, in, count) : 0;
+            /* At the end every stage flushes after taking what came before it */
+            if (!source) count += run_stage(chain, stage, out + count, NULL, 0);
+            in = out;
+        }
+        written += count;
+        offset += CHAIN_TILE;
+    } while (offset < length);
+
+    return written;
+}
+
+void chain_init(Chain* chain) {
+    chain->stage_count = 0;
+    chain->state_used = 0;
+}
+
+/**
+ * @brief Appends a stage with its state, or returns NULL if the chain is full
+ */
+static ChainStage* chain_push(Chain* chain, ChainApply apply, const void* state,
+                              size_t state_size) {
+    size_t align = _Alignof(max_align_t);
+    size_t offset = (chain->state_used + align - 1) / align * align;
+    if (chain->stage_count == CHAIN_MAX_STAGES || offset + state_size > CHAIN_STATE_SIZE) {
+        return NULL;
+    }
+
+    ChainStage* stage = &chain->stages[chain->stage_count++];
+    stage->apply = apply;
+    stage->state_offset = offset;
+    if (state) {
+        memcpy(chain->state + offset, state, state_size);
+    } else {
+        memset(chain->state + offset, 0, state_size);
+    }
+    chain->state_used = offset + state_size;
+    return stage;
+}
+
+/**
+ * @brief Returns the last stage if it is a map, or appends an identity map
+ */
+static ChainStage* chain_map_stage(Chain* chain) {
+    if (chain->stage_count > 0 && !chain->stages[chain->stage_count - 1].apply) {
+        return &chain->stages[chain->stage_count - 1];
+    }
+
+    ChainStage* stage = chain_push(chain, NULL, NULL, 0);
+    if (!stage) return NULL;
+    for (int c = 0; c < 256; c++) {
+        stage->table[c] = (unsigned char)c;
+    }
+    memset(stage->drop, 0, sizeof(stage->drop));
+    stage->drops = false;
+    return stage;
+}
+
+bool chain_add_map(Chain* chain, const unsigned char table[256]) {
+    ChainStage* stage = chain_map_stage(chain);
+    if (!stage) return false;
+
+    for (int c = 0; c < 256; c++) {
+        stage->table[c] = table[stage->table[c]];
+    }
+    classify_map(stage);
+    return true;
+}
+
+static bool chain_add_case(Chain* chain, unsigned char first) {
+    unsigned char table[256];
+    for (int c = 0; c < 256; c++) {
+        table[c] = (unsigned char)((unsigned)(c - first) < 26 ? c ^ 0x20 : c);
+    }
+    return chain_add_map(chain, table);
+}
+
+bool chain_add_lowercase(Chain* chain) {
+    return chain_add_case(chain, 'A');
+}
+
+bool chain_add_uppercase(Chain* chain) {
+    return chain_add_case(chain, 'a');
+}
+
+bool chain_add_delete(Chain* chain, const bool set[256]) {
+    ChainStage* stage = chain_map_stage(chain);
+    if (!stage) return false;
+
+    for (int c = 0; c < 256; c++) {
+        if (set[stage->table[c]]) {
+            stage->drop[c >> 3] |= (unsigned char)(1u << (c & 7));
+            stage->drops = true;
+        }
+    }
+    classify_map(stage);
+    return true;
+}
+
+bool chain_add_capitalize(Chain* chain) {
+    return chain_add(chain, capitalize_apply, NULL, sizeof(CapitalizeState));
+}
+
+bool chain_add_crlf(Chain* chain) {
+    return chain_add(chain, crlf_apply, NULL, sizeof(CrlfState));
+}
+
+bool chain_add_trim(Chain* chain) {
+    TrimState trim = { 0, 0, CHAIN_HELD_MAX, { 0 } };
+    if (!chain_add(chain, trim_apply, &trim, sizeof(TrimState))) return false;
+
+    /* Every trim stage may spill at once, so they share the held bound */
+    size_t trims = 0;
+    for (size_t i = 0; i < chain->stage_count; i++) {
+        trims += chain->stages[i].apply == trim_apply;
+    }
+    for (size_t i = 0; i < chain->stage_count; i++) {
+        if (chain->stages[i].apply == trim_apply) {
+            TrimState* state = (TrimState*)(chain->state + chain->stages[i].state_offset);
+            state->limit = CHAIN_HELD_MAX / trims;
+        }
+    }
+    return true;
+}
+
+bool chain_add(Chain* chain, ChainApply apply, const void* state, size_t state_size) {
+    return chain_push(chain, apply, state, state_size) != NULL;
+}
+
+void chain_stream(Chain* chain, StreamTransform* transform) {
+    StreamTransform stream = { NULL, NULL, 0, NULL, NULL };
+    ChainStage* first = &chain->stages[0];
+
+    if (chain->stage_count == 1 && !first->apply && !first->drops) {
+        stream.apply = first->map;
+        stream.context = first->table;
+    } else if (chain->stage_count == 1 && first->apply == capitalize_apply) {
+        stream.apply = transform_capitalize;
+        stream.context = chain->state + first->state_offset;
+        stream.state_size = sizeof(CapitalizeState);
+        stream.resume = transform_capitalize_resume;
+    } else if (chain->stage_count > 0) {
+        stream.filter = chain_filter;
+        stream.context = chain;
+        stream.state_size = sizeof(Chain);
+    }
+    *transform = stream;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file converter_chain.h
+ * @brief Fused transform chains for the file converter
+ * @author Jaden Mardini
+ *
+ * A chain is an ordered list of byte-level stages run as a single pass:
+ * every tile of a block (small enough to stay in cache) goes through all
+ * stages before the next tile is read, so the block is read from memory
+ * and written back once however many stages there are.
+ *
+ * Byte maps and deletions added next to each other are folded into one
+ * table lookup when they are added, and a lone ASCII case map keeps the
+ * SIMD kernels.  Stages may shorten their output (CRLF to LF, trimming,
+ * deleting) and hold bytes back from one call to the next.  All stage
+ * state lives inside the Chain, so copying one copies the stream position.
+ */
+
+#ifndef CONVERTER_CHAIN_H
+#define CONVERTER_CHAIN_H
+
+#include "converter_stream.h"
+#include <stddef.h>
+
+#define CHAIN_MAX_STAGES 8
+#define CHAIN_STATE_SIZE 16384          /* State bytes shared by the stages of a chain */
+#define CHAIN_HELD_MAX ((size_t)32 << 10) /* Blanks the trim stages of a chain hold back */
+
+/**
+ * @brief A chain stage
+ * @param dest Output, never overlapping source
+ * @param source Input, or NULL once at the end of the input
+ * @param length Bytes of input
+ * @param state The stage's state inside the chain
+ * @return Bytes written; more than length only by bytes held back before
+ */
+typedef size_t (*ChainApply)(unsigned char* dest, const unsigned char* source, size_t length,
+                             void* state);
+
+typedef struct {
+    ChainApply apply;                   /* NULL for a byte map */
+    StreamApply map;                    /* Byte map kernel when nothing is dropped */
+    unsigned char table[256];           /* Byte map */
+    unsigned char drop[32];             /* Bytes deleted before mapping, as a bit set */
+    bool drops;
+    size_t state_offset;
+} ChainStage;
+
+typedef struct {
+    ChainStage stages[CHAIN_MAX_STAGES];
+    size_t stage_count;
+    size_t state_used;
+    _Alignas(max_align_t) unsigned char state[CHAIN_STATE_SIZE];
+} Chain;
+
+/**
+ * @brief Starts an empty chain, which copies bytes unchanged
+ */
+void chain_init(Chain* chain);
+
+/**
+ * @brief Adds a stage mapping every byte through table
+ * @return false if the chain is full
+ */
+bool chain_add_map(Chain* chain, const unsigned char table[256]);
+
+/**
+ * @brief Adds ASCII lowercase conversion
+ */
+bool chain_add_lowercase(Chain* chain);
+
+/**
+ * @brief Adds ASCII uppercase conversion
+ */
+bool chain_add_uppercase(Chain* chain);
+
+/**
+ * @brief Adds word capitalization (see converter_transform.h)
+ */
+bool chain_add_capitalize(Chain* chain);
+
+/**
+ * @brief Adds a stage deleting every byte c with set[c] true
+ */
+bool chain_add_delete(Chain* chain, const bool set[256]);
+
+/**
+ * @brief Adds a stage turning CRLF line ends into LF; a lone CR is kept
+ */
+bool chain_add_crlf(Chain* chain);
+
+/**
+ * @brief Adds a stage removing spaces and tabs before every LF and at the end
+ *
+ * A blank run crossing a tile or block boundary is held back one bit per
+ * blank, so it is removed exactly up to CHAIN_HELD_MAX bytes (shared by all
+ * trim stages) whatever its mix of spaces and tabs.  Beyond that the oldest
+ * blanks are passed on, since a run that may still go on has to be stored
+ * and written out whole.
+ */
+bool chain_add_trim(Chain* chain);
+
+/**
+ * @brief Adds a custom stage
+ * @param apply Stage function
+ * @param state Initial state copied into the chain, or NULL for zeroes
+ * @param state_size Bytes of state
+ * @return false if the chain is full
+ */
+bool chain_add(Chain* chain, ChainApply apply, const void* state, size_t state_size);
+
+/**
+ * @brief Describes the chain as a stream transform
+ *
+ * A single length-preserving stage becomes a plain kernel, so it keeps
+ * the in-place and parallel paths; anything else runs as a filter over
+ * the chain, which must outlive the transform.
+ */
+void chain_stream(Chain* chain, StreamTransform* transform);
+
+#endif /* CONVERTER_CHAIN_H */
@@ -0,0 +1,498 @@
+/**
+ * @file converter_stream.c
+ * @brief Block Streaming Implementation
+ * @author Jaden Mardini
+ */
+
+#define _GNU_SOURCE /* copy_file_range, splice, F_SETPIPE_SZ, syncfs */
+
+#include "converter_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define KERNEL_COPY_CHUNK ((size_t)1 << 30)
+#define PIPE_BUFFER_SIZE (1 << 20)        /* Requested capacity of pipe ends */
+#define TEMP_NAME_ATTEMPTS 16
+
+typedef enum {
+    KERNEL_COPY_DONE,
+    KERNEL_COPY_UNSUPPORTED,            /* Nothing copied; use the block path */
+    KERNEL_COPY_FAILED
+} KernelCopy;
+
+/**
+ * @brief Sleeps until a nonblocking descriptor inherited from the caller is ready
+ */
+static bool wait_ready(int fd, short events) {
+    struct pollfd poll_fd = { fd, events, 0 };
+    while (poll(&poll_fd, 1, -1) < 0) {
+        if (errno != EINTR) return false;
+    }
+    return true;
+}
+
+static bool write_all(int fd, const unsigned char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_ready(fd, POLLOUT)) continue;
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+static bool pwrite_all(int fd, const unsigned char* data, size_t length, off_t offset) {
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+        offset += written;
+    }
+    return true;
+}
+
+/**
+ * @brief Copies the rest of source_fd in the kernel, without user-space buffers
+ */
+static KernelCopy copy_in_kernel(int source_fd, int dest_fd, uint64_t* copied) {
+    for (;;) {
+        ssize_t moved = copy_file_range(source_fd, NULL, dest_fd, NULL, KERNEL_COPY_CHUNK, 0);
+        if (moved > 0) {
+            *copied += (uint64_t)moved;
+            continue;
+        }
+        if (moved == 0) return KERNEL_COPY_DONE;
+        if (errno == EINTR) continue;
+
+        /* Pipes, cross-filesystem copies and old kernels refuse up front */
+        if (*copied == 0 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+                             errno == EOPNOTSUPP || errno == EBADF)) {
+            return KERNEL_COPY_UNSUPPORTED;
+        }
+        return KERNEL_COPY_FAILED;
+    }
+}
+
+/**
+ * @brief Moves data through a pipe end in the kernel, without user-space buffers
+ */
+static KernelCopy splice_in_kernel(int source_fd, int dest_fd, size_t block_size,
+                                   uint64_t* copied) {
+    for (;;) {
+        ssize_t moved = splice(source_fd, NULL, dest_fd, NULL, block_size,
+                               SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (moved > 0) {
+            *copied += (uint64_t)moved;
+            continue;
+        }
+        if (moved == 0) return KERNEL_COPY_DONE;
+        if (errno == EINTR) continue;
+        if (*copied == 0 && errno == EINVAL) return KERNEL_COPY_UNSUPPORTED;
+        return KERNEL_COPY_FAILED;
+    }
+}
+
+/**
+ * @brief Transforms a mapped file into block-sized writes
+ */
+static bool stream_mapped(const unsigned char* data, size_t size, int dest_fd,
+                          const StreamTransform* transform, unsigned char* block,
+                          size_t block_size, uint64_t* done) {
+    for (size_t offset = 0; offset < size; ) {
+        size_t length = size - offset < block_size ? size - offset : block_size;
+        const unsigned char* out = data + offset;
+        size_t count = length;
+        if (transform->filter) {
+            count = transform->filter(block, out, length, transform->context);
+            out = block;
+        } else if (transform->apply) {
+            transform->apply(block, out, length, transform->context);
+            out = block;
+        }
+        if (!write_all(dest_fd, out, count)) return false;
+
+        offset += length;
+        *done += count;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes whatever a filter held back until the end of the input
+ */
+static bool stream_flush(int dest_fd, const StreamTransform* transform, unsigned char* out,
+                         uint64_t* done) {
+    if (!transform->filter) return true;
+
+    size_t count = transform->filter(out, NULL, 0, transform->context);
+    *done += count;
+    return write_all(dest_fd, out, count);
+}
+
+/* Shared state of a parallel conversion */
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+    int dest_fd;
+    off_t dest_offset;                  /* Where data[0] lands in the output */
+    const StreamTransform* transform;
+    size_t block_size;
+    size_t next_chunk;                  /* Next chunk to claim (atomic) */
+    int error;                          /* First errno seen, 0 if none (atomic) */
+} ParallelJob;
+
+static void parallel_fail(ParallelJob* job, int error) {
+    int expected = 0;
+    __atomic_compare_exchange_n(&job->error, &expected, error, false,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Claims chunks until none are left, writing each at its own offset
+ */
+static void* parallel_worker(void* arg) {
+    ParallelJob* job = arg;
+    const StreamTransform* transform = job->transform;
+    unsigned char* block = malloc(job->block_size);
+    void* state = transform->state_size ? malloc(transform->state_size) : transform->context;
+    if (!block || (transform->state_size && !state)) {
+        if (transform->state_size) free(state);
+        free(block);
+        parallel_fail(job, ENOMEM);
+        return NULL;
+    }
+
+    while (!__atomic_load_n(&job->error, __ATOMIC_RELAXED)) {
+        size_t chunk = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED);
+        if (chunk >= (job->size + job->block_size - 1) / job->block_size) break;
+
+        size_t offset = chunk * job->block_size;
+        size_t length = job->size - offset < job->block_size ? job->size - offset
+                                                              : job->block_size;
+        if (transform->state_size) {
+            memcpy(state, transform->context, transform->state_size);
+            transform->resume(state, job->data, offset);
+        }
+        transform->apply(block, job->data + offset, length, state);
+        if (!pwrite_all(job->dest_fd, block, length, job->dest_offset + (off_t)offset)) {
+            parallel_fail(job, errno);
+            break;
+        }
+    }
+
+    if (transform->state_size) free(state);
+    free(block);
+    return NULL;
+}
+
+/**
+ * @brief Transforms a mapped file on several threads; the caller is one of them
+ */
+static bool stream_parallel(const unsigned char* data, size_t size, int dest_fd,
+                            const StreamTransform* transform, const StreamOptions* options,
+                            uint64_t* done) {
+    ParallelJob job = { data, size, dest_fd, lseek(dest_fd, 0, SEEK_CUR), transform,
+                        options->block_size, 0, 0 };
+    if (job.dest_offset < 0) return false;
+
+    pthread_t workers[STREAM_MAX_THREADS];
+    unsigned int started = 0;
+    unsigned int threads = options->threads < STREAM_MAX_THREADS ? options->threads
+                                                                 : STREAM_MAX_THREADS;
+    while (started + 1 < threads &&
+           pthread_create(&workers[started], NULL, parallel_worker, &job) == 0) {
+        started++;
+    }
+    parallel_worker(&job);
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    if (job.error) {
+        errno = job.error;
+        return false;
+    }
+    /* Leave the offset where a sequential write would have */
+    if (lseek(dest_fd, job.dest_offset + (off_t)size, SEEK_SET) < 0) return false;
+    *done = size;
+    return true;
+}
+
+/**
+ * @brief Transforms whatever each read returns in place and writes it out
+ *
+ * A short read from a pipe is passed on at once rather than held back to
+ * fill the block, so a downstream stage never waits on this one.
+ */
+static bool stream_read(int source_fd, int dest_fd, const StreamTransform* transform,
+                        unsigned char* block, unsigned char* filtered, size_t block_size,
+                        uint64_t* done) {
+    for (;;) {
+        ssize_t got = read(source_fd, block, block_size);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_ready(source_fd, POLLIN)) {
+                continue;
+            }
+            return false;
+        }
+        if (got == 0) return true;
+
+        const unsigned char* out = block;
+        size_t count = (size_t)got;
+        if (transform->filter) {
+            count = transform->filter(filtered, block, count, transform->context);
+            out = filtered;
+        } else if (transform->apply) {
+            transform->apply(block, block, count, transform->context);
+        }
+        if (!write_all(dest_fd, out, count)) return false;
+        *done += count;
+    }
+}
+
+/**
+ * @brief Whether a regular file is mapped: larger than a block and read from its start
+ */
+static bool stream_mappable(int source_fd, const struct stat* info, size_t block_size) {
+    return S_ISREG(info->st_mode) && (uint64_t)info->st_size > block_size &&
+           (uint64_t)info->st_size <= SIZE_MAX && lseek(source_fd, 0, SEEK_CUR) == 0;
+}
+
+/**
+ * @brief Positional writes need a seekable output that does not force appends
+ */
+static bool stream_positional(int dest_fd) {
+    return lseek(dest_fd, 0, SEEK_CUR) >= 0 && !(fcntl(dest_fd, F_GETFL) & O_APPEND);
+}
+
+bool stream_splits(int source_fd, int dest_fd, const StreamTransform* transform,
+                   size_t block_size) {
+    struct stat info;
+    return transform->apply && !transform->filter && fstat(source_fd, &info) == 0 &&
+           stream_mappable(source_fd, &info, block_size) && stream_positional(dest_fd);
+}
+
+bool stream_convert(int source_fd, int dest_fd, const StreamTransform* transform,
+                    const StreamOptions* options, uint64_t* bytes_processed) {
+    size_t block_size = options->block_size;
+    *bytes_processed = 0;
+
+    struct stat info, dest_info;
+    bool regular = fstat(source_fd, &info) == 0 && S_ISREG(info.st_mode);
+    bool source_pipe = !regular && S_ISFIFO(info.st_mode);
+    bool dest_pipe = fstat(dest_fd, &dest_info) == 0 && S_ISFIFO(dest_info.st_mode);
+    bool nonblocking = (fcntl(source_fd, F_GETFL) | fcntl(dest_fd, F_GETFL)) & O_NONBLOCK;
+
+    /* Larger pipes mean fewer wakeups on both sides; the limit may refuse */
+    if (source_pipe) fcntl(source_fd, F_SETPIPE_SZ, PIPE_BUFFER_SIZE);
+    if (dest_pipe) fcntl(dest_fd, F_SETPIPE_SZ, PIPE_BUFFER_SIZE);
+
+    if (!transform->apply && !transform->filter) {
+        KernelCopy copy = copy_in_kernel(source_fd, dest_fd, bytes_processed);
+        /* splice would spin on EAGAIN with a nonblocking end; use poll instead */
+        if (copy == KERNEL_COPY_UNSUPPORTED && (source_pipe || dest_pipe) && !nonblocking) {
+            copy = splice_in_kernel(source_fd, dest_fd, block_size, bytes_processed);
+        }
+        if (copy != KERNEL_COPY_UNSUPPORTED) return copy == KERNEL_COPY_DONE;
+    }
+
+    /* A file that fits in one block is cheaper to read than to map */
+    unsigned char* data = MAP_FAILED;
+    size_t size = 0;
+    if (regular && stream_mappable(source_fd, &info, block_size)) {
+        size = (size_t)info.st_size;
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, source_fd, 0);
+    }
+
+    if (data != MAP_FAILED && transform->apply && !transform->filter && options->threads > 1 &&
+        stream_positional(dest_fd)) {
+        madvise(data, size, MADV_SEQUENTIAL);
+        bool ok = stream_parallel(data, size, dest_fd, transform, options, bytes_processed);
+        int saved_errno = errno;
+        munmap(data, size);
+        errno = saved_errno;
+        return ok;
+    }
+
+    /* A mapped input is filtered or copied straight from the mapping */
+    bool need_block = data == MAP_FAILED || (transform->apply && !transform->filter);
+    unsigned char* block = options->block;
+    unsigned char* filtered = options->filtered;
+    if (!block && need_block) block = malloc(block_size);
+    if (!filtered && transform->filter) filtered = malloc(block_size + STREAM_FILTER_SLACK);
+    bool ok = (block || !need_block) && (filtered || !transform->filter);
+
+    if (ok && data != MAP_FAILED) {
+        madvise(data, size, MADV_SEQUENTIAL);
+        ok = stream_mapped(data, size, dest_fd, transform, transform->filter ? filtered : block,
+                           block_size, bytes_processed);
+    } else if (ok) {
+        if (!regular || (uint64_t)info.st_size > block_size) {
+            posix_fadvise(source_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+        ok = stream_read(source_fd, dest_fd, transform, block, filtered, block_size,
+                         bytes_processed);
+    }
+    ok = ok && stream_flush(dest_fd, transform, filtered, bytes_processed);
+
+    int saved_errno = errno;
+    if (data != MAP_FAILED) munmap(data, size);
+    if (block != options->block) free(block);
+    if (filtered != options->filtered) free(filtered);
+    errno = saved_errno;
+    return ok;
+}
+
+static unsigned int temp_counter = 0;     /* Distinguishes temporary names (atomic) */
+
+bool stream_output_open(StreamOutput* output, const char* path, uint64_t expected_size) {
+    output->fd = -1;
+    output->reserved = 0;
+
+    /* A symbolic link stays; the file it names is the one replaced */
+    struct stat info;
+    bool exists = lstat(path, &info) == 0;
+    output->path = exists && S_ISLNK(info.st_mode) ? realpath(path, NULL) : strdup(path);
+    if (!output->path) return false;
+    exists = exists && stat(output->path, &info) == 0;
+
+    size_t length = strlen(output->path) + 48;
+    output->temp_path = malloc(length);
+    if (!output->temp_path) {
+        free(output->path);
+        errno = ENOMEM;
+        return false;
+    }
+
+    /* Devices and FIFOs cannot be replaced; they are written in place */
+    if (exists && !S_ISREG(info.st_mode)) {
+        free(output->temp_path);
+        output->temp_path = NULL;
+        output->fd = open(output->path, O_WRONLY | O_TRUNC);
+        if (output->fd < 0) {
+            int error = errno;
+            free(output->path);
+            errno = error;
+            return false;
+        }
+        return true;
+    }
+
+    /* O_EXCL with a fresh name, so the umask applies as for a plain create */
+    for (int attempt = 0; output->fd < 0 && attempt < TEMP_NAME_ATTEMPTS; attempt++) {
+        unsigned int serial = __atomic_fetch_add(&temp_counter, 1, __ATOMIC_RELAXED);
+        snprintf(output->temp_path, length, "%s.%ld.%u.tmp", output->path, (long)getpid(),
+                 serial);
+        output->fd = open(output->temp_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+        if (output->fd < 0 && errno != EEXIST) break;
+    }
+    if (output->fd < 0) {
+        int error = errno;
+        free(output->path);
+        free(output->temp_path);
+        errno = error;
+        return false;
+    }
+
+    /* Keep the owner where permitted, else at least the group; mode last,
+       since a change of owner clears set-id bits */
+    if (exists) {
+        if (fchown(output->fd, info.st_uid, info.st_gid) != 0) {
+            int ignored = fchown(output->fd, (uid_t)-1, info.st_gid);
+            (void)ignored;
+        }
+        fchmod(output->fd, info.st_mode & 07777);
+    }
+
+    /* One extent up front; fails early on a full disk */
+    if (expected_size > 0 && (uint64_t)(off_t)expected_size == expected_size) {
+        int error = posix_fallocate(output->fd, 0, (off_t)expected_size);
+        if (error == 0) {
+            output->reserved = expected_size;
+        } else if (error != EINVAL && error != EOPNOTSUPP) {
+            stream_output_abort(output);
+            errno = error;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool sync_directory_of(const char* path) {
+    const char* slash = strrchr(path, '/');
+    char* directory = slash ? strndup(path, slash == path ? 1 : (size_t)(slash - path))
+                            : strdup(".");
+    if (!directory) return false;
+
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    free(directory);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+bool stream_output_commit(StreamOutput* output, uint64_t written, bool sync_directory) {
+    if (!output->temp_path) {
+        bool closed = close(output->fd) == 0;
+        free(output->path);
+        return closed;
+    }
+
+    bool ok = written >= output->reserved || ftruncate(output->fd, (off_t)written) == 0;
+    ok = ok && fsync(output->fd) == 0;
+    if (!ok) {
+        int error = errno;
+        stream_output_abort(output);
+        errno = error;
+        return false;
+    }
+
+    if (close(output->fd) != 0 || rename(output->temp_path, output->path) != 0) {
+        int error = errno;
+        unlink(output->temp_path);
+        free(output->path);
+        free(output->temp_path);
+        errno = error;
+        return false;
+    }
+
+    ok = !sync_directory || sync_directory_of(output->path);
+    free(output->path);
+    free(output->temp_path);
+    return ok;
+}
+
+void stream_output_abort(StreamOutput* output) {
+    int error = errno;
+    close(output->fd);
+    if (output->temp_path) unlink(output->temp_path);
+    free(output->path);
+    free(output->temp_path);
+    errno = error;
+}
+
+bool stream_sync_filesystem(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = syncfs(fd) == 0;
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file converter_stream.h
+ * @brief Block streaming engine for the file converter
+ * @author Jaden Mardini
+ *
+ * Moves bytes from one descriptor to another without regard to lines or
+ * NUL bytes.  Regular files larger than a block are memory-mapped and
+ * transformed straight into the output block; other inputs are read block
+ * by block.  Without a
+ * transform the kernel copies the data itself (copy_file_range, or splice
+ * when one side is a pipe) where it can.  Nonblocking descriptors are
+ * waited on with poll rather than treated as errors.
+ *
+ * With several threads a mapped input is cut into block-sized chunks that
+ * workers claim in turn, transform and write at their own offset, so one
+ * worker's write overlaps the others' transforms.
+ *
+ * A filter may change the length of the data.  It always writes to a
+ * separate buffer and runs sequentially, since output offsets are only
+ * known once everything before them has been filtered.
+ */
+
+#ifndef CONVERTER_STREAM_H
+#define CONVERTER_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define STREAM_MIN_BLOCK ((size_t)1 << 20)
+#define STREAM_MAX_BLOCK ((size_t)16 << 20)
+#define STREAM_DEFAULT_BLOCK ((size_t)4 << 20)
+#define STREAM_MAX_THREADS 256
+#define STREAM_FILTER_SLACK ((size_t)64 << 10) /* Output a filter may add per call */
+
+/* Transforms length bytes of source into dest; dest may equal source */
+typedef void (*StreamApply)(unsigned char* dest, const unsigned char* source,
+                            size_t length, void* context);
+
+/* Rebuilds a transform's state for a chunk starting at data + offset */
+typedef void (*StreamResume)(void* state, const unsigned char* data, size_t offset);
+
+/*
+ * Filters length bytes of source into dest and returns the bytes written,
+ * at most length + STREAM_FILTER_SLACK; called once more with source NULL
+ * at the end of the input to flush anything held back
+ */
+typedef size_t (*StreamFilter)(unsigned char* dest, const unsigned char* source,
+                               size_t length, void* context);
+
+/*
+ * A stateful transform keeps state_size bytes of state in context, carried
+ * from one block to the next.  Parallel workers start each chunk from a
+ * copy of context passed through resume.
+ */
+typedef struct {
+    StreamApply apply;                  /* NULL copies the data unchanged */
+    void* context;
+    size_t state_size;                  /* 0 for stateless transforms */
+    StreamResume resume;
+    StreamFilter filter;                /* Used instead of apply when set */
+} StreamTransform;
+
+typedef struct {
+    size_t block_size;                  /* Bytes per read, write and chunk */
+    unsigned int threads;               /* Workers for mapped input (1 = sequential) */
+    unsigned char* block;               /* Reusable block_size buffer, or NULL */
+    unsigned char* filtered;            /* Reusable block_size + STREAM_FILTER_SLACK
+                                           buffer for filter output, or NULL */
+} StreamOptions;
+
+/*
+ * Destination file written under a temporary name in the same directory
+ * and renamed over the real one once complete and synced, so readers and
+ * crashes see the old file or the new one, never a partial write.
+ */
+typedef struct {
+    int fd;
+    char* path;                         /* Final name */
+    char* temp_path;                    /* Name while being written */
+    uint64_t reserved;                  /* Bytes preallocated */
+} StreamOutput;
+
+/**
+ * @brief Creates the temporary file for path, preallocated to expected_size
+ * @param output Filled in on success
+ * @param path Destination; if it exists its owner (where permitted), group
+ *             and permissions carry over.  A symbolic link is followed and
+ *             the file it names replaced; a dangling one fails with ENOENT
+ * @param expected_size Size to preallocate, 0 if unknown
+ * @return false with errno set
+ */
+bool stream_output_open(StreamOutput* output, const char* path, uint64_t expected_size);
+
+/**
+ * @brief Syncs the data, renames it over the destination and closes it
+ * @param output Open output; released either way
+ * @param written Bytes written, to trim any preallocation beyond them
+ * @param sync_directory Also sync the directory entry; callers committing
+ *                       many files can call stream_sync_filesystem once instead
+ * @return false with errno set; the temporary file is then removed and
+ *         the destination left untouched
+ */
+bool stream_output_commit(StreamOutput* output, uint64_t written, bool sync_directory);
+
+/**
+ * @brief Closes and removes the temporary file, leaving the destination untouched
+ */
+void stream_output_abort(StreamOutput* output);
+
+/**
+ * @brief Flushes everything written to the filesystem holding path
+ */
+bool stream_sync_filesystem(const char* path);
+
+/**
+ * @brief Tells whether stream_convert would split this conversion across threads
+ *
+ * Only a transform that keeps the length (no filter, not a plain copy)
+ * over a regular file larger than block_size, read from its start and
+ * written to a seekable output, is cut into chunks.  Anything else runs
+ * on one thread whatever StreamOptions.threads says.
+ */
+bool stream_splits(int source_fd, int dest_fd, const StreamTransform* transform,
+                   size_t block_size);
+
+/**
+ * @brief Streams source_fd into dest_fd through a transform
+ * @param source_fd Descriptor to read from its current offset
+ * @param dest_fd Descriptor to write at its current offset
+ * @param transform Transform applied to every byte
+ * @param options Block size and thread count
+ * @param bytes_processed Set to the number of bytes written
+ * @return false on an I/O or allocation error, with errno set
+ */
+bool stream_convert(int source_fd, int dest_fd, const StreamTransform* transform,
+                    const StreamOptions* options, uint64_t* bytes_processed);
+
+#endif /* CONVERTER_STREAM_H */
@@ -0,0 +1,232 @@
+/**
+ * @file converter_transform.c
+ * @brief Transform Kernel Implementation
+ * @author Jaden Mardini
+ *
+ * A byte c is in the 26-letter range starting at first exactly when
+ * c + (0x80 - first), taken as a signed byte, is below -128 + 26; the
+ * case bit 0x20 is flipped under that mask.
+ *
+ * The capitalize kernels compare each vector with the same bytes loaded
+ * one position earlier, so every lane sees its predecessor.  Converting
+ * in place is safe: a byte rewritten by the previous step only changes
+ * case, which never changes whether it belongs to a word.
+ */
+
+#include "converter_transform.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+#define CASE_BIT 0x20
+
+static void case_scalar(unsigned char* dest, const unsigned char* source, size_t length,
+                        unsigned char first) {
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = source[i];
+        dest[i] = c ^ (unsigned char)(((unsigned char)(c - first) < 26) << 5);
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("sse2")))
+static void case_sse2(unsigned char* dest, const unsigned char* source, size_t length,
+                      unsigned char first) {
+    const __m128i shift = _mm_set1_epi8((char)(0x80 - first));
+    const __m128i limit = _mm_set1_epi8(-128 + 26);
+    const __m128i flip = _mm_set1_epi8(CASE_BIT);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(source + i));
+        __m128i letter = _mm_cmpgt_epi8(limit, _mm_add_epi8(c, shift));
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_xor_si128(c, _mm_and_si128(letter, flip)));
+    }
+    case_scalar(dest + i, source + i, length - i, first);
+}
+
+__attribute__((target("avx2")))
+static void case_avx2(unsigned char* dest, const unsigned char* source, size_t length,
+                      unsigned char first) {
+    const __m256i shift = _mm256_set1_epi8((char)(0x80 - first));
+    const __m256i limit = _mm256_set1_epi8(-128 + 26);
+    const __m256i flip = _mm256_set1_epi8(CASE_BIT);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(source + i));
+        __m256i letter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(c, shift));
+        _mm256_storeu_si256((__m256i*)(dest + i),
+                            _mm256_xor_si256(c, _mm256_and_si256(letter, flip)));
+    }
+    case_scalar(dest + i, source + i, length - i, first);
+}
+#endif
+
+static bool is_letter(unsigned char c) {
+    return (unsigned char)((c | CASE_BIT) - 'a') < 26;
+}
+
+static bool is_word_byte(unsigned char c) {
+    return is_letter(c) || (unsigned char)(c - '0') < 10 || c == '\'';
+}
+
+static void capitalize_scalar(unsigned char* dest, const unsigned char* source, size_t length,
+                              bool in_word) {
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = source[i];
+        bool word = is_word_byte(c);
+        if (is_letter(c)) {
+            c = in_word ? (unsigned char)(c | CASE_BIT) : (unsigned char)(c & ~CASE_BIT);
+        }
+        dest[i] = c;
+        in_word = word;
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+/* Requires source[-1] to be readable */
+__attribute__((target("sse2")))
+static void capitalize_sse2(unsigned char* dest, const unsigned char* source, size_t length) {
+    const __m128i bit = _mm_set1_epi8(CASE_BIT);
+    const __m128i letter_shift = _mm_set1_epi8((char)(0x80 - 'a'));
+    const __m128i digit_shift = _mm_set1_epi8((char)(0x80 - '0'));
+    const __m128i letters = _mm_set1_epi8(-128 + 26);
+    const __m128i digits = _mm_set1_epi8(-128 + 10);
+    const __m128i apostrophe = _mm_set1_epi8('\'');
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(source + i));
+        __m128i p = _mm_loadu_si128((const __m128i*)(source + i - 1));
+        __m128i letter = _mm_cmpgt_epi8(letters, _mm_add_epi8(_mm_or_si128(c, bit), letter_shift));
+        __m128i in_word = _mm_or_si128(
+            _mm_or_si128(_mm_cmpgt_epi8(letters, _mm_add_epi8(_mm_or_si128(p, bit), letter_shift)),
+                         _mm_cmpgt_epi8(digits, _mm_add_epi8(p, digit_shift))),
+            _mm_cmpeq_epi8(p, apostrophe));
+        __m128i letter_bit = _mm_and_si128(letter, bit);
+        __m128i lowered = _mm_or_si128(c, letter_bit);
+        __m128i starts = _mm_andnot_si128(in_word, letter_bit);
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_andnot_si128(starts, lowered));
+    }
+    if (i < length) {
+        capitalize_scalar(dest + i, source + i, length - i, is_word_byte(source[i - 1]));
+    }
+}
+
+/* Requires source[-1] to be readable */
+__attribute__((target("avx2")))
+static void capitalize_avx2(unsigned char* dest, const unsigned char* source, size_t length) {
+    const __m256i bit = _mm256_set1_epi8(CASE_BIT);
+    const __m256i letter_shift = _mm256_set1_epi8((char)(0x80 - 'a'));
+    const __m256i digit_shift = _mm256_set1_epi8((char)(0x80 - '0'));
+    const __m256i letters = _mm256_set1_epi8(-128 + 26);
+    const __m256i digits = _mm256_set1_epi8(-128 + 10);
+    const __m256i apostrophe = _mm256_set1_epi8('\'');
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(source + i));
+        __m256i p = _mm256_loadu_si256((const __m256i*)(source + i - 1));
+        __m256i letter = _mm256_cmpgt_epi8(letters,
+                                           _mm256_add_epi8(_mm256_or_si256(c, bit), letter_shift));
+        __m256i in_word = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpgt_epi8(letters, _mm256_add_epi8(_mm256_or_si256(p, bit), letter_shift)),
+                _mm256_cmpgt_epi8(digits, _mm256_add_epi8(p, digit_shift))),
+            _mm256_cmpeq_epi8(p, apostrophe));
+        __m256i letter_bit = _mm256_and_si256(letter, bit);
+        __m256i lowered = _mm256_or_si256(c, letter_bit);
+        __m256i starts = _mm256_andnot_si256(in_word, letter_bit);
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_andnot_si256(starts, lowered));
+    }
+    if (i < length) {
+        capitalize_scalar(dest + i, source + i, length - i, is_word_byte(source[i - 1]));
+    }
+}
+#endif
+
+typedef enum {
+    KERNEL_SCALAR,
+    KERNEL_SSE2,
+    KERNEL_AVX2
+} KernelLevel;
+
+static const char* const KERNEL_NAMES[] = { "scalar", "sse2", "avx2" };
+
+/* The CPU check reads a flag set up at startup; once per block is free */
+static KernelLevel kernel_level(void) {
+#ifdef HAVE_X86_KERNELS
+    if (__builtin_cpu_supports("avx2")) return KERNEL_AVX2;
+    if (__builtin_cpu_supports("sse2")) return KERNEL_SSE2;
+#endif
+    return KERNEL_SCALAR;
+}
+
+static void convert_case(unsigned char* dest, const unsigned char* source, size_t length,
+                         unsigned char first) {
+    switch (kernel_level()) {
+#ifdef HAVE_X86_KERNELS
+        case KERNEL_AVX2:
+            case_avx2(dest, source, length, first);
+            return;
+        case KERNEL_SSE2:
+            case_sse2(dest, source, length, first);
+            return;
+#endif
+        default:
+            case_scalar(dest, source, length, first);
+    }
+}
+
+void transform_lowercase(unsigned char* dest, const unsigned char* source, size_t length,
+                         void* context) {
+    (void)context;
+    convert_case(dest, source, length, 'A');
+}
+
+void transform_uppercase(unsigned char* dest, const unsigned char* source, size_t length,
+                         void* context) {
+    (void)context;
+    convert_case(dest, source, length, 'a');
+}
+
+void transform_capitalize(unsigned char* dest, const unsigned char* source, size_t length,
+                          void* context) {
+    CapitalizeState* state = context;
+    if (length == 0) return;
+
+    /* Read before an in-place conversion could touch it */
+    bool ends_in_word = is_word_byte(source[length - 1]);
+
+    /* The first byte depends on the carried state, the rest on their predecessor */
+    capitalize_scalar(dest, source, 1, state->in_word);
+    switch (kernel_level()) {
+#ifdef HAVE_X86_KERNELS
+        case KERNEL_AVX2:
+            capitalize_avx2(dest + 1, source + 1, length - 1);
+            break;
+        case KERNEL_SSE2:
+            capitalize_sse2(dest + 1, source + 1, length - 1);
+            break;
+#endif
+        default:
+            capitalize_scalar(dest + 1, source + 1, length - 1, is_word_byte(source[0]));
+    }
+    state->in_word = ends_in_word;
+}
+
+void transform_capitalize_resume(void* state, const unsigned char* data, size_t offset) {
+    CapitalizeState* capitalize = state;
+    capitalize->in_word = offset > 0 && is_word_byte(data[offset - 1]);
+}
+
+void transform_table(unsigned char* dest, const unsigned char* source, size_t length,
+                     void* context) {
+    const unsigned char* table = context;
+    for (size_t i = 0; i < length; i++) {
+        dest[i] = table[source[i]];
+    }
+}
+
+const char* transform_kernel_name(void) {
+    return KERNEL_NAMES[kernel_level()];
+}
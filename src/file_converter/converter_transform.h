@@ -0,0 +1,62 @@
+/**
+ * @file converter_transform.h
+ * @brief Byte transform kernels for the file converter
+ * @author Jaden Mardini
+ *
+ * ASCII case conversion runs 32 (AVX2) or 16 (SSE2) bytes per step,
+ * chosen at run time from what the CPU supports, with a scalar fallback
+ * everywhere else.  Bytes outside A-Z/a-z pass through unchanged.  All
+ * kernels match the StreamApply signature; dest may equal source.
+ *
+ * Capitalization uppercases the first letter of every word and lowercases
+ * the rest, a word being a run of ASCII letters, digits and apostrophes.
+ * Whether a byte starts a word depends only on the byte before it, so the
+ * state carried across blocks is a single flag.
+ */
+
+#ifndef CONVERTER_TRANSFORM_H
+#define CONVERTER_TRANSFORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Capitalization state carried from one block to the next */
+typedef struct {
+    bool in_word;                       /* Last byte seen belongs to a word */
+} CapitalizeState;
+
+/**
+ * @brief Lowercases ASCII letters (context unused)
+ */
+void transform_lowercase(unsigned char* dest, const unsigned char* source, size_t length,
+                         void* context);
+
+/**
+ * @brief Uppercases ASCII letters (context unused)
+ */
+void transform_uppercase(unsigned char* dest, const unsigned char* source, size_t length,
+                         void* context);
+
+/**
+ * @brief Capitalizes words, continuing from the CapitalizeState in context
+ */
+void transform_capitalize(unsigned char* dest, const unsigned char* source, size_t length,
+                          void* context);
+
+/**
+ * @brief Sets a CapitalizeState for a chunk starting at data + offset
+ */
+void transform_capitalize_resume(void* state, const unsigned char* data, size_t offset);
+
+/**
+ * @brief Maps every byte through a 256-entry table passed as context
+ */
+void transform_table(unsigned char* dest, const unsigned char* source, size_t length,
+                     void* context);
+
+/**
+ * @brief Names the case kernel this CPU uses: "avx2", "sse2" or "scalar"
+ */
+const char* transform_kernel_name(void);
+
+#endif /* CONVERTER_TRANSFORM_H */
@@ -7,108 +7,296 @@
  * memory management, and support for various text transformations.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include "converter_batch.h"
+#include "converter_chain.h"
+#include "converter_stream.h"
+#include "converter_transform.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <locale.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
-#define BUFFER_SIZE 4096
 #define MAX_PATH_LENGTH 512
 
 typedef enum {
     TRANSFORM_LOWERCASE,
     TRANSFORM_UPPERCASE,
-    TRANSFORM_CAPITALIZE
+    TRANSFORM_CAPITALIZE,
+    TRANSFORM_NONE,
+    TRANSFORM_CRLF,
+    TRANSFORM_TRIM,
+    TRANSFORM_DELETE
 } TransformType;
 
+/* One transform of the chain given on the command line */
+typedef struct {
+    TransformType type;
+    bool set[256];                      /* Bytes removed by TRANSFORM_DELETE */
+} TransformStep;
+
 typedef struct {
     char source_path[MAX_PATH_LENGTH];
     char dest_path[MAX_PATH_LENGTH];
-    TransformType transform;
+    char** inputs;                      /* Batch mode inputs (files, directories) */
+    size_t input_count;
+    const char* output_dir;             /* Batch mode when set */
+    const char* list_path;              /* Batch mode list of inputs */
+    TransformStep steps[CHAIN_MAX_STAGES]; /* Applied in order, in one pass */
+    size_t step_count;
+    size_t block_size;                  /* Bytes per read and write */
+    unsigned int threads;               /* Conversion threads for -j */
+    bool use_locale;                    /* Case rules of the user's locale, not ASCII */
     bool verbose;
 } ProcessingConfig;
 
-/**
- * @brief Validates file paths and accessibility
- */
-static bool validate_files(const char* source, const char* dest) {
-    if (!source || !dest) {
-        fprintf(stderr, "Error: Invalid file paths provided\n");
-        return false;
-    }
-    
-    FILE* test_source = fopen(source, "r");
-    if (!test_source) {
-        fprintf(stderr, "Error: Cannot open source file '%s': %s\n", 
-                source, strerror(errno));
-        return false;
-    }
-    fclose(test_source);
-    
-    return true;
-}
-
 /**
  * @brief Applies text transformation to a character
  */
-static char transform_char(char c, TransformType transform) {
+static unsigned char transform_char(unsigned char c, TransformType transform) {
     switch (transform) {
         case TRANSFORM_LOWERCASE:
             return tolower(c);
         case TRANSFORM_UPPERCASE:
             return toupper(c);
         case TRANSFORM_CAPITALIZE:
-            return c; /* Handled at word level */
+            return c; /* Handled at word level by transform_capitalize */
         default:
             return c;
     }
 }
 
+/* Stream transform for a configuration, with the chain it points to */
+typedef struct {
+    StreamTransform stream;
+    Chain chain;
+} TransformSetup;
+
+/**
+ * @brief Builds the chain of configured transformations
+ */
+static bool setup_transform(const ProcessingConfig* config, TransformSetup* setup) {
+    bool ok = true;
+    chain_init(&setup->chain);
+    
+    for (size_t i = 0; ok && i < config->step_count; i++) {
+        const TransformStep* step = &config->steps[i];
+        switch (step->type) {
+            case TRANSFORM_LOWERCASE:
+            case TRANSFORM_UPPERCASE:
+                if (config->use_locale) {
+                    /* Locale rules apply byte by byte, so tabulate them once */
+                    unsigned char table[256];
+                    for (int c = 0; c < 256; c++) {
+                        table[c] = transform_char((unsigned char)c, step->type);
+                    }
+                    ok = chain_add_map(&setup->chain, table);
+                } else if (step->type == TRANSFORM_LOWERCASE) {
+                    ok = chain_add_lowercase(&setup->chain);
+                } else {
+                    ok = chain_add_uppercase(&setup->chain);
+                }
+                break;
+            case TRANSFORM_CAPITALIZE:
+                ok = chain_add_capitalize(&setup->chain);
+                break;
+            case TRANSFORM_CRLF:
+                ok = chain_add_crlf(&setup->chain);
+                break;
+            case TRANSFORM_TRIM:
+                ok = chain_add_trim(&setup->chain);
+                break;
+            case TRANSFORM_DELETE:
+                ok = chain_add_delete(&setup->chain, step->set);
+                break;
+            default:
+                break;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Too many transforms in one chain\n");
+        return false;
+    }
+    
+    chain_stream(&setup->chain, &setup->stream);
+    return true;
+}
+
 /**
  * @brief Processes file with specified transformation
  */
 static bool process_file(const ProcessingConfig* config) {
-    FILE* source = fopen(config->source_path, "r");
-    FILE* dest = fopen(config->dest_path, "w");
+    TransformSetup setup;
+    if (!setup_transform(config, &setup)) return false;
+    
+    bool from_stdin = strcmp(config->source_path, "-") == 0;
+    bool to_stdout = strcmp(config->dest_path, "-") == 0;
+    
+    int source = from_stdin ? STDIN_FILENO : open(config->source_path, O_RDONLY);
+    if (source < 0) {
+        fprintf(stderr, "Error: Cannot open source file '%s': %s\n",
+                config->source_path, strerror(errno));
+        return false;
+    }
     
-    if (!source || !dest) {
-        if (source) fclose(source);
-        if (dest) fclose(dest);
-        fprintf(stderr, "Error: Failed to open files for processing\n");
+    /* A file destination is replaced atomically once complete */
+    struct stat info;
+    uint64_t expected_size = fstat(source, &info) == 0 && S_ISREG(info.st_mode)
+                                 ? (uint64_t)info.st_size : 0;
+    StreamOutput output = { STDOUT_FILENO, NULL, NULL, 0 };
+    if (!to_stdout && !stream_output_open(&output, config->dest_path, expected_size)) {
+        fprintf(stderr, "Error: Cannot open destination file '%s': %s\n",
+                config->dest_path, strerror(errno));
+        if (!from_stdin) close(source);
         return false;
     }
     
-    char buffer[BUFFER_SIZE];
-    size_t bytes_processed = 0;
+    /* Say so rather than silently running on one thread */
+    if (config->threads > 1 &&
+        !stream_splits(source, output.fd, &setup.stream, config->block_size)) {
+        fprintf(stderr, "Warning: -j has no effect here; only case conversion of a regular "
+                        "file larger than one block is split across threads\n");
+    }
     
-    while (fgets(buffer, sizeof(buffer), source)) {
-        size_t len = strlen(buffer);
-        
-        for (size_t i = 0; i < len; i++) {
-            buffer[i] = transform_char(buffer[i], config->transform);
-        }
-        
-        if (fputs(buffer, dest) == EOF) {
-            fprintf(stderr, "Error: Failed to write to destination file\n");
-            fclose(source);
-            fclose(dest);
-            return false;
+    StreamOptions options = { config->block_size, config->threads, NULL, NULL };
+    uint64_t bytes_processed = 0;
+    bool ok = stream_convert(source, output.fd, &setup.stream, &options, &bytes_processed);
+    if (!from_stdin) close(source);
+    if (!to_stdout) {
+        if (ok) {
+            ok = stream_output_commit(&output, bytes_processed, true);
+        } else {
+            stream_output_abort(&output);
         }
-        
-        bytes_processed += len;
     }
     
-    fclose(source);
-    fclose(dest);
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to write to destination file: %s\n", strerror(errno));
+        return false;
+    }
     
     if (config->verbose) {
-        printf("Successfully processed %zu bytes\n", bytes_processed);
-        printf("Source: %s\n", config->source_path);
-        printf("Destination: %s\n", config->dest_path);
+        FILE* report = to_stdout ? stderr : stdout;
+        fprintf(report, "Successfully processed %" PRIu64 " bytes\n", bytes_processed);
+        fprintf(report, "Source: %s\n", config->source_path);
+        fprintf(report, "Destination: %s\n", config->dest_path);
+        fprintf(report, "Case rules: %s\n",
+                config->use_locale ? "locale" : transform_kernel_name());
+    }
+    
+    return true;
+}
+
+/**
+ * @brief Converts many files into the output directory
+ */
+static bool process_batch(const ProcessingConfig* config) {
+    TransformSetup setup;
+    if (!setup_transform(config, &setup)) return false;
+    
+    BatchOptions options = { config->output_dir, config->list_path, config->block_size,
+                             config->threads, config->verbose };
+    BatchResult result;
+    bool ok = batch_convert(config->inputs, config->input_count, &setup.stream, &options,
+                            &result);
+    
+    printf("Converted %zu of %zu files (%" PRIu64 " bytes)\n",
+           result.files - result.failures, result.files, result.bytes);
+    return ok;
+}
+
+/**
+ * @brief Parses a block size such as 4M, 2048K or 1048576
+ */
+static bool parse_block_size(const char* text, size_t* block_size) {
+    char* end;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno != 0 || end == text) return false;
+    
+    if (*end == 'K' || *end == 'k') {
+        value <<= 10;
+        end++;
+    } else if (*end == 'M' || *end == 'm') {
+        value <<= 20;
+        end++;
+    }
+    if (*end != '\0' || value < STREAM_MIN_BLOCK || value > STREAM_MAX_BLOCK) return false;
+    
+    *block_size = (size_t)value;
+    return true;
+}
+
+/**
+ * @brief Parses one byte of a set: a character, \n, \r, \t, \\, \- or \xHH
+ */
+static bool parse_set_byte(const char** text, unsigned char* byte) {
+    const char* p = *text;
+    if (p[0] != '\\') {
+        *byte = (unsigned char)p[0];
+        *text = p + 1;
+        return true;
     }
     
+    switch (p[1]) {
+        case 'n': *byte = '\n'; break;
+        case 'r': *byte = '\r'; break;
+        case 't': *byte = '\t'; break;
+        case '\\': *byte = '\\'; break;
+        case '-': *byte = '-'; break;
+        case 'x': {
+            if (!isxdigit((unsigned char)p[2]) || !isxdigit((unsigned char)p[3])) return false;
+            char hex[3] = { p[2], p[3], '\0' };
+            *byte = (unsigned char)strtoul(hex, NULL, 16);
+            *text = p + 4;
+            return true;
+        }
+        default:
+            return false;
+    }
+    *text = p + 2;
+    return true;
+}
+
+/**
+ * @brief Parses a byte set such as 'aeiou', 'a-z' or '\x00-\x1f'
+ */
+static bool parse_byte_set(const char* text, bool set[256]) {
+    memset(set, 0, 256 * sizeof(bool));
+    if (*text == '\0') return false;
+    
+    while (*text != '\0') {
+        unsigned char low, high;
+        if (!parse_set_byte(&text, &low)) return false;
+        high = low;
+        if (text[0] == '-' && text[1] != '\0') {
+            text++;
+            if (!parse_set_byte(&text, &high) || high < low) return false;
+        }
+        for (int c = low; c <= high; c++) {
+            set[c] = true;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Appends a transform to the chain
+ */
+static bool add_step(ProcessingConfig* config, TransformType type) {
+    if (config->step_count == CHAIN_MAX_STAGES) {
+        fprintf(stderr, "Error: At most %d transforms can be chained\n", CHAIN_MAX_STAGES);
+        return false;
+    }
+    config->steps[config->step_count++].type = type;
     return true;
 }
 
@@ -116,20 +304,42 @@ static bool process_file(const ProcessingConfig* config) {
  * @brief Displays usage information
  */
 static void show_usage(const char* program_name) {
-    printf("Usage: %s [OPTIONS] <source_file> <destination_file>\n\n", program_name);
-    printf("Options:\n");
-    printf("  -l, --lowercase    Convert text to lowercase (default)\n");
+    printf("Usage: %s [OPTIONS] <source_file|-> <destination_file|->\n", program_name);
+    printf("       %s [OPTIONS] -o <output_dir> [-f <list_file>] [inputs...]\n\n",
+           program_name);
+    printf("Transforms run in the order given, fused into one pass (default: -l):\n");
+    printf("  -l, --lowercase    Convert text to lowercase\n");
     printf("  -u, --uppercase    Convert text to uppercase\n");
+    printf("  -C, --capitalize   Capitalize every word (ASCII rules)\n");
+    printf("  -n, --crlf         Convert CRLF line ends to LF\n");
+    printf("  -t, --trim         Remove spaces and tabs at the end of every line\n");
+    printf("  -d, --delete SET   Delete bytes in SET, e.g. 'aeiou', 'a-z', '\\x00-\\x08'\n");
+    printf("  -c, --copy         No case conversion; copy bytes unchanged when alone\n\n");
+    printf("Options:\n");
+    printf("  -L, --locale       Use the locale's case rules instead of ASCII\n");
+    printf("  -j, --jobs N       Convert on N threads (default: 1); a single file is\n");
+    printf("                     split only for case conversion of a regular file\n");
+    printf("                     over one block, with -o N files run at once\n");
+    printf("  -o, --output-dir D Convert every input file or directory tree into D\n");
+    printf("  -f, --files-from F With -o, also convert the paths listed in F ('-' = stdin)\n");
+    printf("  -B, --block-size N Read/write block size, 1M-16M (default: 4M)\n");
     printf("  -v, --verbose      Enable verbose output\n");
     printf("  -h, --help         Show this help message\n\n");
     printf("Examples:\n");
     printf("  %s input.txt output.txt\n", program_name);
     printf("  %s -u input.txt output.txt\n", program_name);
     printf("  %s --verbose input.txt output.txt\n", program_name);
+    printf("  %s -u -j 8 -o converted/ logs/\n", program_name);
+    printf("  %s -n -t -u input.txt output.txt\n", program_name);
+    printf("  zcat input.gz | %s -u - - | less\n", program_name);
 }
 
 /**
  * @brief Parses command line arguments
+ *
+ * Options may appear anywhere; the remaining arguments are the source and
+ * destination, or the inputs of batch mode.  They are gathered in place at
+ * the front of argv (after the program name).
  */
 static bool parse_arguments(int argc, char* argv[], ProcessingConfig* config) {
     if (argc < 3) {
@@ -138,41 +348,102 @@ static bool parse_arguments(int argc, char* argv[], ProcessingConfig* config) {
     }
     
     /* Initialize config with defaults */
-    config->transform = TRANSFORM_LOWERCASE;
+    config->inputs = argv + 1;
+    config->input_count = 0;
+    config->output_dir = NULL;
+    config->list_path = NULL;
+    config->step_count = 0;
+    config->block_size = STREAM_DEFAULT_BLOCK;
+    config->threads = 1;
+    config->use_locale = false;
     config->verbose = false;
     
-    int file_arg_start = 1;
-    
     /* Parse options */
-    for (int i = 1; i < argc - 2; i++) {
-        if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--lowercase") == 0) {
-            config->transform = TRANSFORM_LOWERCASE;
-            file_arg_start++;
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (argv[i][0] != '-' || argv[i][1] == '\0') {
+            config->inputs[config->input_count++] = argv[i];
+        } else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--lowercase") == 0) {
+            if (!add_step(config, TRANSFORM_LOWERCASE)) return false;
         } else if (strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--uppercase") == 0) {
-            config->transform = TRANSFORM_UPPERCASE;
-            file_arg_start++;
+            if (!add_step(config, TRANSFORM_UPPERCASE)) return false;
+        } else if (strcmp(argv[i], "-C") == 0 || strcmp(argv[i], "--capitalize") == 0) {
+            if (!add_step(config, TRANSFORM_CAPITALIZE)) return false;
+        } else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--copy") == 0) {
+            if (!add_step(config, TRANSFORM_NONE)) return false;
+        } else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--crlf") == 0) {
+            if (!add_step(config, TRANSFORM_CRLF)) return false;
+        } else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--trim") == 0) {
+            if (!add_step(config, TRANSFORM_TRIM)) return false;
+        } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--delete") == 0) {
+            if (!add_step(config, TRANSFORM_DELETE)) return false;
+            if (!has_value ||
+                !parse_byte_set(argv[i + 1], config->steps[config->step_count - 1].set)) {
+                fprintf(stderr, "Error: Invalid byte set for --delete\n");
+                return false;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-L") == 0 || strcmp(argv[i], "--locale") == 0) {
+            config->use_locale = true;
+        } else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) {
+            char* end = NULL;
+            unsigned long threads = has_value ? strtoul(argv[i + 1], &end, 10) : 0;
+            if (!end || *end != '\0' || threads < 1 || threads > STREAM_MAX_THREADS) {
+                fprintf(stderr, "Error: Job count must be between 1 and %d\n",
+                        STREAM_MAX_THREADS);
+                return false;
+            }
+            config->threads = (unsigned int)threads;
+            i++;
+        } else if (strcmp(argv[i], "-B") == 0 || strcmp(argv[i], "--block-size") == 0) {
+            if (!has_value || !parse_block_size(argv[i + 1], &config->block_size)) {
+                fprintf(stderr, "Error: Block size must be between 1M and 16M\n");
+                return false;
+            }
+            i++;
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output-dir") == 0) &&
+                   has_value) {
+            config->output_dir = argv[++i];
+        } else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--files-from") == 0) &&
+                   has_value) {
+            config->list_path = argv[++i];
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
             config->verbose = true;
-            file_arg_start++;
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             show_usage(argv[0]);
             return false;
         } else {
-            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            fprintf(stderr, "Error: Unknown or incomplete option '%s'\n", argv[i]);
             return false;
         }
     }
     
+    if (config->step_count == 0) {
+        add_step(config, TRANSFORM_LOWERCASE);
+    }
+    
+    if (config->output_dir) {
+        if (config->input_count == 0 && !config->list_path) {
+            fprintf(stderr, "Error: Batch mode needs inputs or a list file\n");
+            return false;
+        }
+        return true;
+    }
+    if (config->list_path) {
+        fprintf(stderr, "Error: --files-from requires --output-dir\n");
+        return false;
+    }
+    
     /* Ensure we have source and destination files */
-    if (argc - file_arg_start < 2) {
+    if (config->input_count != 2) {
         fprintf(stderr, "Error: Source and destination files required\n");
         show_usage(argv[0]);
         return false;
     }
     
     /* Copy file paths */
-    strncpy(config->source_path, argv[file_arg_start], MAX_PATH_LENGTH - 1);
-    strncpy(config->dest_path, argv[file_arg_start + 1], MAX_PATH_LENGTH - 1);
+    strncpy(config->source_path, config->inputs[0], MAX_PATH_LENGTH - 1);
+    strncpy(config->dest_path, config->inputs[1], MAX_PATH_LENGTH - 1);
     config->source_path[MAX_PATH_LENGTH - 1] = '\0';
     config->dest_path[MAX_PATH_LENGTH - 1] = '\0';
     
@@ -189,15 +460,20 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
     
-    if (!validate_files(config.source_path, config.dest_path)) {
-        return EXIT_FAILURE;
+    if (config.use_locale) {
+        setlocale(LC_CTYPE, "");
+    }
+    
+    if (config.output_dir) {
+        return process_batch(&config) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
     
     if (!process_file(&config)) {
         return EXIT_FAILURE;
     }
     
-    if (!config.verbose) {
+    /* Converted data owns stdout when it is the destination */
+    if (!config.verbose && strcmp(config.dest_path, "-") != 0) {
         printf("File processing completed successfully\n");
     }
     
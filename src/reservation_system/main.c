@@ -5,8 +5,104 @@
  */
 
 #include "reservation_system.h"
+#include "reservation_batch.h"
+#include "reservation_server.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#define BATCH_OUTPUT_BUFFER (1 << 16)
+
+/* Command line settings */
+typedef struct {
+    const char* batch_path;             /* NULL for the interactive menu */
+    const char* serve_address;          /* NULL unless serving a socket */
+    ReservationStorage storage;
+    unsigned int sync_every_ops;        /* Batch mode journal fsync interval */
+    ReservationDuplicates duplicates;
+    unsigned int stats_interval_ms;     /* 0 for no statistics dump */
+    ReservationStatsFormat stats_format;
+} ProgramOptions;
+
+/**
+ * @brief Displays usage information
+ */
+static void show_usage(const char* program_name) {
+    printf("Usage: %s [OPTIONS]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -b, --batch FILE     Run commands from FILE ('-' for stdin) instead of the menu\n");
+    printf("  -s, --sync-every N   In batch mode, fsync the journal every N commands\n");
+    printf("                       (default: save once at the end)\n");
+    printf("  -S, --serve ADDRESS  Serve the binary protocol on unix:PATH or tcp:PORT\n");
+    printf("                       (loopback) until interrupted\n");
+    printf("  -m, --mapped         Keep the seat inventory in a memory-mapped file\n");
+    printf("  -D, --duplicates P   Reject bookings of a passenger who already holds a\n");
+    printf("                       seat: 'flight' (same flight), 'all' or 'allow'\n");
+    printf("  -T, --stats MS       Print operation statistics to stderr every MS\n");
+    printf("                       milliseconds and once more on exit\n");
+    printf("      --stats-json     Print the statistics as JSON lines\n");
+    printf("  -h, --help           Show this help message\n\n");
+    printf("Batch commands (one per line):\n");
+    printf("  FLIGHT <flight> <seats>\n");
+    printf("  BOOK <flight> <seat> <first> <last>\n");
+    printf("  CANCEL <flight> <seat>\n");
+    printf("  QUERY <flight> <seat>\n");
+    printf("  LIST <flight>\n");
+    printf("  FIND <first> <last>\n");
+}
+
+/**
+ * @brief Parses command line arguments
+ */
+static bool parse_arguments(int argc, char* argv[], ProgramOptions* options) {
+    options->batch_path = NULL;
+    options->serve_address = NULL;
+    options->storage = RESERVATION_STORAGE_STREAM;
+    options->duplicates = RESERVATION_DUPLICATES_ALLOW;
+    options->sync_every_ops = 0;
+    options->stats_interval_ms = 0;
+    options->stats_format = RESERVATION_STATS_TEXT;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--batch") == 0) && has_value) {
+            options->batch_path = argv[++i];
+        } else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sync-every") == 0) &&
+                   has_value) {
+            options->sync_every_ops = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if ((strcmp(argv[i], "-S") == 0 || strcmp(argv[i], "--serve") == 0) &&
+                   has_value) {
+            options->serve_address = argv[++i];
+        } else if (strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--mapped") == 0) {
+            options->storage = RESERVATION_STORAGE_MAPPED;
+        } else if ((strcmp(argv[i], "-D") == 0 || strcmp(argv[i], "--duplicates") == 0) &&
+                   has_value) {
+            const char* policy = argv[++i];
+            if (strcmp(policy, "flight") == 0) {
+                options->duplicates = RESERVATION_DUPLICATES_PER_FLIGHT;
+            } else if (strcmp(policy, "all") == 0) {
+                options->duplicates = RESERVATION_DUPLICATES_NONE;
+            } else if (strcmp(policy, "allow") == 0) {
+                options->duplicates = RESERVATION_DUPLICATES_ALLOW;
+            } else {
+                fprintf(stderr, "Error: Unknown duplicate policy '%s'\n", policy);
+                return false;
+            }
+        } else if ((strcmp(argv[i], "-T") == 0 || strcmp(argv[i], "--stats") == 0) &&
+                   has_value) {
+            options->stats_interval_ms = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--stats-json") == 0) {
+            options->stats_format = RESERVATION_STATS_JSON;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            show_usage(argv[0]);
+            return false;
+        } else {
+            fprintf(stderr, "Error: Unknown or incomplete option '%s'\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
 
 static void show_menu(void) {
     printf("\n=== Airline Reservation System ===\n");
@@ -68,16 +164,14 @@ static void cancel_seat(ReservationSystem* system) {
 
 static void show_available(ReservationSystem* system) {
     printf("\nAvailable seats: ");
-    bool found = false;
     
-    for (int i = 1; i <= MAX_SEATS; i++) {
-        if (reservation_is_available(system, i)) {
-            printf("%d ", i);
-            found = true;
-        }
+    int seats[MAX_SEATS];
+    int count = reservation_list_available(system, seats, MAX_SEATS);
+    for (int i = 0; i < count; i++) {
+        printf("%d ", seats[i]);
     }
     
-    if (!found) {
+    if (count <= 0) {
         printf("None");
     }
     printf("\n");
@@ -88,37 +182,118 @@ static void show_reservations(ReservationSystem* system) {
     printf("Seat  Name\n");
     printf("----  ----\n");
     
-    Reservation seats[MAX_SEATS];
-    int count = reservation_get_all_seats(system, seats, MAX_SEATS);
-    
-    if (count < 0) {
+    ReservationCursor cursor;
+    if (reservation_cursor_open(system, DEFAULT_FLIGHT_ID, &cursor) != RESERVATION_SUCCESS) {
         printf("Error retrieving reservations\n");
         return;
     }
     
     bool found = false;
-    for (int i = 0; i < count; i++) {
-        if (seats[i].is_reserved) {
-            printf("%-4d  %s %s\n", 
-                   seats[i].seat_number,
-                   seats[i].first_name,
-                   seats[i].last_name);
-            found = true;
-        }
+    const ReservationView* seat;
+    while ((seat = reservation_cursor_next(&cursor)) != NULL) {
+        printf("%-4d  %s %s\n", seat->seat_number, seat->first_name, seat->last_name);
+        found = true;
     }
+    reservation_cursor_close(&cursor);
     
     if (!found) {
         printf("No reservations found\n");
     }
 }
 
-int main(void) {
+/**
+ * @brief Runs a command stream, then saves once
+ */
+static int run_batch(ReservationSystem* system, const char* path) {
+    FILE* input = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!input) {
+        fprintf(stderr, "Error: Cannot open command file '%s'\n", path);
+        return EXIT_FAILURE;
+    }
+
+    /* Fully buffered responses: no per-line flush */
+    static char output_buffer[BATCH_OUTPUT_BUFFER];
+    setvbuf(stdout, output_buffer, _IOFBF, sizeof(output_buffer));
+
+    BatchStats stats;
+    bool ok = batch_run(system, input, stdout, &stats);
+    if (input != stdin) fclose(input);
+
+    ReservationResult result = reservation_system_save(system);
+    if (result != RESERVATION_SUCCESS) {
+        fprintf(stderr, "Error: %s\n", reservation_error_string(result));
+    }
+    fprintf(stderr, "%zu commands, %zu failed\n", stats.commands, stats.failures);
+    return ok && result == RESERVATION_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Serves socket clients, then saves once
+ */
+static int run_server(ReservationSystem* system, const char* address) {
+    /* The server syncs the journal once per event loop round itself */
+    ReservationDurability durability = { 0, 0, RESERVATION_DEFAULT_COMPACT_OPS };
+    reservation_system_set_durability(system, &durability);
+
+    ReservationResult result = reservation_system_load(system);
+    if (result != RESERVATION_SUCCESS) {
+        fprintf(stderr, "Error: %s\n", reservation_error_string(result));
+        return EXIT_FAILURE;
+    }
+    if (!server_run(system, address)) {
+        fprintf(stderr, "Error: Server on '%s' failed; state not saved\n", address);
+        return EXIT_FAILURE;
+    }
+
+    result = reservation_system_save(system);
+    if (result != RESERVATION_SUCCESS) {
+        fprintf(stderr, "Error: %s\n", reservation_error_string(result));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+    ProgramOptions options;
+    if (!parse_arguments(argc, argv, &options)) {
+        return EXIT_FAILURE;
+    }
+
     ReservationSystem* system = reservation_system_create();
     if (!system) {
         fprintf(stderr, "Failed to create reservation system\n");
         return EXIT_FAILURE;
     }
-    
+    reservation_system_set_storage(system, options.storage);
+    reservation_system_set_duplicates(system, options.duplicates);
+    if (options.stats_interval_ms > 0 &&
+        reservation_system_dump_stats(system, stderr, options.stats_interval_ms,
+                                      options.stats_format) != RESERVATION_SUCCESS) {
+        fprintf(stderr, "Warning: Statistics are not available in this build\n");
+    }
+
+    if (options.serve_address) {
+        int status = run_server(system, options.serve_address);
+        reservation_system_destroy(system);
+        return status;
+    }
+
+    if (options.batch_path) {
+        /* Journal without per-command fsync; the final save makes it durable */
+        ReservationDurability durability = { options.sync_every_ops, 0, 0 };
+        reservation_system_set_durability(system, &durability);
+
+        ReservationResult result = reservation_system_load(system);
+        int status = EXIT_FAILURE;
+        if (result == RESERVATION_SUCCESS) {
+            status = run_batch(system, options.batch_path);
+        } else {
+            fprintf(stderr, "Error: %s\n", reservation_error_string(result));
+        }
+        reservation_system_destroy(system);
+        return status;
+    }
+
     reservation_system_load(system);
     
     int choice;
@@ -0,0 +1,227 @@
+/**
+ * @file reservation_batch.c
+ * @brief Command Stream Implementation
+ * @author Jaden Mardini
+ */
+
+#include "reservation_batch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define BATCH_LINE_LENGTH 512
+#define BATCH_MAX_FIELDS 6
+
+typedef enum {
+    COMMAND_FLIGHT,
+    COMMAND_BOOK,
+    COMMAND_CANCEL,
+    COMMAND_QUERY,
+    COMMAND_LIST,
+    COMMAND_FIND,
+    COMMAND_UNKNOWN
+} BatchCommand;
+
+/* Keyword and exact field count (keyword included) of each command */
+static const struct {
+    const char* keyword;
+    int fields;
+} COMMANDS[] = {
+    [COMMAND_FLIGHT] = { "FLIGHT", 3 },
+    [COMMAND_BOOK] = { "BOOK", 5 },
+    [COMMAND_CANCEL] = { "CANCEL", 3 },
+    [COMMAND_QUERY] = { "QUERY", 3 },
+    [COMMAND_LIST] = { "LIST", 2 },
+    [COMMAND_FIND] = { "FIND", 3 },
+};
+
+static bool keyword_equals(const char* word, const char* keyword) {
+    for (; *word && *keyword; word++, keyword++) {
+        int c = (unsigned char)*word;
+        if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        if (c != *keyword) return false;
+    }
+    return *word == *keyword;
+}
+
+static BatchCommand parse_command(const char* word) {
+    for (int i = 0; i < COMMAND_UNKNOWN; i++) {
+        if (keyword_equals(word, COMMANDS[i].keyword)) return (BatchCommand)i;
+    }
+    return COMMAND_UNKNOWN;
+}
+
+/**
+ * @brief Splits a line in place into blank-separated fields
+ * @return Number of fields, or BATCH_MAX_FIELDS + 1 if there are too many
+ */
+static int split_fields(char* line, char** fields) {
+    int count = 0;
+    char* p = line;
+    for (;;) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+        if (*p == '\0') return count;
+        if (count == BATCH_MAX_FIELDS) return BATCH_MAX_FIELDS + 1;
+
+        fields[count++] = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+        if (*p) *p++ = '\0';
+    }
+}
+
+static bool parse_int(const char* text, int* value) {
+    char* end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || parsed < 0 || parsed > 0x7FFFFFFFL) {
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
+static void reply_error(FILE* output, ReservationResult result) {
+    fprintf(output, "ERR %d %s\n", (int)result, reservation_error_string(result));
+}
+
+/* Scratch buffer for LIST, grown to the largest flight listed */
+typedef struct {
+    Reservation* reservations;
+    size_t capacity;
+} ListBuffer;
+
+static ReservationResult run_list(ReservationSystem* system, int flight_id, ListBuffer* buffer,
+                                  FILE* output) {
+    int seats = reservation_flight_seat_count(system, flight_id);
+    if (seats < 0) return RESERVATION_ERROR_INVALID_FLIGHT;
+
+    if ((size_t)seats > buffer->capacity) {
+        Reservation* grown = realloc(buffer->reservations, (size_t)seats * sizeof(Reservation));
+        if (!grown) return RESERVATION_ERROR_MEMORY;
+        buffer->reservations = grown;
+        buffer->capacity = (size_t)seats;
+    }
+
+    int count = reservation_flight_list_sorted(system, flight_id, buffer->reservations,
+                                               buffer->capacity);
+    if (count < 0) return RESERVATION_ERROR_INVALID_FLIGHT;
+
+    fprintf(output, "OK %d\n", count);
+    for (int i = 0; i < count; i++) {
+        const Reservation* seat = &buffer->reservations[i];
+        fprintf(output, "%d %s %s\n", seat->seat_number, seat->first_name, seat->last_name);
+    }
+    return RESERVATION_SUCCESS;
+}
+
+static ReservationResult run_find(ReservationSystem* system, const char* first_name,
+                                  const char* last_name, FILE* output) {
+    if (!reservation_is_valid_name(first_name) || !reservation_is_valid_name(last_name)) {
+        return RESERVATION_ERROR_INVALID_NAME;
+    }
+
+    /* A passenger rarely holds more seats than fit here */
+    ReservationSeat local[64];
+    ReservationSeat* seats = local;
+    size_t capacity = sizeof(local) / sizeof(local[0]);
+    int count = reservation_find_passenger(system, RESERVATION_ANY_FLIGHT, first_name,
+                                           last_name, seats, capacity);
+    if (count > (int)capacity) {
+        capacity = (size_t)count;
+        seats = malloc(capacity * sizeof(ReservationSeat));
+        if (!seats) return RESERVATION_ERROR_MEMORY;
+        count = reservation_find_passenger(system, RESERVATION_ANY_FLIGHT, first_name,
+                                           last_name, seats, capacity);
+    }
+    if (count > (int)capacity) count = (int)capacity;
+
+    fprintf(output, "OK %d\n", count);
+    for (int i = 0; i < count; i++) {
+        fprintf(output, "%d %d\n", seats[i].flight_id, seats[i].seat_number);
+    }
+    if (seats != local) free(seats);
+    return RESERVATION_SUCCESS;
+}
+
+/**
+ * @brief Executes one parsed command and writes its response
+ * @return Result of the command
+ */
+static ReservationResult run_command(ReservationSystem* system, BatchCommand command,
+                                     char** fields, ListBuffer* buffer, FILE* output) {
+    if (command == COMMAND_FIND) return run_find(system, fields[1], fields[2], output);
+
+    int flight_id, value = 0;
+    if (!parse_int(fields[1], &flight_id)) return RESERVATION_ERROR_INVALID_FLIGHT;
+    if (COMMANDS[command].fields > 2 && !parse_int(fields[2], &value)) {
+        return RESERVATION_ERROR_INVALID_SEAT; /* Seat number or seat count */
+    }
+
+    ReservationResult result;
+    Reservation reservation;
+    switch (command) {
+        case COMMAND_FLIGHT:
+            result = reservation_flight_add(system, flight_id, value);
+            break;
+        case COMMAND_BOOK:
+            result = reservation_flight_make(system, flight_id, value, fields[3], fields[4]);
+            break;
+        case COMMAND_CANCEL:
+            result = reservation_flight_cancel(system, flight_id, value);
+            break;
+        case COMMAND_QUERY:
+            result = reservation_flight_get(system, flight_id, value, &reservation);
+            if (result == RESERVATION_SUCCESS) {
+                if (reservation.is_reserved) {
+                    fprintf(output, "TAKEN %s %s\n", reservation.first_name,
+                            reservation.last_name);
+                } else {
+                    fputs("FREE\n", output);
+                }
+                return result;
+            }
+            break;
+        case COMMAND_LIST:
+            return run_list(system, flight_id, buffer, output);
+        default:
+            return RESERVATION_ERROR_SYSTEM;
+    }
+
+    if (result == RESERVATION_SUCCESS) fputs("OK\n", output);
+    return result;
+}
+
+bool batch_run(ReservationSystem* system, FILE* input, FILE* output, BatchStats* stats) {
+    char line[BATCH_LINE_LENGTH];
+    char* fields[BATCH_MAX_FIELDS];
+    ListBuffer buffer = { NULL, 0 };
+    BatchStats counters = { 0, 0 };
+
+    while (fgets(line, sizeof(line), input)) {
+        size_t length = strlen(line);
+        bool truncated = length == sizeof(line) - 1 && line[length - 1] != '\n';
+        if (truncated) {
+            /* Skip the rest of an overlong line; it is answered as malformed */
+            int c;
+            while ((c = fgetc(input)) != EOF && c != '\n') {}
+        }
+
+        int count = split_fields(line, fields);
+        if (count == 0 || fields[0][0] == '#') continue;
+        counters.commands++;
+
+        BatchCommand command = parse_command(fields[0]);
+        ReservationResult result = RESERVATION_ERROR_SYSTEM;
+        if (truncated || command == COMMAND_UNKNOWN || count != COMMANDS[command].fields) {
+            fputs("ERR - Malformed command\n", output);
+        } else {
+            result = run_command(system, command, fields, &buffer, output);
+            if (result != RESERVATION_SUCCESS) reply_error(output, result);
+        }
+        if (result != RESERVATION_SUCCESS) counters.failures++;
+    }
+
+    free(buffer.reservations);
+    if (stats) *stats = counters;
+    return !ferror(input) && fflush(output) == 0 && !ferror(output);
+}
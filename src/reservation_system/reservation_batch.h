@@ -0,0 +1,45 @@
+/**
+ * @file reservation_batch.h
+ * @brief Non-interactive command stream for the reservation system
+ * @author Jaden Mardini
+ *
+ * One command per line, fields separated by blanks, keywords in any case.
+ * Blank lines and lines starting with '#' are skipped.
+ *
+ *   FLIGHT <flight> <seats>             add a flight
+ *   BOOK <flight> <seat> <first> <last> book a seat
+ *   CANCEL <flight> <seat>              cancel a booking
+ *   QUERY <flight> <seat>               FREE, or TAKEN <first> <last>
+ *   LIST <flight>                       OK <n>, then n "<seat> <first> <last>"
+ *                                       lines in name order
+ *   FIND <first> <last>                 OK <n>, then n "<flight> <seat>" lines
+ *                                       for the passenger's seats
+ *
+ * Every command answers with one line (LIST and FIND with n more): OK on success,
+ * ERR <code> <message> with a ReservationResult code, or
+ * "ERR - Malformed command" for a line that does not parse.
+ */
+
+#ifndef RESERVATION_BATCH_H
+#define RESERVATION_BATCH_H
+
+#include "reservation_system.h"
+#include <stdio.h>
+
+/* Counters of a batch run */
+typedef struct {
+    size_t commands;                    /* Commands executed (comments excluded) */
+    size_t failures;                    /* Commands answered with ERR */
+} BatchStats;
+
+/**
+ * @brief Executes every command read from input, answering on output
+ * @param system Loaded reservation system
+ * @param input Command stream
+ * @param output Response stream
+ * @param stats Filled with counters of the run
+ * @return false if reading input or writing output failed
+ */
+bool batch_run(ReservationSystem* system, FILE* input, FILE* output, BatchStats* stats);
+
+#endif /* RESERVATION_BATCH_H */
@@ -0,0 +1,508 @@
+/**
+ * @file reservation_journal.c
+ * @brief Write-Ahead Journal Implementation
+ * @author Jaden Mardini
+ *
+ * File layout: an 8-byte header (magic, version) followed by records of
+ * the form [payload length][FNV-1a checksum of payload][payload], all
+ * integers little-endian.  The payload is the op byte, flight id and
+ * seat value as uint32, and for MAKE two length-prefixed names.  A GROUP
+ * payload is the op byte and a uint32 count followed by that many
+ * complete records, covered by the group's own checksum.
+ *
+ * With a sync interval set, a flusher thread sleeps until the oldest
+ * unsynced record reaches that age and syncs it, so the last records of a
+ * burst do not wait for another append.
+ *
+ * An append that fails, in its write or in the sync the policy asks for,
+ * is cut off the file again so that replay cannot bring it back.  If even
+ * that truncation fails the journal is marked failed and refuses every
+ * later append and sync.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reservation_journal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+#define JOURNAL_MAGIC 0x4A565352u     /* "RSVJ" */
+#define JOURNAL_VERSION 1u
+#define JOURNAL_HEADER_SIZE 8
+#define RECORD_HEADER_SIZE 8
+#define RECORD_MAX_PAYLOAD (1 + 4 + 4 + 2 * (1 + MAX_NAME_LENGTH))
+#define GROUP_HEADER_SIZE 5
+#define GROUP_MAX_RECORDS MAX_FLIGHT_SEATS
+#define GROUP_MAX_PAYLOAD (GROUP_HEADER_SIZE + \
+                           (size_t)GROUP_MAX_RECORDS * (RECORD_HEADER_SIZE + RECORD_MAX_PAYLOAD))
+
+struct ReservationJournal {
+    pthread_mutex_t lock;               /* Guards everything below */
+    int fd;
+    off_t size;                         /* Bytes of intact journal data */
+    size_t record_count;                /* Records since the last reset */
+    size_t unsynced;                    /* Records appended since the last fsync */
+    long long first_unsynced_ms;        /* Monotonic time of oldest unsynced record */
+    ReservationDurability durability;
+    ReservationStatsCollector* stats;
+    pthread_cond_t wake;                /* Signals the flusher on new work or close */
+    pthread_t flusher;
+    bool flusher_running;
+    bool closing;
+    bool failed;                        /* A failed append could not be cut off */
+};
+
+static void put_u32(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+static uint32_t get_u32(const unsigned char* in) {
+    return (uint32_t)in[0] | (uint32_t)in[1] << 8 |
+           (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+uint32_t journal_checksum(const void* data, size_t length) {
+    const unsigned char* bytes = data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static long long monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Waits on the journal's condition until a monotonic time in ms
+ */
+static void wait_until_ms(ReservationJournal* journal, long long deadline_ms) {
+    struct timespec until = {
+        .tv_sec = (time_t)(deadline_ms / 1000),
+        .tv_nsec = (long)(deadline_ms % 1000) * 1000000
+    };
+    pthread_cond_timedwait(&journal->wake, &journal->lock, &until);
+}
+
+static bool write_all(int fd, const unsigned char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+static size_t encode_name(unsigned char* out, const char* name) {
+    size_t length = name ? strlen(name) : 0;
+    if (length >= MAX_NAME_LENGTH) length = MAX_NAME_LENGTH - 1;
+    out[0] = (unsigned char)length;
+    memcpy(out + 1, name, length);
+    return length + 1;
+}
+
+static size_t encode_record(unsigned char* out, const JournalRecord* record) {
+    unsigned char* payload = out + RECORD_HEADER_SIZE;
+    size_t length = 0;
+
+    payload[length++] = (unsigned char)record->op;
+    put_u32(payload + length, (uint32_t)record->flight_id);
+    length += 4;
+    put_u32(payload + length, (uint32_t)record->value);
+    length += 4;
+    if (record->op == JOURNAL_OP_MAKE) {
+        length += encode_name(payload + length, record->first_name);
+        length += encode_name(payload + length, record->last_name);
+    }
+
+    put_u32(out, (uint32_t)length);
+    put_u32(out + 4, journal_checksum(payload, length));
+    return RECORD_HEADER_SIZE + length;
+}
+
+/**
+ * @brief Decodes a checksummed payload; names are copied into the buffers
+ */
+static bool decode_record(const unsigned char* payload, size_t length, JournalRecord* record,
+                          char* first_name, char* last_name) {
+    if (length < 9) return false;
+
+    record->op = (JournalOp)payload[0];
+    record->flight_id = (int)get_u32(payload + 1);
+    record->value = (int)get_u32(payload + 5);
+    record->first_name = NULL;
+    record->last_name = NULL;
+
+    if (record->op != JOURNAL_OP_MAKE) {
+        return record->op >= JOURNAL_OP_CANCEL && record->op <= JOURNAL_OP_FLIGHT_REMOVE;
+    }
+
+    size_t pos = 9;
+    char* names[2] = { first_name, last_name };
+    for (int i = 0; i < 2; i++) {
+        if (pos >= length) return false;
+        size_t name_length = payload[pos++];
+        if (name_length >= MAX_NAME_LENGTH || pos + name_length > length) return false;
+        memcpy(names[i], payload + pos, name_length);
+        names[i][name_length] = '\0';
+        pos += name_length;
+    }
+    record->first_name = first_name;
+    record->last_name = last_name;
+    return pos == length;
+}
+
+ReservationJournal* journal_open(const char* path, const ReservationDurability* durability,
+                                 ReservationStatsCollector* stats) {
+    ReservationJournal* journal = calloc(1, sizeof(ReservationJournal));
+    if (!journal) return NULL;
+    journal->stats = stats;
+
+    journal->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (journal->fd < 0) {
+        free(journal);
+        return NULL;
+    }
+
+    journal->size = lseek(journal->fd, 0, SEEK_END);
+    if (journal->size < JOURNAL_HEADER_SIZE) {
+        unsigned char header[JOURNAL_HEADER_SIZE];
+        put_u32(header, JOURNAL_MAGIC);
+        put_u32(header + 4, JOURNAL_VERSION);
+        stats_add_write(stats, STATS_WRITE_JOURNAL, sizeof(header));
+        stats_add_sync(stats);
+        if (ftruncate(journal->fd, 0) != 0 || !write_all(journal->fd, header, sizeof(header)) ||
+            fsync(journal->fd) != 0) {
+            close(journal->fd);
+            free(journal);
+            return NULL;
+        }
+        journal->size = JOURNAL_HEADER_SIZE;
+    }
+
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&journal->wake, &attributes);
+    pthread_condattr_destroy(&attributes);
+    pthread_mutex_init(&journal->lock, NULL);
+    journal_set_durability(journal, durability);
+    return journal;
+}
+
+void journal_close(ReservationJournal* journal) {
+    if (journal) {
+        pthread_mutex_lock(&journal->lock);
+        journal->closing = true;
+        bool running = journal->flusher_running;
+        pthread_cond_signal(&journal->wake);
+        pthread_mutex_unlock(&journal->lock);
+        if (running) pthread_join(journal->flusher, NULL);
+
+        journal_sync(journal);
+        pthread_cond_destroy(&journal->wake);
+        pthread_mutex_destroy(&journal->lock);
+        close(journal->fd);
+        free(journal);
+    }
+}
+
+/**
+ * @brief Flushes appended records to disk; the caller holds the lock
+ */
+static ReservationResult sync_locked(ReservationJournal* journal) {
+    if (journal->failed) return RESERVATION_ERROR_FILE_IO;
+    if (journal->unsynced == 0) return RESERVATION_SUCCESS;
+
+    stats_add_sync(journal->stats);
+    if (fdatasync(journal->fd) != 0) return RESERVATION_ERROR_FILE_IO;
+    journal->unsynced = 0;
+    return RESERVATION_SUCCESS;
+}
+
+/**
+ * @brief Syncs unsynced records once the oldest reaches the sync interval
+ *
+ * A failed sync leaves the records unsynced; the flusher retries after
+ * another interval and an explicit journal_sync reports the error.
+ */
+static void* flusher_main(void* arg) {
+    ReservationJournal* journal = arg;
+
+    pthread_mutex_lock(&journal->lock);
+    while (!journal->closing) {
+        unsigned int interval = journal->durability.sync_interval_ms;
+        if (interval == 0 || journal->unsynced == 0) {
+            pthread_cond_wait(&journal->wake, &journal->lock);
+            continue;
+        }
+
+        long long deadline = journal->first_unsynced_ms + interval;
+        if (monotonic_ms() < deadline) {
+            wait_until_ms(journal, deadline);
+        } else if (sync_locked(journal) != RESERVATION_SUCCESS) {
+            journal->first_unsynced_ms = monotonic_ms();
+        }
+    }
+    pthread_mutex_unlock(&journal->lock);
+    return NULL;
+}
+
+void journal_set_durability(ReservationJournal* journal, const ReservationDurability* durability) {
+    if (journal && durability) {
+        pthread_mutex_lock(&journal->lock);
+        journal->durability = *durability;
+        /* Without a flusher the interval is still checked on every append */
+        if (durability->sync_interval_ms && !journal->flusher_running) {
+            journal->flusher_running =
+                pthread_create(&journal->flusher, NULL, flusher_main, journal) == 0;
+        }
+        pthread_cond_signal(&journal->wake);
+        pthread_mutex_unlock(&journal->lock);
+    }
+}
+
+ReservationResult journal_sync(ReservationJournal* journal) {
+    if (!journal) return RESERVATION_ERROR_SYSTEM;
+
+    pthread_mutex_lock(&journal->lock);
+    ReservationResult result = sync_locked(journal);
+    pthread_mutex_unlock(&journal->lock);
+    return result;
+}
+
+/**
+ * @brief Cuts the file back to journal->size after a failed append; the
+ *        caller holds the lock
+ */
+static void truncate_locked(ReservationJournal* journal) {
+    if (ftruncate(journal->fd, journal->size) != 0) journal->failed = true;
+}
+
+/**
+ * @brief Writes one encoded record holding the given number of logical
+ *        records; the caller holds the lock
+ */
+static ReservationResult append_locked(ReservationJournal* journal, const unsigned char* buffer,
+                                       size_t length, size_t records) {
+    if (journal->failed) return RESERVATION_ERROR_FILE_IO;
+
+    stats_add_write(journal->stats, STATS_WRITE_JOURNAL, length);
+    if (!write_all(journal->fd, buffer, length)) {
+        /* Drop any partial record so the next append starts cleanly */
+        truncate_locked(journal);
+        return RESERVATION_ERROR_FILE_IO;
+    }
+
+    long long now = monotonic_ms();
+    bool first = journal->unsynced++ == 0;
+    if (first) journal->first_unsynced_ms = now;
+
+    const ReservationDurability* policy = &journal->durability;
+    bool due = (policy->sync_every_ops && journal->unsynced >= policy->sync_every_ops) ||
+               (policy->sync_interval_ms &&
+                now - journal->first_unsynced_ms >= (long long)policy->sync_interval_ms);
+    if (due && sync_locked(journal) != RESERVATION_SUCCESS) {
+        /* The caller reports this record as failed, so it must not replay;
+           earlier unsynced records stay for the next sync */
+        journal->unsynced--;
+        truncate_locked(journal);
+        return RESERVATION_ERROR_FILE_IO;
+    }
+
+    journal->size += (off_t)length;
+    journal->record_count += records;
+    if (first && journal->unsynced > 0 && journal->flusher_running) {
+        pthread_cond_signal(&journal->wake);
+    }
+    return RESERVATION_SUCCESS;
+}
+
+ReservationResult journal_append(ReservationJournal* journal, const JournalRecord* record) {
+    if (!journal || !record) return RESERVATION_ERROR_SYSTEM;
+
+    unsigned char buffer[RECORD_HEADER_SIZE + RECORD_MAX_PAYLOAD];
+    size_t length = encode_record(buffer, record);
+
+    pthread_mutex_lock(&journal->lock);
+    ReservationResult result = append_locked(journal, buffer, length, 1);
+    pthread_mutex_unlock(&journal->lock);
+    return result;
+}
+
+ReservationResult journal_append_group(ReservationJournal* journal,
+                                       const JournalRecord* records, size_t count) {
+    if (!journal || !records || count > GROUP_MAX_RECORDS) return RESERVATION_ERROR_SYSTEM;
+    if (count == 0) return RESERVATION_SUCCESS;
+
+    unsigned char* buffer = malloc(RECORD_HEADER_SIZE + GROUP_HEADER_SIZE +
+                                   count * (RECORD_HEADER_SIZE + RECORD_MAX_PAYLOAD));
+    if (!buffer) return RESERVATION_ERROR_MEMORY;
+
+    unsigned char* payload = buffer + RECORD_HEADER_SIZE;
+    payload[0] = JOURNAL_OP_GROUP;
+    put_u32(payload + 1, (uint32_t)count);
+    size_t length = GROUP_HEADER_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        length += encode_record(payload + length, &records[i]);
+    }
+    put_u32(buffer, (uint32_t)length);
+    put_u32(buffer + 4, journal_checksum(payload, length));
+
+    pthread_mutex_lock(&journal->lock);
+    ReservationResult result = append_locked(journal, buffer, RECORD_HEADER_SIZE + length, count);
+    pthread_mutex_unlock(&journal->lock);
+    free(buffer);
+    return result;
+}
+
+ReservationResult journal_reset(ReservationJournal* journal) {
+    if (!journal) return RESERVATION_ERROR_SYSTEM;
+
+    ReservationResult result = RESERVATION_SUCCESS;
+    pthread_mutex_lock(&journal->lock);
+    stats_add_sync(journal->stats);
+    if (ftruncate(journal->fd, JOURNAL_HEADER_SIZE) != 0 || fsync(journal->fd) != 0) {
+        result = RESERVATION_ERROR_FILE_IO;
+    } else {
+        journal->size = JOURNAL_HEADER_SIZE;
+        journal->record_count = 0;
+        journal->unsynced = 0;
+        journal->failed = false;
+    }
+    pthread_mutex_unlock(&journal->lock);
+    return result;
+}
+
+size_t journal_record_count(ReservationJournal* journal) {
+    if (!journal) return 0;
+
+    pthread_mutex_lock(&journal->lock);
+    size_t count = journal->record_count;
+    pthread_mutex_unlock(&journal->lock);
+    return count;
+}
+
+/**
+ * @brief Walks the records of a GROUP payload, checking each one; when
+ *        apply is non-NULL each record is also handed to it
+ * @return true if the group is well formed
+ */
+static bool walk_group(const unsigned char* payload, size_t length, JournalReplayFn apply,
+                       void* context, char* first_name, char* last_name) {
+    if (length < GROUP_HEADER_SIZE) return false;
+
+    uint32_t count = get_u32(payload + 1);
+    size_t pos = GROUP_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++) {
+        if (length - pos < RECORD_HEADER_SIZE) return false;
+
+        JournalRecord record;
+        uint32_t record_length = get_u32(payload + pos);
+        const unsigned char* record_payload = payload + pos + RECORD_HEADER_SIZE;
+        if (record_length > length - pos - RECORD_HEADER_SIZE ||
+            journal_checksum(record_payload, record_length) != get_u32(payload + pos + 4) ||
+            !decode_record(record_payload, record_length, &record, first_name, last_name)) {
+            return false;
+        }
+
+        if (apply) apply(context, &record);
+        pos += RECORD_HEADER_SIZE + record_length;
+    }
+    return pos == length;
+}
+
+ReservationResult journal_replay(const char* path, JournalReplayFn apply, void* context) {
+    if (!path || !apply) return RESERVATION_ERROR_SYSTEM;
+
+    FILE* file = fopen(path, "rb");
+    if (!file) return RESERVATION_SUCCESS; /* No journal yet */
+
+    unsigned char header[JOURNAL_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+        fclose(file);
+        return RESERVATION_SUCCESS; /* Header never made it to disk */
+    }
+    if (get_u32(header) != JOURNAL_MAGIC || get_u32(header + 4) != JOURNAL_VERSION) {
+        fclose(file);
+        return RESERVATION_ERROR_FILE_IO;
+    }
+
+    size_t capacity = RECORD_MAX_PAYLOAD;
+    unsigned char* payload = malloc(capacity);
+    if (!payload) {
+        fclose(file);
+        return RESERVATION_ERROR_MEMORY;
+    }
+    char first_name[MAX_NAME_LENGTH];
+    char last_name[MAX_NAME_LENGTH];
+    long intact = JOURNAL_HEADER_SIZE;
+    bool torn = false;
+    bool out_of_memory = false;
+
+    for (;;) {
+        unsigned char record_header[RECORD_HEADER_SIZE];
+        size_t got = fread(record_header, 1, sizeof(record_header), file);
+        if (got == 0) break;
+
+        uint32_t length = got == sizeof(record_header) ? get_u32(record_header) : 0;
+        if (length > capacity && length <= GROUP_MAX_PAYLOAD) {
+            unsigned char* grown = realloc(payload, length);
+            if (!grown) {
+                out_of_memory = true; /* Not a torn record: keep the file */
+                break;
+            }
+            payload = grown;
+            capacity = length;
+        }
+
+        JournalRecord record;
+        if (length == 0 || length > capacity ||
+            fread(payload, 1, length, file) != length ||
+            journal_checksum(payload, length) != get_u32(record_header + 4)) {
+            torn = true;
+            break;
+        }
+
+        if (payload[0] == JOURNAL_OP_GROUP) {
+            /* Check every member before applying any of them */
+            if (!walk_group(payload, length, NULL, NULL, first_name, last_name)) {
+                torn = true;
+                break;
+            }
+            walk_group(payload, length, apply, context, first_name, last_name);
+        } else if (decode_record(payload, length, &record, first_name, last_name)) {
+            apply(context, &record);
+        } else {
+            torn = true;
+            break;
+        }
+        intact += RECORD_HEADER_SIZE + (long)length;
+    }
+    free(payload);
+    fclose(file);
+
+    if (out_of_memory) return RESERVATION_ERROR_MEMORY;
+    if (torn && truncate(path, intact) != 0) {
+        return RESERVATION_ERROR_FILE_IO;
+    }
+    return RESERVATION_SUCCESS;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file reservation_journal.h
+ * @brief Append-only write-ahead journal for the reservation system
+ * @author Jaden Mardini
+ *
+ * Internal interface used by reservation_system.c.  Every state change is
+ * appended here before it is applied in memory; the journal is replayed on
+ * top of the last snapshot at load time and truncated after each snapshot.
+ * A journal handle may be shared between threads; appends are serialized.
+ */
+
+#ifndef RESERVATION_JOURNAL_H
+#define RESERVATION_JOURNAL_H
+
+#include "reservation_system.h"
+#include "reservation_stats.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Journal record types */
+typedef enum {
+    JOURNAL_OP_MAKE = 1,
+    JOURNAL_OP_CANCEL,
+    JOURNAL_OP_FLIGHT_ADD,
+    JOURNAL_OP_FLIGHT_REMOVE,
+    JOURNAL_OP_GROUP                    /* On disk only: records applied all or nothing */
+} JournalOp;
+
+/* Decoded journal record */
+typedef struct {
+    JournalOp op;
+    int flight_id;
+    int value;                          /* Seat number, or seat count for FLIGHT_ADD */
+    const char* first_name;             /* MAKE only */
+    const char* last_name;              /* MAKE only */
+} JournalRecord;
+
+typedef struct ReservationJournal ReservationJournal;
+
+/* Callback applying one replayed record; errors are ignored by the replay */
+typedef void (*JournalReplayFn)(void* context, const JournalRecord* record);
+
+/**
+ * @brief Opens (creating if needed) a journal for appending
+ * @param path Journal file path
+ * @param durability Initial fsync policy
+ * @param stats Collector counting appended bytes and syncs (may be NULL)
+ * @return Journal handle or NULL on failure
+ */
+ReservationJournal* journal_open(const char* path, const ReservationDurability* durability,
+                                 ReservationStatsCollector* stats);
+
+/**
+ * @brief Syncs pending records and closes the journal
+ * @param journal Journal handle (may be NULL)
+ */
+void journal_close(ReservationJournal* journal);
+
+/**
+ * @brief Replaces the fsync policy of an open journal
+ */
+void journal_set_durability(ReservationJournal* journal, const ReservationDurability* durability);
+
+/**
+ * @brief Appends one record, syncing according to the durability policy
+ * @return RESERVATION_SUCCESS, or RESERVATION_ERROR_FILE_IO with the file
+ *         left as it was before the call, also when the write went through
+ *         but the sync failed; if the record cannot be cut off again, every
+ *         later append and sync fails instead
+ */
+ReservationResult journal_append(ReservationJournal* journal, const JournalRecord* record);
+
+/**
+ * @brief Appends records as one group, written and synced as a single
+ *        record; replay delivers either all of them or none
+ * @return RESERVATION_SUCCESS, RESERVATION_ERROR_MEMORY, or
+ *         RESERVATION_ERROR_FILE_IO with the file left as it was
+ */
+ReservationResult journal_append_group(ReservationJournal* journal,
+                                       const JournalRecord* records, size_t count);
+
+/**
+ * @brief Forces any unsynced records to stable storage
+ */
+ReservationResult journal_sync(ReservationJournal* journal);
+
+/**
+ * @brief Discards all records after their effects reached a snapshot
+ */
+ReservationResult journal_reset(ReservationJournal* journal);
+
+/**
+ * @brief Gets the number of records appended since the last reset
+ */
+size_t journal_record_count(ReservationJournal* journal);
+
+/**
+ * @brief Replays every intact record of a journal file in order
+ * @param path Journal file path (a missing file replays nothing)
+ * @param apply Callback invoked for each record
+ * @param context Opaque pointer passed to the callback
+ * @return RESERVATION_SUCCESS, or an error if the file header is unreadable
+ *
+ * A torn or corrupt record ends the replay and is cut off the file so that
+ * later appends follow the last intact record.
+ */
+ReservationResult journal_replay(const char* path, JournalReplayFn apply, void* context);
+
+/**
+ * @brief 32-bit FNV-1a checksum, shared with the other on-disk formats
+ */
+uint32_t journal_checksum(const void* data, size_t length);
+
+#endif /* RESERVATION_JOURNAL_H */
@@ -0,0 +1,193 @@
+/**
+ * @file reservation_names.c
+ * @brief Interned Name Pool Implementation
+ * @author Jaden Mardini
+ *
+ * A handle is (chunk << NAME_CHUNK_BITS) | offset.  Names never straddle
+ * two chunks, and the chunk table has a slot for every possible chunk, so
+ * neither is ever reallocated under a reader.  Byte 0 of chunk 0 is the
+ * empty string that NAME_NONE points at.
+ *
+ * The lookup tables are split by hash into NAME_STRIPES open-addressing
+ * tables, at most 3/4 full, whose entries carry the hash so that growing
+ * does not touch the names.  Lock order is stripe, then arena.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reservation_names.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define NAME_CHUNK_BITS 16
+#define NAME_CHUNK_SIZE ((size_t)1 << NAME_CHUNK_BITS)
+#define NAME_MAX_CHUNKS ((size_t)1 << (32 - NAME_CHUNK_BITS))
+#define NAME_STRIPES 16
+
+typedef struct {
+    uint32_t hash;
+    NameHandle handle;                  /* NAME_NONE for an empty slot */
+} NameEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    NameEntry* entries;
+    size_t capacity;                    /* Power of two, or 0 before first use */
+    size_t count;
+} NameStripe;
+
+struct NamePool {
+    NameStripe stripes[NAME_STRIPES];
+    pthread_mutex_t arena_lock;         /* Guards the fields below */
+    size_t chunk_count;
+    size_t offset;                      /* Next free byte of the last chunk */
+    size_t used;                        /* Bytes of every name, terminators included */
+    char* chunks[NAME_MAX_CHUNKS];
+};
+
+static uint32_t name_hash(const char* name, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    return hash ^ (hash >> 15);
+}
+
+static size_t name_home(uint32_t hash, size_t capacity) {
+    return (hash / NAME_STRIPES) & (capacity - 1);
+}
+
+static void name_place(NameEntry* entries, size_t capacity, NameEntry entry) {
+    size_t slot = name_home(entry.hash, capacity);
+    while (entries[slot].handle != NAME_NONE) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    entries[slot] = entry;
+}
+
+/**
+ * @brief Makes room for one more entry
+ */
+static bool stripe_reserve(NameStripe* stripe) {
+    if ((stripe->count + 1) * 4 <= stripe->capacity * 3) return true;
+
+    size_t capacity = stripe->capacity ? stripe->capacity * 2 : 64;
+    NameEntry* entries = calloc(capacity, sizeof(NameEntry));
+    if (!entries) return false;
+
+    for (size_t i = 0; i < stripe->capacity; i++) {
+        if (stripe->entries[i].handle != NAME_NONE) {
+            name_place(entries, capacity, stripe->entries[i]);
+        }
+    }
+    free(stripe->entries);
+    stripe->entries = entries;
+    stripe->capacity = capacity;
+    return true;
+}
+
+static NameHandle stripe_find(const NamePool* pool, const NameStripe* stripe, uint32_t hash,
+                              const char* name) {
+    if (stripe->capacity == 0) return NAME_NONE;
+
+    for (size_t slot = name_home(hash, stripe->capacity);
+         stripe->entries[slot].handle != NAME_NONE;
+         slot = (slot + 1) & (stripe->capacity - 1)) {
+        const NameEntry* entry = &stripe->entries[slot];
+        if (entry->hash == hash && strcmp(names_get(pool, entry->handle), name) == 0) {
+            return entry->handle;
+        }
+    }
+    return NAME_NONE;
+}
+
+/**
+ * @brief Copies a name into the arena
+ * @return Its handle, or NAME_NONE when out of memory or handles
+ */
+static NameHandle arena_append(NamePool* pool, const char* name, size_t length) {
+    pthread_mutex_lock(&pool->arena_lock);
+    NameHandle handle = NAME_NONE;
+    if (pool->offset + length + 1 > NAME_CHUNK_SIZE && pool->chunk_count < NAME_MAX_CHUNKS) {
+        char* chunk = malloc(NAME_CHUNK_SIZE);
+        if (chunk) {
+            pool->chunks[pool->chunk_count++] = chunk;
+            pool->offset = 0;
+        }
+    }
+    if (pool->offset + length + 1 <= NAME_CHUNK_SIZE) {
+        char* chunk = pool->chunks[pool->chunk_count - 1];
+        memcpy(chunk + pool->offset, name, length + 1);
+        handle = (NameHandle)((pool->chunk_count - 1) << NAME_CHUNK_BITS | pool->offset);
+        pool->offset += length + 1;
+        pool->used += length + 1;
+    }
+    pthread_mutex_unlock(&pool->arena_lock);
+    return handle;
+}
+
+NamePool* names_create(void) {
+    NamePool* pool = calloc(1, sizeof(NamePool));
+    if (!pool) return NULL;
+
+    pool->chunks[0] = malloc(NAME_CHUNK_SIZE);
+    if (!pool->chunks[0]) {
+        free(pool);
+        return NULL;
+    }
+    pool->chunks[0][0] = '\0';
+    pool->chunk_count = 1;
+    pool->offset = 1;
+
+    pthread_mutex_init(&pool->arena_lock, NULL);
+    for (size_t i = 0; i < NAME_STRIPES; i++) {
+        pthread_mutex_init(&pool->stripes[i].lock, NULL);
+    }
+    return pool;
+}
+
+void names_destroy(NamePool* pool) {
+    if (pool) {
+        for (size_t i = 0; i < NAME_STRIPES; i++) {
+            pthread_mutex_destroy(&pool->stripes[i].lock);
+            free(pool->stripes[i].entries);
+        }
+        for (size_t i = 0; i < pool->chunk_count; i++) {
+            free(pool->chunks[i]);
+        }
+        pthread_mutex_destroy(&pool->arena_lock);
+        free(pool);
+    }
+}
+
+NameHandle names_intern(NamePool* pool, const char* name) {
+    size_t length = strlen(name);
+    if (length == 0 || length >= NAME_CHUNK_SIZE) return NAME_NONE;
+
+    uint32_t hash = name_hash(name, length);
+    NameStripe* stripe = &pool->stripes[hash % NAME_STRIPES];
+    pthread_mutex_lock(&stripe->lock);
+    NameHandle handle = stripe_find(pool, stripe, hash, name);
+    if (handle == NAME_NONE && stripe_reserve(stripe)) {
+        handle = arena_append(pool, name, length);
+        if (handle != NAME_NONE) {
+            NameEntry entry = { hash, handle };
+            name_place(stripe->entries, stripe->capacity, entry);
+            stripe->count++;
+        }
+    }
+    pthread_mutex_unlock(&stripe->lock);
+    return handle;
+}
+
+const char* names_get(const NamePool* pool, NameHandle handle) {
+    return pool->chunks[handle >> NAME_CHUNK_BITS] + (handle & (NAME_CHUNK_SIZE - 1));
+}
+
+size_t names_size(const NamePool* pool) {
+    return pool->used;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file reservation_names.h
+ * @brief Interned passenger name storage for the reservation system
+ * @author Jaden Mardini
+ *
+ * Internal interface used by reservation_system.c and the snapshot
+ * encoder.  Each distinct name is stored once, NUL-terminated, in an
+ * arena of fixed-size chunks that never move, and seat records refer to
+ * it by a 32-bit handle.  Interning may run on several threads at once:
+ * lookups are spread over hash table stripes with a mutex each, and new
+ * names are appended under one arena mutex.  Resolving a handle takes no
+ * lock; the caller must have obtained the handle under a lock that the
+ * interning thread released afterwards.
+ *
+ * The arena only grows.  Names no seat uses any more are dropped by
+ * interning the live ones into a fresh pool (see names_maybe_compact in
+ * reservation_system.c).
+ */
+
+#ifndef RESERVATION_NAMES_H
+#define RESERVATION_NAMES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t NameHandle;
+
+#define NAME_NONE 0u                    /* Resolves to "" */
+
+/* Names of one seat; both NAME_NONE while the seat is free */
+typedef struct {
+    NameHandle first_name;
+    NameHandle last_name;
+} SeatNames;
+
+typedef struct NamePool NamePool;
+
+/**
+ * @brief Creates an empty pool
+ * @return Pool or NULL on failure
+ */
+NamePool* names_create(void);
+
+/**
+ * @brief Frees a pool and every name in it (pool may be NULL)
+ */
+void names_destroy(NamePool* pool);
+
+/**
+ * @brief Returns the handle of a name, adding it if it is new
+ * @param name Non-empty string shorter than the arena chunk size
+ * @return Handle, or NAME_NONE on allocation failure
+ */
+NameHandle names_intern(NamePool* pool, const char* name);
+
+/**
+ * @brief Resolves a handle from this pool
+ */
+const char* names_get(const NamePool* pool, NameHandle handle);
+
+/**
+ * @brief Gets the bytes taken by every name added so far, live or not
+ *
+ * Not synchronized with names_intern.
+ */
+size_t names_size(const NamePool* pool);
+
+#endif /* RESERVATION_NAMES_H */
@@ -0,0 +1,485 @@
+/**
+ * @file reservation_server.c
+ * @brief Socket Server Implementation
+ * @author Jaden Mardini
+ *
+ * Single-threaded, level-triggered epoll loop.  Each round reads what is
+ * available from every ready client, executes all complete requests in
+ * its input buffer, syncs the journal once, and then writes each client's
+ * accumulated responses with as few send calls as possible.  If the sync
+ * fails, nothing from that round is acknowledged: its responses are
+ * dropped, those clients are disconnected and the server stops, since its
+ * memory now holds changes the journal may not.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reservation_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define SERVER_MAX_EVENTS 256
+#define SERVER_BACKLOG 1024
+#define SERVER_INPUT_BUFFER 4096
+#define SERVER_OUTPUT_LIMIT (1u << 20)  /* Stop reading a client this far behind */
+#define FRAME_HEADER_SIZE 4
+#define REQUEST_HEADER_SIZE 5           /* op, tag */
+#define RESPONSE_MAX (FRAME_HEADER_SIZE + 4 + 1 + 1 + 2 * (1 + MAX_NAME_LENGTH))
+
+typedef struct {
+    int fd;
+    unsigned char input[SERVER_INPUT_BUFFER];
+    size_t input_length;
+    unsigned char* output;              /* Responses not yet sent */
+    size_t output_length;
+    size_t output_sent;
+    size_t output_capacity;
+    size_t round_start;                 /* Output length before this round's requests */
+    uint32_t events;                    /* Interest currently registered */
+    bool closing;                       /* Peer hung up or broke the protocol */
+} Connection;
+
+typedef struct {
+    ReservationSystem* system;
+    int epoll_fd;
+    int listener;
+    Connection** clients;               /* Indexed by file descriptor */
+    size_t client_capacity;
+    bool listener_paused;               /* Out of descriptors until a client closes */
+} Server;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop(int signal_number) {
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+static void put_u32(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+static uint32_t get_u32(const unsigned char* in) {
+    return (uint32_t)in[0] | (uint32_t)in[1] << 8 |
+           (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+/* Bounds-checked view of a request's fields */
+typedef struct {
+    const unsigned char* data;
+    size_t left;
+    bool failed;
+} Fields;
+
+/**
+ * @brief Takes a u32 field; values beyond INT_MAX become -1 so that the
+ *        API rejects them as out of range
+ */
+static int take_int(Fields* fields) {
+    if (fields->failed || fields->left < 4) {
+        fields->failed = true;
+        return -1;
+    }
+    uint32_t value = get_u32(fields->data);
+    fields->data += 4;
+    fields->left -= 4;
+    return value > INT_MAX ? -1 : (int)value;
+}
+
+/**
+ * @brief Takes a length-prefixed name; an overlong name becomes "" so
+ *        that the API rejects it as invalid
+ */
+static void take_name(Fields* fields, char* name) {
+    name[0] = '\0';
+    if (fields->failed || fields->left < 1 || fields->left - 1 < fields->data[0]) {
+        fields->failed = true;
+        return;
+    }
+    size_t length = fields->data[0];
+    if (length < MAX_NAME_LENGTH) {
+        memcpy(name, fields->data + 1, length);
+        name[length] = '\0';
+    }
+    fields->data += 1 + length;
+    fields->left -= 1 + length;
+}
+
+static size_t put_name(unsigned char* out, const char* name) {
+    size_t length = strlen(name);
+    out[0] = (unsigned char)length;
+    memcpy(out + 1, name, length);
+    return 1 + length;
+}
+
+/**
+ * @brief Executes one request and encodes its response
+ * @return Length of the response frame written to out
+ */
+static size_t execute_request(ReservationSystem* system, const unsigned char* body,
+                              size_t length, unsigned char* out) {
+    Fields fields = { body + REQUEST_HEADER_SIZE, length - REQUEST_HEADER_SIZE, false };
+    size_t response = FRAME_HEADER_SIZE + 4 + 1;
+    char first_name[MAX_NAME_LENGTH];
+    char last_name[MAX_NAME_LENGTH];
+    Reservation reservation;
+    ReservationResult result = RESERVATION_ERROR_SYSTEM;
+    int flight_id = take_int(&fields);
+    int value;
+
+    switch ((ServerOp)body[0]) {
+        case SERVER_OP_BOOK:
+            value = take_int(&fields);
+            take_name(&fields, first_name);
+            take_name(&fields, last_name);
+            if (fields.failed || fields.left) break;
+            result = reservation_flight_make(system, flight_id, value, first_name, last_name);
+            break;
+        case SERVER_OP_CANCEL:
+            value = take_int(&fields);
+            if (fields.failed || fields.left) break;
+            result = reservation_flight_cancel(system, flight_id, value);
+            break;
+        case SERVER_OP_QUERY:
+            value = take_int(&fields);
+            if (fields.failed || fields.left) break;
+            result = reservation_flight_get(system, flight_id, value, &reservation);
+            if (result == RESERVATION_SUCCESS) {
+                out[response++] = reservation.is_reserved;
+                response += put_name(out + response, reservation.first_name);
+                response += put_name(out + response, reservation.last_name);
+            }
+            break;
+        case SERVER_OP_COUNT:
+            if (fields.failed || fields.left) break;
+            value = reservation_flight_count_available(system, flight_id);
+            result = value < 0 ? RESERVATION_ERROR_INVALID_FLIGHT : RESERVATION_SUCCESS;
+            if (result == RESERVATION_SUCCESS) {
+                put_u32(out + response, (uint32_t)value);
+                response += 4;
+            }
+            break;
+        case SERVER_OP_FLIGHT:
+            value = take_int(&fields);
+            if (fields.failed || fields.left) break;
+            result = reservation_flight_add(system, flight_id, value);
+            break;
+    }
+
+    put_u32(out, (uint32_t)(response - FRAME_HEADER_SIZE));
+    memcpy(out + FRAME_HEADER_SIZE, body + 1, 4); /* Tag, echoed as sent */
+    out[FRAME_HEADER_SIZE + 4] = (unsigned char)result;
+    return response;
+}
+
+static bool output_reserve(Connection* conn, size_t extra) {
+    if (conn->output_length + extra <= conn->output_capacity) return true;
+
+    size_t capacity = conn->output_capacity ? conn->output_capacity : 4096;
+    while (capacity < conn->output_length + extra) {
+        capacity *= 2;
+    }
+    unsigned char* output = realloc(conn->output, capacity);
+    if (!output) return false;
+
+    conn->output = output;
+    conn->output_capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Executes every complete request in the input buffer
+ * @return false on a protocol violation or allocation failure
+ */
+static bool process_input(ReservationSystem* system, Connection* conn) {
+    size_t pos = 0;
+    bool ok = true;
+    while (conn->input_length - pos >= FRAME_HEADER_SIZE) {
+        uint32_t length = get_u32(conn->input + pos);
+        if (length < REQUEST_HEADER_SIZE || length > SERVER_MAX_REQUEST) {
+            ok = false;
+            break;
+        }
+        if (conn->input_length - pos - FRAME_HEADER_SIZE < length) break;
+
+        if (!output_reserve(conn, RESPONSE_MAX)) {
+            ok = false;
+            break;
+        }
+        conn->output_length += execute_request(system, conn->input + pos + FRAME_HEADER_SIZE,
+                                               length, conn->output + conn->output_length);
+        pos += FRAME_HEADER_SIZE + length;
+    }
+
+    memmove(conn->input, conn->input + pos, conn->input_length - pos);
+    conn->input_length -= pos;
+    return ok;
+}
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/**
+ * @brief Creates the listening socket for "unix:PATH" or "tcp:PORT"
+ * @return Socket descriptor or -1
+ */
+static int open_listener(const char* address) {
+    int fd = -1;
+    bool bound = false;
+
+    if (strncmp(address, "unix:", 5) == 0) {
+        const char* path = address + 5;
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path[0] == '\0' || strlen(path) >= sizeof(addr.sun_path)) return -1;
+        strcpy(addr.sun_path, path);
+
+        /* Replace a socket left behind by an earlier run, nothing else */
+        struct stat info;
+        if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+            unlink(path);
+        }
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        bound = fd >= 0 && bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+    } else if (strncmp(address, "tcp:", 4) == 0) {
+        char* end;
+        long port = strtol(address + 4, &end, 10);
+        if (end == address + 4 || *end != '\0' || port < 1 || port > 65535) return -1;
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int one = 1;
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        bound = fd >= 0 && setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == 0 &&
+                bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+    }
+
+    if (!bound || listen(fd, SERVER_BACKLOG) != 0 || !set_nonblocking(fd)) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Stops or resumes waiting for new clients
+ */
+static void listener_pause(Server* server, bool paused) {
+    struct epoll_event event = { .events = paused ? 0 : EPOLLIN, .data.ptr = NULL };
+    if (paused != server->listener_paused &&
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, server->listener, &event) == 0) {
+        server->listener_paused = paused;
+    }
+}
+
+static void connection_close(Server* server, Connection* conn) {
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    server->clients[conn->fd] = NULL;
+    free(conn->output);
+    free(conn);
+    /* The descriptor just freed lets a waiting client in */
+    listener_pause(server, false);
+}
+
+static void accept_clients(Server* server) {
+    for (;;) {
+        int fd = accept(server->listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            /* The level-triggered listener would fire again at once */
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                listener_pause(server, true);
+            }
+            return; /* EAGAIN: backlog drained */
+        }
+
+        /* Responses are already batched, so Nagle would only add latency;
+           this fails harmlessly on Unix domain sockets */
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        if ((size_t)fd >= server->client_capacity) {
+            size_t capacity = server->client_capacity ? server->client_capacity : 64;
+            while (capacity <= (size_t)fd) {
+                capacity *= 2;
+            }
+            Connection** clients = realloc(server->clients, capacity * sizeof(Connection*));
+            if (!clients) {
+                close(fd);
+                continue;
+            }
+            memset(clients + server->client_capacity, 0,
+                   (capacity - server->client_capacity) * sizeof(Connection*));
+            server->clients = clients;
+            server->client_capacity = capacity;
+        }
+
+        Connection* conn = calloc(1, sizeof(Connection));
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = conn };
+        if (!conn || !set_nonblocking(fd) ||
+            epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+        server->clients[fd] = conn;
+    }
+}
+
+static void connection_read(ReservationSystem* system, Connection* conn) {
+    if (conn->closing) return;
+
+    ssize_t got = recv(conn->fd, conn->input + conn->input_length,
+                       sizeof(conn->input) - conn->input_length, 0);
+    if (got > 0) {
+        conn->input_length += (size_t)got;
+        conn->closing = !process_input(system, conn);
+    } else if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        conn->closing = true;
+    }
+}
+
+/**
+ * @brief Sends pending responses and adjusts the epoll interest set
+ */
+static void connection_flush(Server* server, Connection* conn) {
+    while (conn->output_sent < conn->output_length) {
+        ssize_t sent = send(conn->fd, conn->output + conn->output_sent,
+                            conn->output_length - conn->output_sent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            connection_close(server, conn);
+            return;
+        }
+        conn->output_sent += (size_t)sent;
+    }
+    if (conn->output_sent == conn->output_length) {
+        conn->output_length = 0;
+        conn->output_sent = 0;
+    }
+
+    size_t backlog = conn->output_length - conn->output_sent;
+    if (conn->closing && backlog == 0) {
+        connection_close(server, conn);
+        return;
+    }
+
+    /* A client that does not read its responses is not read from either */
+    uint32_t events = (!conn->closing && backlog < SERVER_OUTPUT_LIMIT ? EPOLLIN : 0) |
+                      (backlog > 0 ? EPOLLOUT : 0);
+    if (events != conn->events) {
+        struct epoll_event event = { .events = events, .data.ptr = conn };
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+        conn->events = events;
+    }
+}
+
+bool server_run(ReservationSystem* system, const char* address) {
+    Server server = { system, -1, -1, NULL, 0, false };
+    server.listener = open_listener(address);
+    if (server.listener < 0) return false;
+
+    server.epoll_fd = epoll_create1(0);
+    struct epoll_event listen_event = { .events = EPOLLIN, .data.ptr = NULL };
+    if (server.epoll_fd < 0 ||
+        epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.listener, &listen_event) != 0) {
+        if (server.epoll_fd >= 0) close(server.epoll_fd);
+        close(server.listener);
+        return false;
+    }
+
+    /* No SA_RESTART, so a signal interrupts epoll_wait */
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    bool synced_all = true;
+    while (!stop_requested && synced_all) {
+        int ready = epoll_wait(server.epoll_fd, events, SERVER_MAX_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        /* Marks where this round's responses begin, also for clients only
+           writable this round */
+        for (int i = 0; i < ready; i++) {
+            Connection* conn = events[i].data.ptr;
+            if (conn) conn->round_start = conn->output_length;
+        }
+        for (int i = 0; i < ready; i++) {
+            Connection* conn = events[i].data.ptr;
+            if (!conn) {
+                accept_clients(&server);
+            } else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                connection_read(system, conn);
+            }
+        }
+
+        /* Group commit: one journal sync covers every change of this round */
+        ReservationResult synced = reservation_system_flush(system);
+        if (synced != RESERVATION_SUCCESS) {
+            fprintf(stderr, "Journal sync failed: %s; dropping this round's replies\n",
+                    reservation_error_string(synced));
+            synced_all = false;
+            for (int i = 0; i < ready; i++) {
+                Connection* conn = events[i].data.ptr;
+                if (conn && conn->output_length > conn->round_start) {
+                    conn->output_length = conn->round_start;
+                    if (conn->output_sent > conn->output_length) {
+                        conn->output_sent = conn->output_length;
+                    }
+                    conn->closing = true;
+                }
+            }
+        }
+
+        for (int i = 0; i < ready; i++) {
+            Connection* conn = events[i].data.ptr;
+            if (conn) connection_flush(&server, conn);
+        }
+    }
+
+    for (size_t fd = 0; fd < server.client_capacity; fd++) {
+        if (server.clients[fd]) connection_close(&server, server.clients[fd]);
+    }
+    free(server.clients);
+    close(server.epoll_fd);
+    close(server.listener);
+    if (strncmp(address, "unix:", 5) == 0) {
+        unlink(address + 5);
+    }
+    return synced_all;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file reservation_server.h
+ * @brief Socket server exposing the reservation API
+ * @author Jaden Mardini
+ *
+ * Binary protocol, all integers little-endian.  A client may send any
+ * number of requests without waiting; responses come back in order.
+ *
+ *   Request:  u32 length, then length bytes: u8 op, u32 tag, op fields
+ *   Response: u32 length, then length bytes: u32 tag, u8 result, op fields
+ *
+ * The tag is echoed unchanged; result is a ReservationResult.
+ *
+ *   op  name    request fields                 response fields (on success)
+ *   1   BOOK    u32 flight, u32 seat,          -
+ *               u8 n, n bytes first name,
+ *               u8 n, n bytes last name
+ *   2   CANCEL  u32 flight, u32 seat           -
+ *   3   QUERY   u32 flight, u32 seat           u8 reserved, u8 n, first name,
+ *                                              u8 n, last name
+ *   4   COUNT   u32 flight                     u32 available seats
+ *   5   FLIGHT  u32 flight, u32 seats          -
+ *
+ * A malformed request is answered with RESERVATION_ERROR_SYSTEM; a frame
+ * longer than SERVER_MAX_REQUEST closes the connection.
+ */
+
+#ifndef RESERVATION_SERVER_H
+#define RESERVATION_SERVER_H
+
+#include "reservation_system.h"
+
+#define SERVER_MAX_REQUEST 256
+
+/* Request opcodes */
+typedef enum {
+    SERVER_OP_BOOK = 1,
+    SERVER_OP_CANCEL,
+    SERVER_OP_QUERY,
+    SERVER_OP_COUNT,
+    SERVER_OP_FLIGHT
+} ServerOp;
+
+/**
+ * @brief Serves requests until SIGINT or SIGTERM
+ * @param system Loaded reservation system
+ * @param address "unix:PATH" for a Unix domain socket, or "tcp:PORT" to
+ *                listen on the loopback interface
+ * @return false if the socket could not be set up or a journal sync failed
+ *
+ * Changes are journaled without a per-request fsync; instead the journal
+ * is synced once per event loop round, before that round's responses are
+ * sent, so a client never sees a success that is not yet durable.  A
+ * failed sync stops the server without acknowledging that round; the
+ * caller should not save, so the next start rebuilds from the journal.
+ */
+bool server_run(ReservationSystem* system, const char* address);
+
+#endif /* RESERVATION_SERVER_H */
@@ -0,0 +1,497 @@
+/**
+ * @file reservation_snapshot.c
+ * @brief Snapshot Encoding Implementation
+ * @author Jaden Mardini
+ *
+ * Version 2 layout (all fixed-width integers little-endian, "varint" is
+ * unsigned LEB128):
+ *
+ *   u32 magic, u32 version
+ *   varint string count, then each string as varint length + bytes
+ *   varint flight count, then per flight:
+ *     varint flight id, varint seat count, varint reserved count,
+ *     u8 seat encoding, followed by either
+ *       0: a bitmap of ceil(seats / 8) bytes (bit i = seat i + 1), or
+ *       1: reserved count varint deltas between ascending seat numbers
+ *     reserved count (first, last) varint string indices in seat order
+ *   u32 FNV-1a checksum of everything before it
+ *
+ * Names are interned, so a surname shared by many passengers is stored
+ * once.  Version 1 files (header plus raw Reservation records per flight)
+ * and headerless files of MAX_SEATS raw records are still decoded.
+ */
+
+#include "reservation_snapshot.h"
+#include "reservation_journal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_MAGIC 0x53565352u    /* "RSVS" */
+#define SNAPSHOT_VERSION_RAW 1u
+#define SNAPSHOT_VERSION 2u
+
+#define SEATS_AS_BITMAP 0
+#define SEATS_AS_DELTAS 1
+
+/* Growable output buffer */
+typedef struct {
+    unsigned char* data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} Buffer;
+
+static void buffer_reserve(Buffer* buffer, size_t extra) {
+    if (buffer->failed || buffer->length + extra <= buffer->capacity) return;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+    while (capacity < buffer->length + extra) {
+        capacity *= 2;
+    }
+    unsigned char* data = realloc(buffer->data, capacity);
+    if (!data) {
+        buffer->failed = true;
+        return;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+}
+
+static void put_bytes(Buffer* buffer, const void* bytes, size_t length) {
+    if (length == 0) return;
+    buffer_reserve(buffer, length);
+    if (buffer->failed) return;
+    memcpy(buffer->data + buffer->length, bytes, length);
+    buffer->length += length;
+}
+
+static void put_u8(Buffer* buffer, unsigned int value) {
+    unsigned char byte = (unsigned char)value;
+    put_bytes(buffer, &byte, 1);
+}
+
+static void put_u32(Buffer* buffer, uint32_t value) {
+    unsigned char bytes[4] = {
+        (unsigned char)value, (unsigned char)(value >> 8),
+        (unsigned char)(value >> 16), (unsigned char)(value >> 24)
+    };
+    put_bytes(buffer, bytes, sizeof(bytes));
+}
+
+static void put_varint(Buffer* buffer, uint32_t value) {
+    unsigned char bytes[5];
+    size_t length = 0;
+    do {
+        bytes[length] = value & 0x7Fu;
+        value >>= 7;
+        if (value) bytes[length] |= 0x80u;
+        length++;
+    } while (value);
+    put_bytes(buffer, bytes, length);
+}
+
+static size_t varint_size(uint32_t value) {
+    size_t size = 1;
+    while (value >= 0x80u) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+/* Bounds-checked input cursor */
+typedef struct {
+    const unsigned char* data;
+    size_t length;
+    size_t pos;
+    bool failed;
+} Reader;
+
+static uint32_t get_u32(Reader* reader) {
+    if (reader->failed || reader->length - reader->pos < 4) {
+        reader->failed = true;
+        return 0;
+    }
+    const unsigned char* in = reader->data + reader->pos;
+    reader->pos += 4;
+    return (uint32_t)in[0] | (uint32_t)in[1] << 8 |
+           (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+static unsigned int get_u8(Reader* reader) {
+    if (reader->failed || reader->pos >= reader->length) {
+        reader->failed = true;
+        return 0;
+    }
+    return reader->data[reader->pos++];
+}
+
+static uint32_t get_varint(Reader* reader) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        unsigned int byte = get_u8(reader);
+        value |= (uint32_t)(byte & 0x7Fu) << shift;
+        if (!(byte & 0x80u)) return value;
+    }
+    reader->failed = true;
+    return 0;
+}
+
+static const unsigned char* get_bytes(Reader* reader, size_t length) {
+    if (reader->failed || reader->length - reader->pos < length) {
+        reader->failed = true;
+        return NULL;
+    }
+    const unsigned char* bytes = reader->data + reader->pos;
+    reader->pos += length;
+    return bytes;
+}
+
+static bool seat_is_reserved(const SnapshotFlight* flight, int index) {
+    return (flight->occupied[index / 64] >> (index % 64)) & 1u;
+}
+
+/*
+ * String table builder for the encoder: open addressing over the distinct
+ * name handles, mapping each to its index in the string table.  A pool
+ * holds each name once, so equal handles mean equal names and no string
+ * is hashed or compared.  The table is kept at most half full.
+ */
+typedef struct {
+    NameHandle* handles;                /* Slot contents, NAME_NONE when empty */
+    uint32_t* indices;
+    size_t mask;
+    uint32_t count;
+    bool failed;
+} InternTable;
+
+static bool intern_alloc(InternTable* table, size_t slots) {
+    table->handles = calloc(slots, sizeof(NameHandle));
+    table->indices = malloc(slots * sizeof(uint32_t));
+    table->mask = slots - 1;
+    return table->handles && table->indices;
+}
+
+static void intern_free(InternTable* table) {
+    free(table->handles);
+    free(table->indices);
+}
+
+static size_t intern_slot(const InternTable* table, NameHandle handle) {
+    uint32_t hash = handle * 2654435761u;
+    size_t slot = (hash ^ hash >> 16) & table->mask;
+    while (table->handles[slot] != NAME_NONE && table->handles[slot] != handle) {
+        slot = (slot + 1) & table->mask;
+    }
+    return slot;
+}
+
+static void intern_grow(InternTable* table) {
+    InternTable grown = *table;
+    if (!intern_alloc(&grown, (table->mask + 1) * 2)) {
+        intern_free(&grown);
+        table->failed = true;
+        return;
+    }
+
+    for (size_t i = 0; i <= table->mask; i++) {
+        if (table->handles[i] != NAME_NONE) {
+            size_t slot = intern_slot(&grown, table->handles[i]);
+            grown.handles[slot] = table->handles[i];
+            grown.indices[slot] = table->indices[i];
+        }
+    }
+    intern_free(table);
+    *table = grown;
+}
+
+static uint32_t intern(InternTable* table, Buffer* strings, const NamePool* names,
+                       NameHandle handle) {
+    if (table->failed) return 0;
+
+    size_t slot = intern_slot(table, handle);
+    if (table->handles[slot] != NAME_NONE) return table->indices[slot];
+
+    const char* name = names_get(names, handle);
+    size_t length = strlen(name);
+    table->handles[slot] = handle;
+    table->indices[slot] = table->count;
+    put_varint(strings, (uint32_t)length);
+    put_bytes(strings, name, length);
+
+    if (++table->count * 2 > table->mask) {
+        intern_grow(table);
+    }
+    return table->count - 1;
+}
+
+/**
+ * @brief Encodes one flight's seats, appending new names to the string table
+ */
+static void encode_flight(const SnapshotFlight* flight, const NamePool* names,
+                          InternTable* table, Buffer* strings, Buffer* out) {
+    uint32_t reserved = 0;
+    size_t delta_bytes = 0;
+    int previous = 0;
+    for (int i = 0; i < flight->seat_count; i++) {
+        if (seat_is_reserved(flight, i)) {
+            reserved++;
+            delta_bytes += varint_size((uint32_t)(i + 1 - previous));
+            previous = i + 1;
+        }
+    }
+    size_t bitmap_bytes = ((size_t)flight->seat_count + 7) / 8;
+
+    put_varint(out, (uint32_t)flight->flight_id);
+    put_varint(out, (uint32_t)flight->seat_count);
+    put_varint(out, reserved);
+
+    if (delta_bytes < bitmap_bytes) {
+        put_u8(out, SEATS_AS_DELTAS);
+        previous = 0;
+        for (int i = 0; i < flight->seat_count; i++) {
+            if (seat_is_reserved(flight, i)) {
+                put_varint(out, (uint32_t)(i + 1 - previous));
+                previous = i + 1;
+            }
+        }
+    } else {
+        put_u8(out, SEATS_AS_BITMAP);
+        for (size_t byte = 0; byte < bitmap_bytes; byte++) {
+            unsigned int bits = (unsigned int)(flight->occupied[byte / 8] >> (byte % 8 * 8)) & 0xFFu;
+            if (byte + 1 == bitmap_bytes && flight->seat_count % 8) {
+                bits &= (1u << (flight->seat_count % 8)) - 1; /* Drop padding bits */
+            }
+            put_u8(out, bits);
+        }
+    }
+
+    for (int i = 0; i < flight->seat_count; i++) {
+        if (seat_is_reserved(flight, i)) {
+            put_varint(out, intern(table, strings, names, flight->seats[i].first_name));
+            put_varint(out, intern(table, strings, names, flight->seats[i].last_name));
+        }
+    }
+}
+
+ReservationResult snapshot_encode(const SnapshotFlight* flights, size_t count,
+                                  const NamePool* names, unsigned char** data,
+                                  size_t* length) {
+    InternTable table = { 0 };
+    Buffer strings = { 0 };
+    Buffer body = { 0 };
+    Buffer out = { 0 };
+    ReservationResult result = RESERVATION_ERROR_MEMORY;
+
+    if (intern_alloc(&table, 64)) {
+        put_varint(&body, (uint32_t)count);
+        for (size_t i = 0; i < count; i++) {
+            encode_flight(&flights[i], names, &table, &strings, &body);
+        }
+
+        put_u32(&out, SNAPSHOT_MAGIC);
+        put_u32(&out, SNAPSHOT_VERSION);
+        put_varint(&out, table.count);
+        put_bytes(&out, strings.data, strings.length);
+        put_bytes(&out, body.data, body.length);
+        bool ok = !table.failed && !strings.failed && !body.failed && !out.failed;
+        if (ok) {
+            put_u32(&out, journal_checksum(out.data, out.length));
+        }
+
+        if (ok && !out.failed) {
+            *data = out.data;
+            *length = out.length;
+            out.data = NULL;
+            result = RESERVATION_SUCCESS;
+        }
+    }
+
+    intern_free(&table);
+    free(strings.data);
+    free(body.data);
+    free(out.data);
+    return result;
+}
+
+/**
+ * @brief Books the reserved seats among raw native Reservation records,
+ *        terminating their names and skipping ones without a name
+ */
+static ReservationResult decode_raw_flight(Reader* reader, const SnapshotSink* sink,
+                                           int flight_id, int seat_count) {
+    const unsigned char* raw = get_bytes(reader, (size_t)seat_count * sizeof(Reservation));
+    if (!raw) return RESERVATION_ERROR_FILE_IO;
+
+    ReservationResult result = sink->begin_flight(sink->context, flight_id, seat_count);
+    if (result != RESERVATION_SUCCESS) return result;
+
+    for (int i = 0; i < seat_count && result == RESERVATION_SUCCESS; i++) {
+        Reservation seat;
+        memcpy(&seat, raw + (size_t)i * sizeof(Reservation), sizeof(Reservation));
+        seat.first_name[MAX_NAME_LENGTH - 1] = '\0';
+        seat.last_name[MAX_NAME_LENGTH - 1] = '\0';
+        if (seat.is_reserved && seat.first_name[0] && seat.last_name[0]) {
+            result = sink->add_seat(sink->context, i, seat.first_name, seat.last_name);
+        }
+    }
+
+    ReservationResult ended = sink->end_flight(sink->context);
+    return result == RESERVATION_SUCCESS ? ended : result;
+}
+
+static ReservationResult decode_raw(Reader* reader, const SnapshotSink* sink) {
+    uint32_t flight_count = get_u32(reader);
+    for (uint32_t i = 0; i < flight_count; i++) {
+        int32_t flight_id = (int32_t)get_u32(reader);
+        int32_t seat_count = (int32_t)get_u32(reader);
+        if (reader->failed || flight_id < 0 || flight_id >= MAX_FLIGHTS ||
+            seat_count < 1 || seat_count > MAX_FLIGHT_SEATS) {
+            return RESERVATION_ERROR_FILE_IO;
+        }
+
+        ReservationResult result = decode_raw_flight(reader, sink, flight_id, seat_count);
+        if (result != RESERVATION_SUCCESS) return result;
+    }
+    return RESERVATION_SUCCESS;
+}
+
+/* Decoded string table entry, pointing into the snapshot buffer */
+typedef struct {
+    const unsigned char* bytes;
+    size_t length;
+} SnapshotString;
+
+/**
+ * @brief Reads the seat numbers of a flight's reserved seats, ascending
+ */
+static bool decode_seat_list(Reader* reader, unsigned int encoding, uint32_t seat_count,
+                             uint32_t reserved, uint32_t* order) {
+    uint32_t found = 0;
+    if (encoding == SEATS_AS_BITMAP) {
+        const unsigned char* bitmap = get_bytes(reader, ((size_t)seat_count + 7) / 8);
+        for (uint32_t i = 0; bitmap && i < seat_count; i++) {
+            if ((bitmap[i / 8] >> (i % 8)) & 1u) {
+                if (found == reserved) return false;
+                order[found++] = i + 1;
+            }
+        }
+    } else {
+        uint32_t seat = 0;
+        for (; found < reserved; found++) {
+            uint32_t delta = get_varint(reader);
+            if (reader->failed || delta == 0 || delta > seat_count - seat) return false;
+            seat += delta;
+            order[found] = seat;
+        }
+    }
+    return !reader->failed && found == reserved;
+}
+
+static ReservationResult decode_flight(Reader* reader, const SnapshotSink* sink,
+                                       const SnapshotString* strings, uint32_t string_count) {
+    uint32_t flight_id = get_varint(reader);
+    uint32_t seat_count = get_varint(reader);
+    uint32_t reserved = get_varint(reader);
+    unsigned int encoding = get_u8(reader);
+    if (reader->failed || flight_id >= MAX_FLIGHTS || seat_count < 1 ||
+        seat_count > MAX_FLIGHT_SEATS || reserved > seat_count ||
+        (encoding != SEATS_AS_BITMAP && encoding != SEATS_AS_DELTAS)) {
+        return RESERVATION_ERROR_FILE_IO;
+    }
+
+    uint32_t* order = malloc(((size_t)reserved + 1) * sizeof(uint32_t));
+    if (!order) return RESERVATION_ERROR_MEMORY;
+    if (!decode_seat_list(reader, encoding, seat_count, reserved, order)) {
+        free(order);
+        return RESERVATION_ERROR_FILE_IO;
+    }
+
+    ReservationResult result = sink->begin_flight(sink->context, (int)flight_id,
+                                                  (int)seat_count);
+    if (result != RESERVATION_SUCCESS) {
+        free(order);
+        return result;
+    }
+
+    for (uint32_t i = 0; i < reserved && result == RESERVATION_SUCCESS; i++) {
+        uint32_t first = get_varint(reader);
+        uint32_t last = get_varint(reader);
+        if (reader->failed || first >= string_count || last >= string_count) {
+            reader->failed = true;
+            break;
+        }
+
+        char first_name[MAX_NAME_LENGTH];
+        char last_name[MAX_NAME_LENGTH];
+        memcpy(first_name, strings[first].bytes, strings[first].length);
+        first_name[strings[first].length] = '\0';
+        memcpy(last_name, strings[last].bytes, strings[last].length);
+        last_name[strings[last].length] = '\0';
+        result = sink->add_seat(sink->context, (int)order[i] - 1, first_name, last_name);
+    }
+    free(order);
+
+    /* The flight is handed over either way so the sink can release it */
+    ReservationResult ended = sink->end_flight(sink->context);
+    if (reader->failed) return RESERVATION_ERROR_FILE_IO;
+    return result == RESERVATION_SUCCESS ? ended : result;
+}
+
+static ReservationResult decode_compact(Reader* reader, const SnapshotSink* sink) {
+    /* The trailing checksum covers every byte before it */
+    if (reader->length < 12) return RESERVATION_ERROR_FILE_IO;
+    Reader trailer = { reader->data, reader->length, reader->length - 4, false };
+    if (get_u32(&trailer) != journal_checksum(reader->data, reader->length - 4)) {
+        return RESERVATION_ERROR_FILE_IO;
+    }
+    reader->length -= 4;
+
+    uint32_t string_count = get_varint(reader);
+    if (reader->failed || string_count > reader->length) return RESERVATION_ERROR_FILE_IO;
+
+    SnapshotString* strings = malloc(((size_t)string_count + 1) * sizeof(SnapshotString));
+    if (!strings) return RESERVATION_ERROR_MEMORY;
+
+    for (uint32_t i = 0; i < string_count && !reader->failed; i++) {
+        strings[i].length = get_varint(reader);
+        strings[i].bytes = get_bytes(reader, strings[i].length);
+        if (strings[i].length == 0 || strings[i].length >= MAX_NAME_LENGTH) {
+            reader->failed = true;
+        }
+    }
+
+    ReservationResult result = RESERVATION_ERROR_FILE_IO;
+    uint32_t flight_count = get_varint(reader);
+    if (!reader->failed) {
+        result = RESERVATION_SUCCESS;
+        for (uint32_t i = 0; i < flight_count && result == RESERVATION_SUCCESS; i++) {
+            result = decode_flight(reader, sink, strings, string_count);
+        }
+    }
+    free(strings);
+
+    if (result == RESERVATION_SUCCESS && reader->pos != reader->length) {
+        result = RESERVATION_ERROR_FILE_IO;
+    }
+    return result;
+}
+
+ReservationResult snapshot_decode(const unsigned char* data, size_t length,
+                                  const SnapshotSink* sink) {
+    if (!data || !sink) return RESERVATION_ERROR_SYSTEM;
+
+    Reader reader = { data, length, 0, false };
+    if (get_u32(&reader) != SNAPSHOT_MAGIC) {
+        /* Headerless file from before flights existed: the default flight */
+        reader.pos = 0;
+        reader.failed = false;
+        return decode_raw_flight(&reader, sink, DEFAULT_FLIGHT_ID, MAX_SEATS);
+    }
+
+    switch (get_u32(&reader)) {
+        case SNAPSHOT_VERSION_RAW: return decode_raw(&reader, sink);
+        case SNAPSHOT_VERSION: return decode_compact(&reader, sink);
+        default: return RESERVATION_ERROR_FILE_IO;
+    }
+}
@@ -0,0 +1,65 @@
+/**
+ * @file reservation_snapshot.h
+ * @brief Snapshot encoding for RESERVATION_FILE
+ * @author Jaden Mardini
+ *
+ * Internal interface used by reservation_system.c.  Snapshots are encoded
+ * to and decoded from memory buffers; the caller owns the file handling.
+ */
+
+#ifndef RESERVATION_SNAPSHOT_H
+#define RESERVATION_SNAPSHOT_H
+
+#include "reservation_system.h"
+#include "reservation_names.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Read-only view of one flight handed to the encoder */
+typedef struct {
+    int flight_id;
+    int seat_count;
+    const uint64_t* occupied;           /* Occupancy bitmap, one bit per seat */
+    const SeatNames* seats;
+} SnapshotFlight;
+
+/*
+ * Receiver of decoded flights.  begin_flight starts a flight with every
+ * seat free, add_seat books one seat of it (index = seat - 1), and
+ * end_flight is called once the seats of that flight are complete, even
+ * if decoding failed in between.  An error from begin_flight or add_seat
+ * aborts decoding.
+ */
+typedef struct {
+    ReservationResult (*begin_flight)(void* context, int flight_id, int seat_count);
+    ReservationResult (*add_seat)(void* context, int index, const char* first_name,
+                                  const char* last_name);
+    ReservationResult (*end_flight)(void* context);
+    void* context;
+} SnapshotSink;
+
+/**
+ * @brief Encodes flights into the current compact snapshot format
+ * @param flights Flights to encode
+ * @param count Number of flights
+ * @param names Pool the seat handles refer to
+ * @param data Set to a malloc'd buffer holding the encoding
+ * @param length Set to the buffer length
+ * @return RESERVATION_SUCCESS or RESERVATION_ERROR_MEMORY
+ */
+ReservationResult snapshot_encode(const SnapshotFlight* flights, size_t count,
+                                  const NamePool* names, unsigned char** data,
+                                  size_t* length);
+
+/**
+ * @brief Decodes a snapshot in the current or any earlier format
+ * @param data Snapshot bytes
+ * @param length Number of bytes
+ * @param sink Receiver of decoded flights
+ * @return RESERVATION_SUCCESS, RESERVATION_ERROR_FILE_IO for malformed
+ *         input, or the first error returned by the sink
+ */
+ReservationResult snapshot_decode(const unsigned char* data, size_t length,
+                                  const SnapshotSink* sink);
+
+#endif /* RESERVATION_SNAPSHOT_H */
@@ -0,0 +1,380 @@
+/**
+ * @file reservation_stats.c
+ * @brief Reservation Statistics Implementation
+ * @author Jaden Mardini
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reservation_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#define STATS_SHARDS 16
+#define STATS_SUB_BITS 4
+#define STATS_SUB_BUCKETS (1u << STATS_SUB_BITS)
+#define STATS_MAX_BITS 40               /* Latencies from 2^40 ns (18 min) share the last bucket */
+#define STATS_BUCKETS ((STATS_MAX_BITS - STATS_SUB_BITS + 1) * STATS_SUB_BUCKETS)
+
+static const char* const op_names[RESERVATION_OP_COUNT] = {
+    "make", "cancel", "query", "save", "load"
+};
+
+static const char* const result_names[RESERVATION_RESULT_COUNT] = {
+    "success", "invalid_seat", "seat_occupied", "seat_empty", "invalid_name",
+    "file_io", "memory", "system", "invalid_flight", "no_adjacent_seats",
+    "duplicate_passenger"
+};
+
+#ifndef RESERVATION_NO_STATS
+
+/* Counters updated by the threads mapped to one shard */
+typedef struct {
+    _Alignas(64) uint64_t results[RESERVATION_OP_COUNT][RESERVATION_RESULT_COUNT];
+    uint64_t total_ns[RESERVATION_OP_COUNT];
+    uint64_t buckets[RESERVATION_OP_COUNT][STATS_BUCKETS];
+    uint64_t bytes[STATS_WRITE_COUNT];
+    uint64_t syncs;
+} StatsShard;
+
+struct ReservationStatsCollector {
+    StatsShard shards[STATS_SHARDS];
+    pthread_mutex_t dump_control;       /* Serializes stats_dump calls */
+    pthread_mutex_t dump_lock;          /* Guards the dump settings below */
+    pthread_cond_t dump_wake;
+    pthread_t dump_thread;
+    bool dumping;                       /* dump_thread is running */
+    bool dump_stop;
+    FILE* dump_out;
+    unsigned int dump_interval_ms;
+    ReservationStatsFormat dump_format;
+};
+
+static unsigned int next_shard;                 /* (atomic) */
+static _Thread_local unsigned int thread_shard; /* Shard index + 1, 0 until first use */
+static _Thread_local unsigned int thread_tick;  /* Operations since the last timed one */
+
+static StatsShard* stats_shard(ReservationStatsCollector* stats) {
+    if (!thread_shard) {
+        thread_shard = __atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED) % STATS_SHARDS + 1;
+    }
+    return &stats->shards[thread_shard - 1];
+}
+
+static void counter_add(uint64_t* counter, uint64_t value) {
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static uint64_t counter_read(const uint64_t* counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static size_t latency_bucket(uint64_t ns) {
+    if (ns < STATS_SUB_BUCKETS) return (size_t)ns;
+
+    unsigned int top = 63 - (unsigned int)__builtin_clzll(ns);
+    if (top >= STATS_MAX_BITS) return STATS_BUCKETS - 1;
+    unsigned int shift = top - STATS_SUB_BITS;
+    return (size_t)(shift + 1) * STATS_SUB_BUCKETS + (size_t)(ns >> shift) - STATS_SUB_BUCKETS;
+}
+
+/**
+ * @brief Gets the largest latency falling into a bucket
+ */
+static uint64_t bucket_limit(size_t bucket) {
+    if (bucket < STATS_SUB_BUCKETS) return bucket;
+
+    unsigned int shift = (unsigned int)(bucket / STATS_SUB_BUCKETS) - 1;
+    uint64_t low = (uint64_t)(bucket % STATS_SUB_BUCKETS + STATS_SUB_BUCKETS) << shift;
+    return low + (UINT64_C(1) << shift) - 1;
+}
+
+ReservationStatsCollector* stats_create(void) {
+    size_t size = (sizeof(ReservationStatsCollector) + 63) / 64 * 64;
+    ReservationStatsCollector* stats = aligned_alloc(64, size);
+    if (!stats) return NULL;
+
+    memset(stats, 0, size);
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&stats->dump_wake, &attributes);
+    pthread_condattr_destroy(&attributes);
+    pthread_mutex_init(&stats->dump_control, NULL);
+    pthread_mutex_init(&stats->dump_lock, NULL);
+    return stats;
+}
+
+void stats_destroy(ReservationStatsCollector* stats) {
+    if (stats) {
+        stats_dump(stats, NULL, 0, RESERVATION_STATS_TEXT);
+        pthread_cond_destroy(&stats->dump_wake);
+        pthread_mutex_destroy(&stats->dump_lock);
+        pthread_mutex_destroy(&stats->dump_control);
+        free(stats);
+    }
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+uint64_t stats_begin(ReservationOp op) {
+    if (op == RESERVATION_OP_MAKE || op == RESERVATION_OP_CANCEL ||
+        op == RESERVATION_OP_QUERY) {
+        if (++thread_tick < RESERVATION_STATS_SAMPLE) return 0;
+        thread_tick = 0;
+    }
+    return monotonic_ns();
+}
+
+void stats_record(ReservationStatsCollector* stats, ReservationOp op,
+                  ReservationResult result, uint64_t start) {
+    StatsShard* shard = stats_shard(stats);
+    if ((unsigned int)result >= RESERVATION_RESULT_COUNT) result = RESERVATION_ERROR_SYSTEM;
+    counter_add(&shard->results[op][result], 1);
+
+    if (start) {
+        uint64_t elapsed = monotonic_ns() - start;
+        counter_add(&shard->total_ns[op], elapsed);
+        counter_add(&shard->buckets[op][latency_bucket(elapsed)], 1);
+    }
+}
+
+void stats_add_write(ReservationStatsCollector* stats, StatsWrite target, size_t bytes) {
+    if (stats) counter_add(&stats_shard(stats)->bytes[target], bytes);
+}
+
+void stats_add_sync(ReservationStatsCollector* stats) {
+    if (stats) counter_add(&stats_shard(stats)->syncs, 1);
+}
+
+/**
+ * @brief Gets the smallest bucket limit covering the given share of samples
+ */
+static uint64_t latency_percentile(const uint64_t* buckets, uint64_t count, double share) {
+    uint64_t rank = (uint64_t)((double)count * share);
+    if (rank >= count) rank = count - 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < STATS_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen > rank) return bucket_limit(i);
+    }
+    return bucket_limit(STATS_BUCKETS - 1);
+}
+
+void stats_collect(const ReservationStatsCollector* stats, ReservationStats* report) {
+    memset(report, 0, sizeof(*report));
+    if (!stats) return;
+    report->enabled = true;
+
+    for (int op = 0; op < RESERVATION_OP_COUNT; op++) {
+        uint64_t buckets[STATS_BUCKETS] = { 0 };
+        uint64_t total_ns = 0;
+        for (size_t s = 0; s < STATS_SHARDS; s++) {
+            const StatsShard* shard = &stats->shards[s];
+            for (int r = 0; r < RESERVATION_RESULT_COUNT; r++) {
+                report->results[op][r] += counter_read(&shard->results[op][r]);
+            }
+            total_ns += counter_read(&shard->total_ns[op]);
+            for (size_t i = 0; i < STATS_BUCKETS; i++) {
+                buckets[i] += counter_read(&shard->buckets[op][i]);
+            }
+        }
+
+        /* Histogram and counters are read apart; the histogram decides */
+        ReservationLatency* latency = &report->latency[op];
+        for (size_t i = 0; i < STATS_BUCKETS; i++) {
+            latency->count += buckets[i];
+            if (buckets[i]) latency->max_ns = bucket_limit(i);
+        }
+        if (latency->count == 0) continue;
+        latency->mean_ns = total_ns / latency->count;
+        latency->p50_ns = latency_percentile(buckets, latency->count, 0.5);
+        latency->p90_ns = latency_percentile(buckets, latency->count, 0.9);
+        latency->p99_ns = latency_percentile(buckets, latency->count, 0.99);
+        latency->p999_ns = latency_percentile(buckets, latency->count, 0.999);
+    }
+
+    for (size_t s = 0; s < STATS_SHARDS; s++) {
+        const StatsShard* shard = &stats->shards[s];
+        report->journal_bytes += counter_read(&shard->bytes[STATS_WRITE_JOURNAL]);
+        report->snapshot_bytes += counter_read(&shard->bytes[STATS_WRITE_SNAPSHOT]);
+        report->syncs += counter_read(&shard->syncs);
+    }
+}
+
+void stats_reset(ReservationStatsCollector* stats) {
+    if (!stats) return;
+
+    for (size_t s = 0; s < STATS_SHARDS; s++) {
+        uint64_t* counter = (uint64_t*)&stats->shards[s];
+        for (size_t i = 0; i < sizeof(StatsShard) / sizeof(uint64_t); i++) {
+            __atomic_store_n(&counter[i], 0, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void dump_report(const ReservationStatsCollector* stats) {
+    ReservationStats report;
+    stats_collect(stats, &report);
+    reservation_stats_print(&report, stats->dump_format, stats->dump_out);
+    fflush(stats->dump_out);
+}
+
+/**
+ * @brief Dump thread: reports every interval, and once more when stopped
+ */
+static void* dump_main(void* arg) {
+    ReservationStatsCollector* stats = arg;
+
+    pthread_mutex_lock(&stats->dump_lock);
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    while (!stats->dump_stop) {
+        uint64_t next = (uint64_t)deadline.tv_nsec +
+                        (uint64_t)stats->dump_interval_ms * 1000000u;
+        deadline.tv_sec += (time_t)(next / 1000000000u);
+        deadline.tv_nsec = (long)(next % 1000000000u);
+
+        int error = 0;
+        while (!stats->dump_stop && error != ETIMEDOUT) {
+            error = pthread_cond_timedwait(&stats->dump_wake, &stats->dump_lock, &deadline);
+        }
+        dump_report(stats);
+    }
+    pthread_mutex_unlock(&stats->dump_lock);
+    return NULL;
+}
+
+bool stats_dump(ReservationStatsCollector* stats, FILE* out, unsigned int interval_ms,
+                ReservationStatsFormat format) {
+    if (!stats) return false;
+
+    pthread_mutex_lock(&stats->dump_control);
+    bool ok = true;
+    if (interval_ms == 0) {
+        if (stats->dumping) {
+            pthread_mutex_lock(&stats->dump_lock);
+            stats->dump_stop = true;
+            pthread_cond_signal(&stats->dump_wake);
+            pthread_mutex_unlock(&stats->dump_lock);
+            pthread_join(stats->dump_thread, NULL);
+            stats->dumping = false;
+        }
+    } else {
+        /* A running thread picks up the new settings for its next report */
+        pthread_mutex_lock(&stats->dump_lock);
+        stats->dump_out = out;
+        stats->dump_interval_ms = interval_ms;
+        stats->dump_format = format;
+        stats->dump_stop = false;
+        pthread_mutex_unlock(&stats->dump_lock);
+        if (!stats->dumping) {
+            stats->dumping = ok = pthread_create(&stats->dump_thread, NULL, dump_main, stats) == 0;
+        }
+    }
+    pthread_mutex_unlock(&stats->dump_control);
+    return ok;
+}
+
+#else
+
+void stats_collect(const ReservationStatsCollector* stats, ReservationStats* report) {
+    (void)stats;
+    memset(report, 0, sizeof(*report));
+}
+
+void stats_reset(ReservationStatsCollector* stats) {
+    (void)stats;
+}
+
+bool stats_dump(ReservationStatsCollector* stats, FILE* out, unsigned int interval_ms,
+                ReservationStatsFormat format) {
+    (void)stats; (void)out; (void)format;
+    return interval_ms == 0;
+}
+
+#endif /* RESERVATION_NO_STATS */
+
+const char* reservation_op_name(ReservationOp op) {
+    return (unsigned int)op < RESERVATION_OP_COUNT ? op_names[op] : "unknown";
+}
+
+static uint64_t op_count(const ReservationStats* stats, int op) {
+    uint64_t count = 0;
+    for (int r = 0; r < RESERVATION_RESULT_COUNT; r++) {
+        count += stats->results[op][r];
+    }
+    return count;
+}
+
+static bool print_text(const ReservationStats* stats, FILE* out) {
+    fprintf(out, "%-8s %12s %12s %10s %10s %10s %10s %10s %10s\n", "op", "count", "failed",
+            "mean_us", "p50_us", "p90_us", "p99_us", "p99.9_us", "max_us");
+    for (int op = 0; op < RESERVATION_OP_COUNT; op++) {
+        const ReservationLatency* latency = &stats->latency[op];
+        uint64_t count = op_count(stats, op);
+        fprintf(out, "%-8s %12" PRIu64 " %12" PRIu64
+                " %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+                op_names[op], count, count - stats->results[op][RESERVATION_SUCCESS],
+                latency->mean_ns / 1e3, latency->p50_ns / 1e3, latency->p90_ns / 1e3,
+                latency->p99_ns / 1e3, latency->p999_ns / 1e3, latency->max_ns / 1e3);
+    }
+
+    /* Failures by cause, only for operations that had any */
+    for (int op = 0; op < RESERVATION_OP_COUNT; op++) {
+        const char* separator = ":";
+        for (int r = 1; r < RESERVATION_RESULT_COUNT; r++) {
+            if (stats->results[op][r] == 0) continue;
+            if (*separator == ':') fprintf(out, "%s", op_names[op]);
+            fprintf(out, "%s %s=%" PRIu64, separator, result_names[r], stats->results[op][r]);
+            separator = ",";
+        }
+        if (*separator == ',') fprintf(out, "\n");
+    }
+    fprintf(out, "io: journal_bytes=%" PRIu64 " snapshot_bytes=%" PRIu64 " syncs=%" PRIu64 "\n",
+            stats->journal_bytes, stats->snapshot_bytes, stats->syncs);
+    return !ferror(out);
+}
+
+static bool print_json(const ReservationStats* stats, FILE* out) {
+    fprintf(out, "{\"enabled\":%s,\"operations\":{", stats->enabled ? "true" : "false");
+    for (int op = 0; op < RESERVATION_OP_COUNT; op++) {
+        const ReservationLatency* latency = &stats->latency[op];
+        fprintf(out, "%s\"%s\":{\"count\":%" PRIu64 ",\"results\":{", op ? "," : "",
+                op_names[op], op_count(stats, op));
+        for (int r = 0; r < RESERVATION_RESULT_COUNT; r++) {
+            fprintf(out, "%s\"%s\":%" PRIu64, r ? "," : "", result_names[r],
+                    stats->results[op][r]);
+        }
+        fprintf(out, "},\"latency_ns\":{\"mean\":%" PRIu64 ",\"p50\":%" PRIu64
+                ",\"p90\":%" PRIu64 ",\"p99\":%" PRIu64 ",\"p999\":%" PRIu64
+                ",\"max\":%" PRIu64 "}}",
+                latency->mean_ns, latency->p50_ns, latency->p90_ns, latency->p99_ns,
+                latency->p999_ns, latency->max_ns);
+    }
+    fprintf(out, "},\"io\":{\"journal_bytes\":%" PRIu64 ",\"snapshot_bytes\":%" PRIu64
+            ",\"syncs\":%" PRIu64 "}}\n",
+            stats->journal_bytes, stats->snapshot_bytes, stats->syncs);
+    return !ferror(out);
+}
+
+bool reservation_stats_print(const ReservationStats* stats, ReservationStatsFormat format,
+                             FILE* out) {
+    if (!stats || !out) return false;
+    if (format == RESERVATION_STATS_JSON) return print_json(stats, out);
+    if (!stats->enabled) {
+        fprintf(out, "Statistics are compiled out\n");
+        return !ferror(out);
+    }
+    return print_text(stats, out);
+}
@@ -0,0 +1,120 @@
+/**
+ * @file reservation_stats.h
+ * @brief Operation counters and latency histograms for the reservation system
+ * @author Jaden Mardini
+ *
+ * Internal interface used by the engine, journal and store.  Counters are
+ * striped over STATS_SHARDS cache-line-aligned shards; a thread picks its
+ * shard once and adds to it with relaxed atomics, so recording takes no
+ * lock and threads rarely share a cache line.  Readers sum the shards.
+ *
+ * Latencies go into log-linear (HDR-style) buckets: one per nanosecond
+ * below 16, then 16 per power of two, so a bucket is never wider than
+ * 1/16 of its values.  Reading the clock costs about as much as a seat
+ * query, so each thread times one booking, cancellation or query in
+ * RESERVATION_STATS_SAMPLE; every operation is still counted.  Saves and
+ * loads are always timed.
+ *
+ * Building with -DRESERVATION_NO_STATS turns every recording call into an
+ * empty inline function and no collector is allocated.
+ */
+
+#ifndef RESERVATION_STATS_H
+#define RESERVATION_STATS_H
+
+#include "reservation_system.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Where written bytes went */
+typedef enum {
+    STATS_WRITE_JOURNAL = 0,
+    STATS_WRITE_SNAPSHOT,               /* Snapshot files and synced store pages */
+    STATS_WRITE_COUNT
+} StatsWrite;
+
+typedef struct ReservationStatsCollector ReservationStatsCollector;
+
+#ifdef RESERVATION_NO_STATS
+
+#define STATS_ENABLED 0
+
+static inline ReservationStatsCollector* stats_create(void) { return NULL; }
+static inline void stats_destroy(ReservationStatsCollector* stats) { (void)stats; }
+static inline uint64_t stats_begin(ReservationOp op) { (void)op; return 0; }
+
+static inline void stats_record(ReservationStatsCollector* stats, ReservationOp op,
+                                ReservationResult result, uint64_t start) {
+    (void)stats; (void)op; (void)result; (void)start;
+}
+
+static inline void stats_add_write(ReservationStatsCollector* stats, StatsWrite target,
+                                   size_t bytes) {
+    (void)stats; (void)target; (void)bytes;
+}
+
+static inline void stats_add_sync(ReservationStatsCollector* stats) { (void)stats; }
+
+#else
+
+#define STATS_ENABLED 1
+
+#ifndef RESERVATION_STATS_SAMPLE
+#define RESERVATION_STATS_SAMPLE 8      /* Time 1 operation in 8; 1 times them all */
+#endif
+
+/**
+ * @brief Allocates a zeroed collector
+ * @return Collector or NULL on failure
+ */
+ReservationStatsCollector* stats_create(void);
+
+/**
+ * @brief Stops any periodic dump and frees the collector (may be NULL)
+ */
+void stats_destroy(ReservationStatsCollector* stats);
+
+/**
+ * @brief Starts an operation
+ * @return Start time for stats_record, or 0 if this one is not timed
+ */
+uint64_t stats_begin(ReservationOp op);
+
+/**
+ * @brief Counts one operation, and its latency if it was timed
+ * @param start stats_begin() value taken when the operation began
+ */
+void stats_record(ReservationStatsCollector* stats, ReservationOp op,
+                  ReservationResult result, uint64_t start);
+
+/**
+ * @brief Counts bytes handed to the kernel (stats may be NULL)
+ */
+void stats_add_write(ReservationStatsCollector* stats, StatsWrite target, size_t bytes);
+
+/**
+ * @brief Counts one fsync, fdatasync or msync call (stats may be NULL)
+ */
+void stats_add_sync(ReservationStatsCollector* stats);
+
+#endif /* RESERVATION_NO_STATS */
+
+/**
+ * @brief Sums the shards into a report; all zero when compiled out
+ */
+void stats_collect(const ReservationStatsCollector* stats, ReservationStats* report);
+
+/**
+ * @brief Zeroes every counter; concurrent updates may survive the reset
+ */
+void stats_reset(ReservationStatsCollector* stats);
+
+/**
+ * @brief Starts, retargets or (interval_ms 0) stops the periodic dump
+ * @return false if the dump thread could not be started, or when
+ *         compiled out
+ */
+bool stats_dump(ReservationStatsCollector* stats, FILE* out, unsigned int interval_ms,
+                ReservationStatsFormat format);
+
+#endif /* RESERVATION_STATS_H */
@@ -0,0 +1,370 @@
+/**
+ * @file reservation_store.c
+ * @brief Memory-Mapped Seat Store Implementation
+ * @author Jaden Mardini
+ *
+ * File layout: one page holding StoreHeader, then a directory of
+ * MAX_FLIGHTS StoreEntry slots (sparse on disk, only used slots are ever
+ * touched), then one page-aligned region per flight.  A region holds the
+ * occupancy bitmap, the name index and the raw Reservation records, in
+ * native byte order; record_size in the header guards against layout
+ * changes.  The checksum covers the header and the used directory slots.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reservation_store.h"
+#include "reservation_journal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define STORE_MAGIC 0x4D565352u       /* "RSVM" */
+#define STORE_VERSION 1u
+#define STORE_SLOTS MAX_FLIGHTS
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;               /* sizeof(Reservation) of the writer */
+    uint32_t clean;                     /* 1 after an orderly close */
+    uint32_t slot_count;                /* Directory slots in use or freed */
+    uint32_t checksum;
+    uint64_t seat_count;                /* Seats across all live flights */
+    uint64_t file_size;
+} StoreHeader;
+
+typedef struct {
+    int32_t flight_id;                  /* -1 when the slot is free */
+    int32_t seat_count;
+    int32_t capacity;                   /* Seats the region was sized for */
+    int32_t name_count;
+    uint64_t offset;
+    uint64_t length;
+} StoreEntry;
+
+typedef struct {
+    unsigned char* base;                /* NULL when not mapped */
+    size_t length;
+    uint64_t* dirty;                    /* One bit per page of the region */
+} StoreRegion;
+
+struct ReservationStore {
+    int fd;
+    size_t page_size;
+    unsigned char* meta;                /* Header page plus directory */
+    size_t meta_length;
+    StoreHeader* header;
+    StoreEntry* directory;
+    ReservationStatsCollector* stats;
+    StoreRegion regions[STORE_SLOTS];
+};
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief Computes the offsets of a region's arrays and its total length
+ */
+static size_t region_layout(const ReservationStore* store, int seats,
+                            size_t* name_offset, size_t* record_offset) {
+    size_t bitmap_bytes = ((size_t)seats + 63) / 64 * sizeof(uint64_t);
+    *name_offset = bitmap_bytes;
+    *record_offset = align_up(bitmap_bytes + (size_t)seats * sizeof(int), sizeof(uint64_t));
+    return align_up(*record_offset + (size_t)seats * sizeof(Reservation), store->page_size);
+}
+
+static uint32_t header_checksum(const ReservationStore* store) {
+    StoreHeader copy = *store->header;
+    copy.checksum = 0;
+
+    uint32_t sum = journal_checksum(&copy, sizeof(copy));
+    uint32_t dir = journal_checksum(store->directory,
+                                    store->header->slot_count * sizeof(StoreEntry));
+    return sum ^ (dir * 16777619u);
+}
+
+static bool sync_meta(ReservationStore* store) {
+    uint64_t seats = 0;
+    for (uint32_t i = 0; i < store->header->slot_count; i++) {
+        if (store->directory[i].flight_id >= 0) {
+            seats += (uint64_t)store->directory[i].seat_count;
+        }
+    }
+    store->header->seat_count = seats;
+    store->header->checksum = header_checksum(store);
+
+    size_t used = align_up(store->page_size + store->header->slot_count * sizeof(StoreEntry),
+                           store->page_size);
+    stats_add_write(store->stats, STATS_WRITE_SNAPSHOT, used);
+    stats_add_sync(store->stats);
+    return msync(store->meta, used, MS_SYNC) == 0;
+}
+
+ReservationStore* store_open(const char* path, bool* created, bool* clean,
+                             ReservationStatsCollector* stats) {
+    ReservationStore* store = calloc(1, sizeof(ReservationStore));
+    if (!store) return NULL;
+
+    store->stats = stats;
+    store->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    store->meta_length = align_up(store->page_size + STORE_SLOTS * sizeof(StoreEntry),
+                                  store->page_size);
+    *created = false;
+
+    store->fd = open(path, O_RDWR);
+    if (store->fd < 0 && errno == ENOENT) {
+        store->fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        *created = store->fd >= 0;
+        if (*created && ftruncate(store->fd, (off_t)store->meta_length) != 0) {
+            close(store->fd);
+            unlink(path);
+            store->fd = -1;
+        }
+    }
+    if (store->fd < 0) {
+        free(store);
+        return NULL;
+    }
+
+    struct stat info;
+    if (fstat(store->fd, &info) != 0 || (size_t)info.st_size < store->meta_length) {
+        close(store->fd);
+        free(store);
+        return NULL;
+    }
+
+    store->meta = mmap(NULL, store->meta_length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       store->fd, 0);
+    if (store->meta == MAP_FAILED) {
+        close(store->fd);
+        free(store);
+        return NULL;
+    }
+    store->header = (StoreHeader*)store->meta;
+    store->directory = (StoreEntry*)(store->meta + store->page_size);
+
+    StoreHeader* header = store->header;
+    if (*created) {
+        header->magic = STORE_MAGIC;
+        header->version = STORE_VERSION;
+        header->record_size = sizeof(Reservation);
+        header->clean = 1;
+        header->file_size = store->meta_length;
+        header->checksum = header_checksum(store);
+    }
+
+    /* A crash while adding a flight may leave the file longer than recorded */
+    bool valid = header->magic == STORE_MAGIC && header->version == STORE_VERSION &&
+                 header->record_size == sizeof(Reservation) &&
+                 header->slot_count <= STORE_SLOTS &&
+                 header->file_size <= (uint64_t)info.st_size &&
+                 (!header->clean || header->checksum == header_checksum(store));
+    if (!valid) {
+        munmap(store->meta, store->meta_length);
+        close(store->fd);
+        free(store);
+        return NULL;
+    }
+
+    /* Stays 0 until an orderly close, so a crash is detected on reopen */
+    *clean = header->clean == 1;
+    header->clean = 0;
+    if (!sync_meta(store)) {
+        store_close(store, false);
+        return NULL;
+    }
+    return store;
+}
+
+void store_close(ReservationStore* store, bool clean) {
+    if (!store) return;
+
+    bool synced = store_sync(store) == RESERVATION_SUCCESS;
+    if (clean && synced) {
+        store->header->clean = 1;
+        sync_meta(store);
+    }
+
+    for (int i = 0; i < STORE_SLOTS; i++) {
+        if (store->regions[i].base) {
+            munmap(store->regions[i].base, store->regions[i].length);
+            free(store->regions[i].dirty);
+        }
+    }
+    munmap(store->meta, store->meta_length);
+    close(store->fd);
+    free(store);
+}
+
+int store_slot_count(const ReservationStore* store) {
+    return store ? (int)store->header->slot_count : 0;
+}
+
+/**
+ * @brief Maps a slot's region and fills in the caller's view of it
+ */
+static bool map_region(ReservationStore* store, int slot, StoreFlight* flight) {
+    const StoreEntry* entry = &store->directory[slot];
+    StoreRegion* region = &store->regions[slot];
+
+    size_t name_offset, record_offset;
+    size_t length = region_layout(store, entry->capacity, &name_offset, &record_offset);
+    if (entry->offset % store->page_size != 0 || entry->length != length ||
+        entry->offset + entry->length > store->header->file_size) {
+        return false;
+    }
+
+    size_t pages = length / store->page_size;
+    region->dirty = calloc((pages + 63) / 64, sizeof(uint64_t));
+    if (!region->dirty) return false;
+
+    void* base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd,
+                      (off_t)entry->offset);
+    if (base == MAP_FAILED) {
+        free(region->dirty);
+        region->dirty = NULL;
+        return false;
+    }
+    region->base = base;
+    region->length = length;
+
+    flight->slot = slot;
+    flight->flight_id = entry->flight_id;
+    flight->seat_count = entry->seat_count;
+    flight->name_count = entry->name_count;
+    flight->occupied = (uint64_t*)region->base;
+    flight->by_name = (int*)(region->base + name_offset);
+    flight->seats = (Reservation*)(region->base + record_offset);
+    return true;
+}
+
+bool store_attach(ReservationStore* store, int slot, StoreFlight* flight) {
+    if (!store || slot < 0 || (uint32_t)slot >= store->header->slot_count) return false;
+
+    const StoreEntry* entry = &store->directory[slot];
+    if (entry->flight_id < 0 || entry->flight_id >= MAX_FLIGHTS ||
+        entry->seat_count < 1 || entry->seat_count > entry->capacity ||
+        entry->capacity > MAX_FLIGHT_SEATS || entry->name_count < 0 ||
+        entry->name_count > entry->seat_count) {
+        return false;
+    }
+    return store->regions[slot].base == NULL && map_region(store, slot, flight);
+}
+
+bool store_add_flight(ReservationStore* store, int flight_id, int seat_count,
+                      StoreFlight* flight) {
+    if (!store) return false;
+
+    /* Reuse the region of a removed flight when it is large enough */
+    int slot = -1;
+    for (uint32_t i = 0; i < store->header->slot_count; i++) {
+        const StoreEntry* entry = &store->directory[i];
+        if (entry->flight_id < 0 && entry->capacity >= seat_count) {
+            slot = (int)i;
+            break;
+        }
+    }
+
+    StoreEntry* entry;
+    if (slot >= 0) {
+        entry = &store->directory[slot];
+    } else {
+        if (store->header->slot_count >= STORE_SLOTS) return false;
+
+        size_t name_offset, record_offset;
+        size_t length = region_layout(store, seat_count, &name_offset, &record_offset);
+        uint64_t offset = store->header->file_size;
+        if (ftruncate(store->fd, (off_t)(offset + length)) != 0) return false;
+
+        slot = (int)store->header->slot_count++;
+        entry = &store->directory[slot];
+        entry->capacity = seat_count;
+        entry->offset = offset;
+        entry->length = length;
+        store->header->file_size = offset + length;
+    }
+    entry->flight_id = flight_id;
+    entry->seat_count = seat_count;
+    entry->name_count = 0;
+
+    if (!map_region(store, slot, flight)) {
+        entry->flight_id = -1;
+        return false;
+    }
+
+    StoreRegion* region = &store->regions[slot];
+    memset(region->base, 0, region->length);
+    store_mark_dirty(store, slot, region->base, region->length);
+    return true;
+}
+
+void store_remove_flight(ReservationStore* store, int slot) {
+    if (!store || slot < 0 || (uint32_t)slot >= store->header->slot_count) return;
+
+    StoreRegion* region = &store->regions[slot];
+    if (region->base) {
+        munmap(region->base, region->length);
+        free(region->dirty);
+        memset(region, 0, sizeof(*region));
+    }
+    store->directory[slot].flight_id = -1;
+}
+
+void store_mark_dirty(ReservationStore* store, int slot, const void* address, size_t length) {
+    if (!store || length == 0) return;
+
+    StoreRegion* region = &store->regions[slot];
+    size_t start = (size_t)((const unsigned char*)address - region->base);
+    size_t first = start / store->page_size;
+    size_t last = (start + length - 1) / store->page_size;
+    for (size_t page = first; page <= last; page++) {
+        /* Atomic: seats of one region may be booked from several threads */
+        __atomic_fetch_or(&region->dirty[page / 64], UINT64_C(1) << (page % 64),
+                          __ATOMIC_RELAXED);
+    }
+}
+
+void store_set_name_count(ReservationStore* store, int slot, int name_count) {
+    if (store && slot >= 0 && (uint32_t)slot < store->header->slot_count) {
+        store->directory[slot].name_count = name_count;
+    }
+}
+
+ReservationResult store_sync(ReservationStore* store) {
+    if (!store) return RESERVATION_ERROR_SYSTEM;
+
+    bool ok = true;
+    for (uint32_t slot = 0; slot < store->header->slot_count; slot++) {
+        StoreRegion* region = &store->regions[slot];
+        if (!region->base) continue;
+
+        /* msync each run of consecutive dirty pages */
+        size_t pages = region->length / store->page_size;
+        size_t page = 0;
+        while (page < pages) {
+            if (!(region->dirty[page / 64] >> (page % 64) & 1u)) {
+                page++;
+                continue;
+            }
+            size_t run = page;
+            while (run < pages && (region->dirty[run / 64] >> (run % 64) & 1u)) {
+                region->dirty[run / 64] &= ~(UINT64_C(1) << (run % 64));
+                run++;
+            }
+            stats_add_write(store->stats, STATS_WRITE_SNAPSHOT, (run - page) * store->page_size);
+            stats_add_sync(store->stats);
+            ok = msync(region->base + page * store->page_size,
+                       (run - page) * store->page_size, MS_SYNC) == 0 && ok;
+            page = run;
+        }
+    }
+
+    ok = sync_meta(store) && ok;
+    return ok ? RESERVATION_SUCCESS : RESERVATION_ERROR_FILE_IO;
+}
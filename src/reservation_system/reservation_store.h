@@ -0,0 +1,94 @@
+/**
+ * @file reservation_store.h
+ * @brief Memory-mapped seat store for the reservation system
+ * @author Jaden Mardini
+ *
+ * Internal interface used by reservation_system.c in
+ * RESERVATION_STORAGE_MAPPED mode.  Each flight owns a page-aligned region
+ * of RESERVATION_MAP_FILE holding its occupancy bitmap, name index and
+ * seat records, which the engine uses in place; opening the store only
+ * reads the header and flight directory, and seat pages fault in lazily.
+ */
+
+#ifndef RESERVATION_STORE_H
+#define RESERVATION_STORE_H
+
+#include "reservation_system.h"
+#include "reservation_stats.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ReservationStore ReservationStore;
+
+/* Mapped arrays of one flight region */
+typedef struct {
+    int slot;                           /* Directory slot, passed back to the store */
+    int flight_id;
+    int seat_count;
+    int name_count;                     /* Entries in by_name at the last sync */
+    uint64_t* occupied;
+    int* by_name;
+    Reservation* seats;
+} StoreFlight;
+
+/**
+ * @brief Opens or creates a mapped store
+ * @param path Store file path
+ * @param created Set to true when a new, empty store was created
+ * @param clean Set to false when the store was not closed cleanly, in
+ *              which case derived data (bitmap, name index) must be rebuilt
+ * @param stats Collector counting synced pages (may be NULL)
+ * @return Store handle or NULL on failure (including a corrupt header)
+ */
+ReservationStore* store_open(const char* path, bool* created, bool* clean,
+                             ReservationStatsCollector* stats);
+
+/**
+ * @brief Syncs, optionally marks the store clean, and unmaps everything
+ * @param store Store handle (may be NULL)
+ * @param clean true when all derived data in the mapping is up to date
+ */
+void store_close(ReservationStore* store, bool clean);
+
+/**
+ * @brief Gets the number of directory slots (live or free)
+ */
+int store_slot_count(const ReservationStore* store);
+
+/**
+ * @brief Maps the flight in a directory slot
+ * @return true if the slot holds a flight and it was mapped
+ */
+bool store_attach(ReservationStore* store, int slot, StoreFlight* flight);
+
+/**
+ * @brief Allocates and maps a zeroed region for a new flight
+ * @return true on success
+ */
+bool store_add_flight(ReservationStore* store, int flight_id, int seat_count,
+                      StoreFlight* flight);
+
+/**
+ * @brief Unmaps a flight and frees its slot for reuse
+ */
+void store_remove_flight(ReservationStore* store, int slot);
+
+/**
+ * @brief Records that a byte range of a flight region was modified
+ *
+ * Safe to call from several threads at once.
+ */
+void store_mark_dirty(ReservationStore* store, int slot, const void* address, size_t length);
+
+/**
+ * @brief Records the name index length of a flight for the next sync
+ */
+void store_set_name_count(ReservationStore* store, int slot, int name_count);
+
+/**
+ * @brief Writes dirty pages and the header back with msync
+ * @return RESERVATION_SUCCESS or RESERVATION_ERROR_FILE_IO
+ */
+ReservationResult store_sync(ReservationStore* store);
+
+#endif /* RESERVATION_STORE_H */
@@ -2,36 +2,1972 @@
  * @file reservation_system.c
  * @brief Reservation System Implementation
  * @author Jaden Mardini
+ *
+ * Locking: a system-wide rwlock is held shared by bookings and queries and
+ * exclusively by anything that adds or frees flights or touches the whole
+ * state (load, save, compaction).  Within a flight, each 64-seat block
+ * (one bitmap word) has its own mutex guarding those seat records, and
+ * the name index has one more.  The passenger index is split into stripes
+ * with a mutex each.  Lock order is system, block, passenger stripe,
+ * index; the journal and name pool locks are innermost.  Bitmap words are
+ * updated atomically, so availability queries need no block lock.
+ *
+ * Seats hold 32-bit handles into the system's name pool rather than the
+ * names themselves.  Mapped flights also keep full Reservation records in
+ * the store, written alongside, which the pool is refilled from on load.
+ *
+ * Read snapshots are copy-on-write: a writer copies a seat block into the
+ * open snapshots of its flight before changing it, and snapshot readers
+ * take no block lock.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "reservation_system.h"
+#include "reservation_journal.h"
+#include "reservation_names.h"
+#include "reservation_snapshot.h"
+#include "reservation_store.h"
+#include "reservation_stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define BITMAP_WORD_BITS 64
+#define BITMAP_WORDS(seats) (((size_t)(seats) + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS)
+#define RESERVATION_TEMP_FILE RESERVATION_FILE ".tmp"
+#define NAMES_COMPACT_MIN_BYTES ((size_t)64 << 10) /* Smaller pools are left alone */
+
+/* Seat inventory of a single flight */
+typedef struct {
+    int flight_id;
+    int seat_count;
+    SeatNames* seats;                   /* seat_count entries, index = seat - 1 */
+    Reservation* records;               /* Mapped copy of the seats, else NULL */
+    uint64_t* occupied;                 /* One bit per seat, set when reserved */
+    int* by_name;                       /* Reserved seat indices in name order */
+    int by_name_count;                  /* Number of entries in by_name */
+    ReservationStore* store;            /* Owner of the arrays when mapped, else NULL */
+    int store_slot;
+    pthread_mutex_t* block_locks;       /* One per bitmap word */
+    pthread_mutex_t index_lock;         /* Guards by_name and by_name_count */
+    int available;                      /* Free seats; read and updated atomically */
+    ReservationSnapshot* snapshots;     /* Open snapshots; changed with every block
+                                           lock held */
+} Flight;
+
+/**
+ * @brief Tells the mapped store which bytes of a flight changed
+ */
+static void flight_touch(const Flight* flight, const void* address, size_t length) {
+    if (flight->store) {
+        store_mark_dirty(flight->store, flight->store_slot, address, length);
+    }
+}
+
+/*
+ * Occupancy bitmap helpers.  Bit (index % 64) of word (index / 64) tracks
+ * seat index + 1.  Padding bits past the last seat are kept set so that
+ * scans over the inverted words only ever yield real, free seats.  Words
+ * are read and written atomically; bitmap_reset needs exclusive access.
+ */
+
+static void bitmap_set(uint64_t* bitmap, int index) {
+    __atomic_fetch_or(&bitmap[index / BITMAP_WORD_BITS],
+                      UINT64_C(1) << (index % BITMAP_WORD_BITS), __ATOMIC_RELEASE);
+}
+
+static void bitmap_clear(uint64_t* bitmap, int index) {
+    __atomic_fetch_and(&bitmap[index / BITMAP_WORD_BITS],
+                       ~(UINT64_C(1) << (index % BITMAP_WORD_BITS)), __ATOMIC_RELEASE);
+}
+
+static uint64_t bitmap_word(const uint64_t* bitmap, size_t word) {
+    return __atomic_load_n(&bitmap[word], __ATOMIC_ACQUIRE);
+}
+
+static bool bitmap_test(const uint64_t* bitmap, int index) {
+    return (bitmap_word(bitmap, (size_t)(index / BITMAP_WORD_BITS)) >>
+            (index % BITMAP_WORD_BITS)) & 1u;
+}
+
+/**
+ * @brief Finds the first index at or after from whose bit equals value
+ * @return That index, or words * 64 if there is none
+ */
+static int bitmap_next(const uint64_t* bitmap, size_t words, int from, bool value) {
+    size_t w = (size_t)from / BITMAP_WORD_BITS;
+    if (w >= words) return (int)(words * BITMAP_WORD_BITS);
+
+    uint64_t flip = value ? 0 : ~UINT64_C(0);
+    uint64_t bits = (bitmap_word(bitmap, w) ^ flip) & (~UINT64_C(0) << (from % BITMAP_WORD_BITS));
+    while (!bits) {
+        if (++w >= words) return (int)(words * BITMAP_WORD_BITS);
+        bits = bitmap_word(bitmap, w) ^ flip;
+    }
+    return (int)(w * BITMAP_WORD_BITS) + __builtin_ctzll(bits);
+}
+
+/**
+ * @brief Bits of a word that stand for real seats rather than padding
+ */
+static uint64_t bitmap_seat_mask(int seat_count, size_t word) {
+    int tail = seat_count % BITMAP_WORD_BITS;
+    bool last = word + 1 == BITMAP_WORDS(seat_count);
+    return last && tail ? (UINT64_C(1) << tail) - 1 : ~UINT64_C(0);
+}
+
+static void bitmap_reset(uint64_t* bitmap, int seat_count) {
+    size_t words = BITMAP_WORDS(seat_count);
+    memset(bitmap, 0, words * sizeof(uint64_t));
+
+    int tail = seat_count % BITMAP_WORD_BITS;
+    if (tail) {
+        bitmap[words - 1] = ~UINT64_C(0) << tail;
+    }
+}
+
+/*
+ * Read snapshots.  A snapshot is linked into its flight while every block
+ * lock of the flight is held, so no booking is half applied at that point.
+ * From then on, a writer about to change a block first copies it into
+ * every linked snapshot that has no copy yet and sets the copy's flag; a
+ * block without a copy is still as it was and is read from the flight.
+ * Seats are changed with release stores after the flag is set, so a
+ * reader that copied a live block and still finds the flag clear saw no
+ * change.
+ */
+
+/* One seat block as a snapshot sees it */
+typedef struct {
+    uint64_t occupied;
+    SeatNames seats[BITMAP_WORD_BITS];
+} SeatBlock;
+
+struct ReservationSnapshot {
+    const ReservationSystem* system;
+    Flight* flight;                     /* NULL once the flight is gone */
+    int seat_count;
+    SeatBlock* blocks;                  /* One per bitmap word, copied on demand */
+    unsigned char* preserved;           /* Set once that block's copy is filled in */
+    ReservationSnapshot* next;          /* Next open snapshot of the same flight */
+};
+
+/**
+ * @brief Gets the number of seats in a block
+ */
+static int block_seats(int seat_count, size_t word) {
+    int rest = seat_count - (int)(word * BITMAP_WORD_BITS);
+    return rest < BITMAP_WORD_BITS ? rest : BITMAP_WORD_BITS;
+}
+
+/**
+ * @brief Copies a block into a snapshot; the caller holds the block lock
+ *        or has exclusive access
+ */
+static void snapshot_preserve(ReservationSnapshot* snapshot, const Flight* flight, size_t word) {
+    SeatBlock* block = &snapshot->blocks[word];
+    block->occupied = bitmap_word(flight->occupied, word);
+    memcpy(block->seats, &flight->seats[word * BITMAP_WORD_BITS],
+           (size_t)block_seats(flight->seat_count, word) * sizeof(SeatNames));
+    __atomic_store_n(&snapshot->preserved[word], 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Gives every open snapshot of a flight its copy of a block before
+ *        the block changes
+ */
+static void flight_preserve(Flight* flight, size_t word) {
+    for (ReservationSnapshot* snapshot = flight->snapshots; snapshot; snapshot = snapshot->next) {
+        if (!snapshot->preserved[word]) {
+            snapshot_preserve(snapshot, flight, word);
+        }
+    }
+}
+
+/**
+ * @brief Locks every block of a flight, in the order batches use
+ */
+static void flight_lock_blocks(Flight* flight) {
+    for (size_t w = 0; w < BITMAP_WORDS(flight->seat_count); w++) {
+        pthread_mutex_lock(&flight->block_locks[w]);
+    }
+}
+
+static void flight_unlock_blocks(Flight* flight) {
+    for (size_t w = BITMAP_WORDS(flight->seat_count); w > 0; w--) {
+        pthread_mutex_unlock(&flight->block_locks[w - 1]);
+    }
+}
+
+/**
+ * @brief Copies the rest of the flight into its snapshots and unlinks
+ *        them; the caller has exclusive access
+ */
+static void flight_release_snapshots(Flight* flight) {
+    while (flight->snapshots) {
+        ReservationSnapshot* snapshot = flight->snapshots;
+        for (size_t w = 0; w < BITMAP_WORDS(flight->seat_count); w++) {
+            if (!snapshot->preserved[w]) {
+                snapshot_preserve(snapshot, flight, w);
+            }
+        }
+        flight->snapshots = snapshot->next;
+        snapshot->flight = NULL;
+        snapshot->next = NULL;
+    }
+}
+
+/**
+ * @brief Gets a block as a snapshot sees it; the caller holds the system
+ *        lock shared
+ * @param scratch Space for a block read from the flight
+ * @param names Whether to read the seat names too, not just the bitmap
+ */
+static const SeatBlock* snapshot_block(const ReservationSnapshot* snapshot, size_t word,
+                                       SeatBlock* scratch, bool names) {
+    if (__atomic_load_n(&snapshot->preserved[word], __ATOMIC_ACQUIRE)) {
+        return &snapshot->blocks[word];
+    }
+
+    const Flight* flight = snapshot->flight;
+    const SeatNames* seats = &flight->seats[word * BITMAP_WORD_BITS];
+    scratch->occupied = bitmap_word(flight->occupied, word);
+    for (int i = 0; names && i < block_seats(flight->seat_count, word); i++) {
+        scratch->seats[i].first_name = __atomic_load_n(&seats[i].first_name, __ATOMIC_ACQUIRE);
+        scratch->seats[i].last_name = __atomic_load_n(&seats[i].last_name, __ATOMIC_ACQUIRE);
+    }
+
+    /* Whoever changed the block meanwhile set the flag first: reading any
+       of their release stores above makes that flag visible here, and the
+       acquire load orders the reads of the copy after it */
+    return __atomic_load_n(&snapshot->preserved[word], __ATOMIC_ACQUIRE)
+           ? &snapshot->blocks[word] : scratch;
+}
+
+static void snapshot_free(ReservationSnapshot* snapshot) {
+    if (snapshot) {
+        free(snapshot->blocks);
+        free(snapshot->preserved);
+        free(snapshot);
+    }
+}
+
+/*
+ * Name index helpers.  by_name holds the indices of reserved seats ordered
+ * by last name, then first name (both compared ASCII case-insensitively
+ * first, then bytewise), then seat index, so every entry has a unique
+ * position and can be found again by binary search on cancel.  Callers
+ * hold index_lock, or have exclusive access to the system.
+ */
+
+static int ascii_fold(int c) {
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+static int ascii_casecmp_n(const char* a, const char* b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int ca = ascii_fold((unsigned char)a[i]);
+        int cb = ascii_fold((unsigned char)b[i]);
+        if (ca != cb || ca == '\0') return ca - cb;
+    }
+    return 0;
+}
+
+static int name_compare(const char* a, const char* b) {
+    int result = ascii_casecmp_n(a, b, SIZE_MAX);
+    return result ? result : strcmp(a, b);
+}
+
+static int seat_name_compare(const Flight* flight, const NamePool* names, int a, int b) {
+    const SeatNames* sa = &flight->seats[a];
+    const SeatNames* sb = &flight->seats[b];
+
+    /* One pool holds each name once, so equal handles skip the compare */
+    int result = sa->last_name == sb->last_name ? 0 :
+                 name_compare(names_get(names, sa->last_name), names_get(names, sb->last_name));
+    if (result == 0 && sa->first_name != sb->first_name) {
+        result = name_compare(names_get(names, sa->first_name),
+                              names_get(names, sb->first_name));
+    }
+    if (result == 0) result = (a > b) - (a < b);
+    return result;
+}
+
+/**
+ * @brief Finds the first position in by_name not ordered before seat index
+ */
+static int name_index_lower_bound(const Flight* flight, const NamePool* names, int index) {
+    int low = 0;
+    int high = flight->by_name_count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (seat_name_compare(flight, names, flight->by_name[mid], index) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void name_index_insert(Flight* flight, const NamePool* names, int index) {
+    int pos = name_index_lower_bound(flight, names, index);
+    memmove(&flight->by_name[pos + 1], &flight->by_name[pos],
+            (size_t)(flight->by_name_count - pos) * sizeof(int));
+    flight->by_name[pos] = index;
+    flight->by_name_count++;
+    flight_touch(flight, &flight->by_name[pos], (size_t)(flight->by_name_count - pos) * sizeof(int));
+}
+
+static void name_index_remove(Flight* flight, const NamePool* names, int index) {
+    int pos = name_index_lower_bound(flight, names, index);
+    if (pos < flight->by_name_count && flight->by_name[pos] == index) {
+        memmove(&flight->by_name[pos], &flight->by_name[pos + 1],
+                (size_t)(flight->by_name_count - pos - 1) * sizeof(int));
+        flight->by_name_count--;
+        flight_touch(flight, &flight->by_name[pos],
+                     (size_t)(flight->by_name_count - pos) * sizeof(int));
+    }
+}
+
+/**
+ * @brief Bottom-up merge sort of by_name, used when rebuilding after a load
+ */
+static bool name_index_sort(Flight* flight, const NamePool* names) {
+    int n = flight->by_name_count;
+    if (n < 2) return true;
+
+    int* scratch = malloc((size_t)n * sizeof(int));
+    if (!scratch) return false;
+
+    int* src = flight->by_name;
+    int* dst = scratch;
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = lo + width < n ? lo + width : n;
+            int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            int i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                dst[k++] = seat_name_compare(flight, names, src[i], src[j]) <= 0 ? src[i++]
+                                                                                 : src[j++];
+            }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        int* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != flight->by_name) {
+        memcpy(flight->by_name, src, (size_t)n * sizeof(int));
+    }
+    free(scratch);
+    return true;
+}
+
+/**
+ * @brief Rebuilds the occupancy bitmap and name index from the seat names
+ */
+static bool flight_rebuild_indexes(Flight* flight, const NamePool* names) {
+    bitmap_reset(flight->occupied, flight->seat_count);
+    flight->by_name_count = 0;
+    for (int i = 0; i < flight->seat_count; i++) {
+        if (flight->seats[i].last_name != NAME_NONE) {
+            bitmap_set(flight->occupied, i);
+            flight->by_name[flight->by_name_count++] = i;
+        }
+    }
+    flight_touch(flight, flight->occupied, BITMAP_WORDS(flight->seat_count) * sizeof(uint64_t));
+    flight_touch(flight, flight->by_name, (size_t)flight->seat_count * sizeof(int));
+    return name_index_sort(flight, names);
+}
+
+/*
+ * Passenger index: a hash table over (last, first) name, compared ignoring
+ * ASCII case, with one entry per reserved seat of every flight.  It is
+ * split by hash into PASSENGER_STRIPES open-addressing tables, each under
+ * its own mutex.  Entries hold no names: a seat record is filled in before
+ * its entry is added and cleared only after the entry is removed, so the
+ * names behind every entry are stable while its stripe is locked.  Loads
+ * rebuild the whole index once the flights are in place.
+ */
+#define PASSENGER_STRIPES 64            /* At most 64: batches lock them by bit mask */
+
+typedef struct {
+    Flight* flight;                     /* NULL for an empty slot */
+    uint32_t hash;
+    int index;                          /* Seat index within the flight */
+} PassengerEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    PassengerEntry* entries;
+    size_t capacity;                    /* Power of two, or 0 before first use */
+    size_t count;
+} PassengerStripe;
+
+struct ReservationSystem {
+    pthread_rwlock_t lock;              /* Shared for bookings, exclusive otherwise */
+    Flight** flights;                   /* Indexed directly by flight id */
+    size_t flight_capacity;             /* Number of slots in flights */
+    size_t flight_count;                /* Number of non-NULL slots */
+    ReservationJournal* journal;        /* Open after load; NULL while replaying */
+    ReservationDurability durability;
+    ReservationStorage storage;
+    ReservationStore* store;            /* Open after a mapped load */
+    ReservationStatsCollector* stats;   /* NULL when compiled out */
+    ReservationDuplicates duplicates;
+    PassengerStripe passengers[PASSENGER_STRIPES];
+    NamePool* names;                    /* Replaced wholesale by compaction */
+    size_t names_compacted;             /* names_size() after the last compaction */
+    size_t snapshot_count;              /* Open snapshots, which pin the name pool;
+                                           updated atomically */
+    bool initialized;
+};
+
+/*
+ * The system lock is not part of the logical state, so const queries
+ * still take it.
+ */
+
+static void system_read_lock(const ReservationSystem* system) {
+    pthread_rwlock_rdlock((pthread_rwlock_t*)&system->lock);
+}
+
+static void system_write_lock(const ReservationSystem* system) {
+    pthread_rwlock_wrlock((pthread_rwlock_t*)&system->lock);
+}
+
+static void system_unlock(const ReservationSystem* system) {
+    pthread_rwlock_unlock((pthread_rwlock_t*)&system->lock);
+}
+
+static pthread_mutex_t* flight_block_lock(const Flight* flight, int index) {
+    return &flight->block_locks[index / BITMAP_WORD_BITS];
+}
+
+static uint32_t passenger_hash(const char* first_name, const char* last_name) {
+    uint32_t hash = 2166136261u;
+    for (const char* p = last_name; *p; p++) {
+        hash = (hash ^ (uint32_t)ascii_fold((unsigned char)*p)) * 16777619u;
+    }
+    hash *= 16777619u; /* A NUL between the names */
+    for (const char* p = first_name; *p; p++) {
+        hash = (hash ^ (uint32_t)ascii_fold((unsigned char)*p)) * 16777619u;
+    }
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    return hash ^ (hash >> 12);
+}
+
+static PassengerStripe* passenger_stripe(const ReservationSystem* system, uint32_t hash) {
+    return (PassengerStripe*)&system->passengers[hash % PASSENGER_STRIPES];
+}
+
+static size_t passenger_home(uint32_t hash, size_t capacity) {
+    return (hash / PASSENGER_STRIPES) & (capacity - 1);
+}
+
+static void passenger_place(PassengerEntry* entries, size_t capacity,
+                            const PassengerEntry* entry) {
+    size_t slot = passenger_home(entry->hash, capacity);
+    while (entries[slot].flight) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    entries[slot] = *entry;
+}
+
+/*
+ * Stripe operations.  The caller holds the stripe lock, or has exclusive
+ * access to the system.
+ */
+
+/**
+ * @brief Makes room for extra more entries, keeping the table at most 3/4 full
+ */
+static bool passenger_reserve(PassengerStripe* stripe, size_t extra) {
+    size_t needed = stripe->count + extra;
+    if (needed * 4 <= stripe->capacity * 3) return true;
+
+    size_t capacity = stripe->capacity ? stripe->capacity : 16;
+    while (needed * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+    PassengerEntry* entries = calloc(capacity, sizeof(PassengerEntry));
+    if (!entries) return false;
+
+    for (size_t i = 0; i < stripe->capacity; i++) {
+        if (stripe->entries[i].flight) passenger_place(entries, capacity, &stripe->entries[i]);
+    }
+    free(stripe->entries);
+    stripe->entries = entries;
+    stripe->capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Adds a reserved seat; room was made by passenger_reserve
+ */
+static void passenger_insert(PassengerStripe* stripe, Flight* flight, int index, uint32_t hash) {
+    PassengerEntry entry = { flight, hash, index };
+    passenger_place(stripe->entries, stripe->capacity, &entry);
+    stripe->count++;
+}
+
+static void passenger_remove(PassengerStripe* stripe, const Flight* flight, int index,
+                             uint32_t hash) {
+    if (stripe->capacity == 0) return;
+
+    size_t mask = stripe->capacity - 1;
+    PassengerEntry* entries = stripe->entries;
+    size_t hole = passenger_home(hash, stripe->capacity);
+    while (entries[hole].flight &&
+           (entries[hole].flight != flight || entries[hole].index != index)) {
+        hole = (hole + 1) & mask;
+    }
+    if (!entries[hole].flight) return;
+
+    /* Backward shift: pull later entries of the run into the hole unless
+       their home slot lies after it, so no probe sequence is broken */
+    for (size_t next = (hole + 1) & mask; entries[next].flight; next = (next + 1) & mask) {
+        size_t home = passenger_home(entries[next].hash, stripe->capacity);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            entries[hole] = entries[next];
+            hole = next;
+        }
+    }
+    entries[hole].flight = NULL;
+    stripe->count--;
+}
+
+/**
+ * @brief Finds a passenger's seats, on one flight or on any when flight is NULL
+ * @return Number of seats found; the first max_seats are stored
+ */
+static size_t passenger_find(const NamePool* names, const PassengerStripe* stripe,
+                             uint32_t hash, const char* first_name, const char* last_name,
+                             const Flight* flight, ReservationSeat* seats, size_t max_seats) {
+    if (stripe->capacity == 0) return 0;
+
+    size_t found = 0;
+    size_t mask = stripe->capacity - 1;
+    for (size_t slot = passenger_home(hash, stripe->capacity); stripe->entries[slot].flight;
+         slot = (slot + 1) & mask) {
+        const PassengerEntry* entry = &stripe->entries[slot];
+        if (entry->hash != hash || (flight && entry->flight != flight)) continue;
+
+        const SeatNames* seat = &entry->flight->seats[entry->index];
+        if (ascii_casecmp_n(names_get(names, seat->last_name), last_name, SIZE_MAX) != 0 ||
+            ascii_casecmp_n(names_get(names, seat->first_name), first_name, SIZE_MAX) != 0) {
+            continue;
+        }
+        if (found < max_seats) {
+            seats[found].flight_id = entry->flight->flight_id;
+            seats[found].seat_number = entry->index + 1;
+        }
+        found++;
+    }
+    return found;
+}
+
+/**
+ * @brief Tells whether the duplicate policy rejects booking a passenger on
+ *        a flight; the caller holds the stripe lock
+ */
+static bool passenger_is_duplicate(const ReservationSystem* system,
+                                   const PassengerStripe* stripe, uint32_t hash,
+                                   const char* first_name, const char* last_name,
+                                   const Flight* flight) {
+    if (system->duplicates == RESERVATION_DUPLICATES_ALLOW) return false;
+
+    const Flight* scope = system->duplicates == RESERVATION_DUPLICATES_PER_FLIGHT ? flight : NULL;
+    return passenger_find(system->names, stripe, hash, first_name, last_name, scope,
+                          NULL, 0) > 0;
+}
+
+/**
+ * @brief Removes a reserved seat before its record is cleared
+ */
+static void passenger_forget(const ReservationSystem* system, const Flight* flight, int index) {
+    const SeatNames* seat = &flight->seats[index];
+    uint32_t hash = passenger_hash(names_get(system->names, seat->first_name),
+                                   names_get(system->names, seat->last_name));
+    PassengerStripe* stripe = passenger_stripe(system, hash);
+
+    pthread_mutex_lock(&stripe->lock);
+    passenger_remove(stripe, flight, index, hash);
+    pthread_mutex_unlock(&stripe->lock);
+}
+
+/**
+ * @brief Empties the passenger index; the caller has exclusive access
+ */
+static void passenger_clear(ReservationSystem* system) {
+    for (size_t i = 0; i < PASSENGER_STRIPES; i++) {
+        PassengerStripe* stripe = &system->passengers[i];
+        if (stripe->entries) memset(stripe->entries, 0, stripe->capacity * sizeof(PassengerEntry));
+        stripe->count = 0;
+    }
+}
+
+/**
+ * @brief Refills the passenger index from every flight's name index; the
+ *        caller has exclusive access
+ */
+static ReservationResult passenger_rebuild(ReservationSystem* system) {
+    passenger_clear(system);
+    for (size_t i = 0; i < system->flight_capacity; i++) {
+        Flight* flight = system->flights[i];
+        for (int n = 0; flight && n < flight->by_name_count; n++) {
+            int index = flight->by_name[n];
+            const SeatNames* seat = &flight->seats[index];
+            uint32_t hash = passenger_hash(names_get(system->names, seat->first_name),
+                                           names_get(system->names, seat->last_name));
+            PassengerStripe* stripe = passenger_stripe(system, hash);
+            if (!passenger_reserve(stripe, 1)) return RESERVATION_ERROR_MEMORY;
+            passenger_insert(stripe, flight, index, hash);
+        }
+    }
+    return RESERVATION_SUCCESS;
+}
+
+static bool flight_init_locks(Flight* flight, int seat_count) {
+    size_t blocks = BITMAP_WORDS(seat_count);
+    flight->block_locks = malloc(blocks * sizeof(pthread_mutex_t));
+    if (!flight->block_locks) return false;
+
+    for (size_t i = 0; i < blocks; i++) {
+        pthread_mutex_init(&flight->block_locks[i], NULL);
+    }
+    pthread_mutex_init(&flight->index_lock, NULL);
+    return true;
+}
+
+static void flight_destroy_locks(Flight* flight) {
+    size_t blocks = BITMAP_WORDS(flight->seat_count);
+    for (size_t i = 0; i < blocks; i++) {
+        pthread_mutex_destroy(&flight->block_locks[i]);
+    }
+    pthread_mutex_destroy(&flight->index_lock);
+    free(flight->block_locks);
+}
+
+static Flight* flight_create(int flight_id, int seat_count) {
+    Flight* flight = malloc(sizeof(Flight));
+    if (!flight) return NULL;
+
+    flight->seats = calloc((size_t)seat_count, sizeof(SeatNames));
+    flight->occupied = malloc(BITMAP_WORDS(seat_count) * sizeof(uint64_t));
+    flight->by_name = malloc((size_t)seat_count * sizeof(int));
+    if (!flight->seats || !flight->occupied || !flight->by_name ||
+        !flight_init_locks(flight, seat_count)) {
+        free(flight->seats);
+        free(flight->occupied);
+        free(flight->by_name);
+        free(flight);
+        return NULL;
+    }
+
+    flight->flight_id = flight_id;
+    flight->seat_count = seat_count;
+    flight->records = NULL;
+    bitmap_reset(flight->occupied, seat_count);
+    flight->by_name_count = 0;
+    flight->store = NULL;
+    flight->store_slot = -1;
+    flight->snapshots = NULL;
+    return flight;
+}
+
+/**
+ * @brief Wraps a mapped store region; the arrays stay owned by the store
+ *        except for the seat names, which start out free
+ */
+static Flight* flight_attach(ReservationStore* store, const StoreFlight* mapped) {
+    Flight* flight = malloc(sizeof(Flight));
+    if (!flight) return NULL;
+
+    flight->seats = calloc((size_t)mapped->seat_count, sizeof(SeatNames));
+    if (!flight->seats || !flight_init_locks(flight, mapped->seat_count)) {
+        free(flight->seats);
+        free(flight);
+        return NULL;
+    }
+
+    flight->flight_id = mapped->flight_id;
+    flight->seat_count = mapped->seat_count;
+    flight->records = mapped->seats;
+    flight->occupied = mapped->occupied;
+    flight->by_name = mapped->by_name;
+    flight->by_name_count = mapped->name_count;
+    flight->store = store;
+    flight->store_slot = mapped->slot;
+    flight->snapshots = NULL;
+    return flight;
+}
+
+/**
+ * @brief Creates a flight inside the mapped store
+ */
+static Flight* flight_create_mapped(ReservationStore* store, int flight_id, int seat_count) {
+    StoreFlight mapped;
+    if (!store_add_flight(store, flight_id, seat_count, &mapped)) return NULL;
+
+    Flight* flight = flight_attach(store, &mapped);
+    if (!flight) {
+        store_remove_flight(store, mapped.slot);
+        return NULL;
+    }
+
+    for (int i = 0; i < seat_count; i++) {
+        flight->records[i].seat_number = i + 1;
+    }
+    bitmap_reset(flight->occupied, seat_count);
+    return flight;
+}
+
+/**
+ * @brief Tells whether a mapped record holds a terminated, non-empty name
+ */
+static bool record_name_is_valid(const char* name) {
+    return name[0] != '\0' && memchr(name, '\0', MAX_NAME_LENGTH) != NULL;
+}
+
+/**
+ * @brief Fills a mapped flight's seat names from its records
+ * @param clean true when the bitmap and name index in the store are up to
+ *              date; otherwise the records alone are trusted and the
+ *              caller rebuilds both
+ * @return RESERVATION_SUCCESS, RESERVATION_ERROR_MEMORY, or
+ *         RESERVATION_ERROR_FILE_IO when a seat marked taken has no name
+ */
+static ReservationResult flight_load_records(Flight* flight, NamePool* names, bool clean) {
+    size_t words = BITMAP_WORDS(flight->seat_count);
+    int next = clean ? bitmap_next(flight->occupied, words, 0, true) : 0;
+    for (int i = next; i < flight->seat_count;
+         i = clean ? bitmap_next(flight->occupied, words, i + 1, true) : i + 1) {
+        const Reservation* record = &flight->records[i];
+        if (!clean && !record->is_reserved) continue;
+
+        if (!record_name_is_valid(record->first_name) ||
+            !record_name_is_valid(record->last_name)) {
+            if (clean) return RESERVATION_ERROR_FILE_IO;
+            continue; /* Torn by a crash: the journal has the booking, if anyone */
+        }
+        SeatNames* seat = &flight->seats[i];
+        seat->first_name = names_intern(names, record->first_name);
+        seat->last_name = names_intern(names, record->last_name);
+        if (seat->first_name == NAME_NONE || seat->last_name == NAME_NONE) {
+            return RESERVATION_ERROR_MEMORY;
+        }
+    }
+    return RESERVATION_SUCCESS;
+}
+
+static void flight_destroy(Flight* flight) {
+    if (flight) {
+        flight_release_snapshots(flight);
+        flight_destroy_locks(flight);
+        free(flight->seats);
+        if (!flight->store) {
+            free(flight->occupied);
+            free(flight->by_name);
+        }
+        free(flight);
+    }
+}
+
+/**
+ * @brief Destroys a flight and, when mapped, releases its store region
+ */
+static void flight_discard(Flight* flight) {
+    if (flight && flight->store) {
+        store_remove_flight(flight->store, flight->store_slot);
+    }
+    flight_destroy(flight);
+}
+
+static Flight* flight_lookup(const ReservationSystem* system, int flight_id) {
+    if (!system || flight_id < 0 || (size_t)flight_id >= system->flight_capacity) {
+        return NULL;
+    }
+    return system->flights[flight_id];
+}
+
+static bool flight_is_valid_seat(const Flight* flight, int seat_number) {
+    return flight && seat_number >= 1 && seat_number <= flight->seat_count;
+}
+
+/**
+ * @brief Grows the flight table so that flight_id has a slot
+ */
+static bool flight_table_reserve(ReservationSystem* system, int flight_id) {
+    if ((size_t)flight_id < system->flight_capacity) return true;
+
+    size_t capacity = system->flight_capacity ? system->flight_capacity : 16;
+    while (capacity <= (size_t)flight_id) {
+        capacity *= 2;
+    }
+    if (capacity > MAX_FLIGHTS) capacity = MAX_FLIGHTS;
+
+    Flight** flights = realloc(system->flights, capacity * sizeof(Flight*));
+    if (!flights) return false;
+
+    memset(flights + system->flight_capacity, 0,
+           (capacity - system->flight_capacity) * sizeof(Flight*));
+    system->flights = flights;
+    system->flight_capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Installs a flight into its slot, replacing any previous flight
+ */
+static ReservationResult flight_install(ReservationSystem* system, Flight* flight) {
+    if (!flight_table_reserve(system, flight->flight_id)) {
+        return RESERVATION_ERROR_MEMORY;
+    }
+
+    flight->available = 0;
+    for (size_t w = 0; w < BITMAP_WORDS(flight->seat_count); w++) {
+        flight->available += __builtin_popcountll(~bitmap_word(flight->occupied, w));
+    }
+
+    Flight* previous = system->flights[flight->flight_id];
+    if (previous) {
+        flight_destroy(previous);
+    } else {
+        system->flight_count++;
+    }
+    system->flights[flight->flight_id] = flight;
+    return RESERVATION_SUCCESS;
+}
+
+/**
+ * @brief Appends a record to the journal, if one is open
+ */
+static ReservationResult journal_log(ReservationSystem* system, JournalOp op, int flight_id,
+                                     int value, const char* first_name, const char* last_name) {
+    if (!system->journal) return RESERVATION_SUCCESS;
+
+    JournalRecord record = { op, flight_id, value, first_name, last_name };
+    return journal_append(system->journal, &record);
+}
+
+/**
+ * @brief Interns the names of a booking the journal already holds
+ *
+ * Names go into the pool only once the journal took the booking, so a
+ * failed append leaves nothing behind.  Should the pool then run out of
+ * memory, the seats are cancelled in the journal as well, so replay does
+ * not bring back a booking the caller was told failed.
+ * @param records Scratch space for count journal records
+ * @return RESERVATION_SUCCESS, RESERVATION_ERROR_MEMORY, or the journal's
+ *         error if the cancellation could not be logged either
+ */
+static ReservationResult names_intern_logged(ReservationSystem* system, int flight_id,
+                                             const ReservationRequest* requests, size_t count,
+                                             SeatNames* handles, JournalRecord* records) {
+    size_t i = 0;
+    for (; i < count; i++) {
+        handles[i].first_name = names_intern(system->names, requests[i].first_name);
+        handles[i].last_name = names_intern(system->names, requests[i].last_name);
+        if (handles[i].first_name == NAME_NONE || handles[i].last_name == NAME_NONE) break;
+    }
+    if (i == count) return RESERVATION_SUCCESS;
+    if (!system->journal) return RESERVATION_ERROR_MEMORY;
+
+    for (i = 0; i < count; i++) {
+        JournalRecord record = { JOURNAL_OP_CANCEL, flight_id, requests[i].seat_number,
+                                 NULL, NULL };
+        records[i] = record;
+    }
+    ReservationResult result = count == 1 ? journal_append(system->journal, records)
+                                          : journal_append_group(system->journal, records, count);
+    return result == RESERVATION_SUCCESS ? RESERVATION_ERROR_MEMORY : result;
+}
+
+static ReservationResult system_save(ReservationSystem* system);
+
+/**
+ * @brief Tells whether the journal has reached the compaction threshold
+ */
+static bool compact_due(const ReservationSystem* system) {
+    unsigned int threshold = system->durability.compact_every_ops;
+    return system->journal && threshold && journal_record_count(system->journal) >= threshold;
+}
+
+/**
+ * @brief Folds the journal into a snapshot once the policy threshold is hit;
+ *        the caller holds the system lock exclusively
+ */
+static void journal_maybe_compact(ReservationSystem* system) {
+    if (compact_due(system)) {
+        system_save(system); /* On failure the journal keeps growing */
+    }
+}
+
+/*
+ * Seat changes.  The caller holds the seat's block lock (or has exclusive
+ * access); the names are in place before the seat's bit is published.
+ */
+
+/**
+ * @brief Copies a seat's names out as a public record
+ */
+static void seat_names_export(const NamePool* names, const SeatNames* seat, int seat_number,
+                              Reservation* reservation) {
+    reservation->seat_number = seat_number;
+    reservation->is_reserved = seat->last_name != NAME_NONE;
+    strncpy(reservation->first_name, names_get(names, seat->first_name), MAX_NAME_LENGTH - 1);
+    strncpy(reservation->last_name, names_get(names, seat->last_name), MAX_NAME_LENGTH - 1);
+    reservation->first_name[MAX_NAME_LENGTH - 1] = '\0';
+    reservation->last_name[MAX_NAME_LENGTH - 1] = '\0';
+}
+
+static void seat_export(const Flight* flight, const NamePool* names, int index,
+                        Reservation* reservation) {
+    seat_names_export(names, &flight->seats[index], index + 1, reservation);
+}
+
+/**
+ * @brief Adjusts the free seat count, once per booking call
+ */
+static void flight_add_available(Flight* flight, int delta) {
+    __atomic_fetch_add(&flight->available, delta, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Mirrors a seat into its mapped record, if the flight has one
+ */
+static void flight_write_record(Flight* flight, const NamePool* names, int index) {
+    if (flight->records) {
+        seat_export(flight, names, index, &flight->records[index]);
+        flight_touch(flight, &flight->records[index], sizeof(Reservation));
+    }
+}
+
+static void flight_apply_make(Flight* flight, const NamePool* names, int index,
+                              NameHandle first_name, NameHandle last_name) {
+    /* Release stores: snapshot readers copy seats without the block lock */
+    flight_preserve(flight, (size_t)index / BITMAP_WORD_BITS);
+    __atomic_store_n(&flight->seats[index].first_name, first_name, __ATOMIC_RELEASE);
+    __atomic_store_n(&flight->seats[index].last_name, last_name, __ATOMIC_RELEASE);
+    flight_write_record(flight, names, index);
+    bitmap_set(flight->occupied, index);
+    flight_touch(flight, &flight->occupied[index / BITMAP_WORD_BITS], sizeof(uint64_t));
+
+    pthread_mutex_lock(&flight->index_lock);
+    name_index_insert(flight, names, index);
+    pthread_mutex_unlock(&flight->index_lock);
+}
+
+static void flight_apply_cancel(Flight* flight, const NamePool* names, int index) {
+    pthread_mutex_lock(&flight->index_lock);
+    name_index_remove(flight, names, index);
+    pthread_mutex_unlock(&flight->index_lock);
+
+    flight_preserve(flight, (size_t)index / BITMAP_WORD_BITS);
+    bitmap_clear(flight->occupied, index);
+    __atomic_store_n(&flight->seats[index].first_name, NAME_NONE, __ATOMIC_RELEASE);
+    __atomic_store_n(&flight->seats[index].last_name, NAME_NONE, __ATOMIC_RELEASE);
+    flight_write_record(flight, names, index);
+    flight_touch(flight, &flight->occupied[index / BITMAP_WORD_BITS], sizeof(uint64_t));
+}
+
+static ReservationResult flight_add(ReservationSystem* system, int flight_id, int seat_count);
+
+ReservationSystem* reservation_system_create(void) {
+    ReservationSystem* system = calloc(1, sizeof(ReservationSystem));
+    if (!system) return NULL;
+
+    if (pthread_rwlock_init(&system->lock, NULL) != 0) {
+        free(system);
+        return NULL;
+    }
+    for (size_t i = 0; i < PASSENGER_STRIPES; i++) {
+        pthread_mutex_init(&system->passengers[i].lock, NULL);
+    }
+    system->durability.sync_every_ops = 1;
+    system->durability.compact_every_ops = RESERVATION_DEFAULT_COMPACT_OPS;
+
+    system->stats = stats_create();
+    system->names = names_create();
+    if ((STATS_ENABLED && !system->stats) || !system->names ||
+        flight_add(system, DEFAULT_FLIGHT_ID, MAX_SEATS) != RESERVATION_SUCCESS) {
+        reservation_system_destroy(system);
+        return NULL;
+    }
+    system->initialized = true;
+    return system;
+}
+
+/**
+ * @brief Records each mapped flight's name index length in the store
+ */
+static void store_record_name_counts(const ReservationSystem* system) {
+    for (size_t i = 0; i < system->flight_capacity; i++) {
+        const Flight* flight = system->flights[i];
+        if (flight && flight->store) {
+            store_set_name_count(flight->store, flight->store_slot, flight->by_name_count);
+        }
+    }
+}
+
+void reservation_system_destroy(ReservationSystem* system) {
+    if (system) {
+        if (system->store) {
+            store_record_name_counts(system);
+            store_close(system->store, true);
+        }
+        for (size_t i = 0; i < system->flight_capacity; i++) {
+            flight_destroy(system->flights[i]);
+        }
+        journal_close(system->journal);
+        stats_destroy(system->stats);
+        names_destroy(system->names);
+        for (size_t i = 0; i < PASSENGER_STRIPES; i++) {
+            pthread_mutex_destroy(&system->passengers[i].lock);
+            free(system->passengers[i].entries);
+        }
+        pthread_rwlock_destroy(&system->lock);
+        free(system->flights);
+        free(system);
+    }
+}
+
+/**
+ * @brief Adds a flight; the caller holds the system lock exclusively
+ */
+static ReservationResult flight_add(ReservationSystem* system, int flight_id, int seat_count) {
+    if (flight_id < 0 || flight_id >= MAX_FLIGHTS) {
+        return RESERVATION_ERROR_INVALID_FLIGHT;
+    }
+    if (seat_count < 1 || seat_count > MAX_FLIGHT_SEATS) {
+        return RESERVATION_ERROR_INVALID_SEAT;
+    }
+    if (flight_lookup(system, flight_id)) {
+        return RESERVATION_ERROR_INVALID_FLIGHT;
+    }
+
+    if (!flight_table_reserve(system, flight_id)) {
+        return RESERVATION_ERROR_MEMORY;
+    }
+
+    Flight* flight = system->store ? flight_create_mapped(system->store, flight_id, seat_count)
+                                   : flight_create(flight_id, seat_count);
+    if (!flight) {
+        return system->store ? RESERVATION_ERROR_FILE_IO : RESERVATION_ERROR_MEMORY;
+    }
+
+    ReservationResult result = journal_log(system, JOURNAL_OP_FLIGHT_ADD, flight_id,
+                                           seat_count, NULL, NULL);
+    if (result != RESERVATION_SUCCESS) {
+        flight_discard(flight);
+        return result;
+    }
+
+    flight_install(system, flight);
+    return RESERVATION_SUCCESS;
+}
+
+/**
+ * @brief Removes a flight; the caller holds the system lock exclusively
+ */
+static ReservationResult flight_remove(ReservationSystem* system, int flight_id) {
+    if (flight_id == DEFAULT_FLIGHT_ID || !flight_lookup(system, flight_id)) {
+        return RESERVATION_ERROR_INVALID_FLIGHT;
+    }
+
+    ReservationResult result = journal_log(system, JOURNAL_OP_FLIGHT_REMOVE, flight_id,
+                                           0, NULL, NULL);
+    if (result != RESERVATION_SUCCESS) return result;
+
+    Flight* flight = system->flights[flight_id];
+    for (int n = 0; n < flight->by_name_count; n++) {
+        passenger_forget(system, flight, flight->by_name[n]);
+    }
+    flight_discard(flight);
+    system->flights[flight_id] = NULL;
+    system->flight_count--;
+    return RESERVATION_SUCCESS;
+}
+
+ReservationResult reservation_flight_add(ReservationSystem* system, int flight_id,
+                                       int seat_count) {
+    if (!system) return RESERVATION_ERROR_SYSTEM;
+
+    system_write_lock(system);
+    ReservationResult result = flight_add(system, flight_id, seat_count);
+    if (result == RESERVATION_SUCCESS) journal_maybe_compact(system);
+    system_unlock(system);
+    return result;
+}
+
+ReservationResult reservation_flight_remove(ReservationSystem* system, int flight_id) {
+    if (!system) return RESERVATION_ERROR_SYSTEM;
+
+    system_write_lock(system);
+    ReservationResult result = flight_remove(system, flight_id);
+    if (result == RESERVATION_SUCCESS) journal_maybe_compact(system);
+    system_unlock(system);
+    return result;
+}
+
+int reservation_flight_seat_count(const ReservationSystem* system, int flight_id) {
+    if (!system) return -1;
+
+    system_read_lock(system);
+    const Flight* flight = flight_lookup(system, flight_id);
+    int seat_count = flight ? flight->seat_count : -1;
+    system_unlock(system);
+    return seat_count;
+}
+
+int reservation_flight_list(const ReservationSystem* system, int* flight_ids,
+                          size_t max_flights) {
+    if (!system || !flight_ids) return -1;
+
+    system_read_lock(system);
+    size_t count = 0;
+    for (size_t i = 0; i < system->flight_capacity && count < max_flights; i++) {
+        if (system->flights[i]) {
+            flight_ids[count++] = (int)i;
+        }
+    }
+    system_unlock(system);
+    return (int)count;
+}
+
+/**
+ * @brief Books a seat; the caller holds the system lock shared
+ */
+static ReservationResult flight_make(ReservationSystem* system, int flight_id,
+                                     int seat_number, const char* first_name,
+                                     const char* last_name) {
+    Flight* flight = flight_lookup(system, flight_id);
+    if (!flight) return RESERVATION_ERROR_INVALID_FLIGHT;
+    if (!flight_is_valid_seat(flight, seat_number)) {
+        return RESERVATION_ERROR_INVALID_SEAT;
+    }
+
+    if (!reservation_is_valid_name(first_name) || !reservation_is_valid_name(last_name)) {
+        return RESERVATION_ERROR_INVALID_NAME;
+    }
+
+    /* A taken seat is reported without locking */
+    int index = seat_number - 1;
+    if (bitmap_test(flight->occupied, index)) {
+        return RESERVATION_ERROR_SEAT_OCCUPIED;
+    }
+
+    /* Re-checked under the block lock: of two racing bookings for one
+       seat, exactly one gets past this point */
+    pthread_mutex_t* block = flight_block_lock(flight, index);
+    pthread_mutex_lock(block);
+    ReservationResult result = RESERVATION_ERROR_SEAT_OCCUPIED;
+    if (!bitmap_test(flight->occupied, index)) {
+        /* The stripe stays locked from the duplicate check to the insert */
+        uint32_t hash = passenger_hash(first_name, last_name);
+        PassengerStripe* stripe = passenger_stripe(system, hash);
+        pthread_mutex_lock(&stripe->lock);
+        ReservationRequest request = { seat_number, first_name, last_name };
+        SeatNames handles;
+        JournalRecord scratch;
+        if (passenger_is_duplicate(system, stripe, hash, first_name, last_name, flight)) {
+            result = RESERVATION_ERROR_DUPLICATE_PASSENGER;
+        } else if (!passenger_reserve(stripe, 1)) {
+            result = RESERVATION_ERROR_MEMORY;
+        } else {
+            result = journal_log(system, JOURNAL_OP_MAKE, flight_id, seat_number,
+                                 first_name, last_name);
+            if (result == RESERVATION_SUCCESS) {
+                result = names_intern_logged(system, flight_id, &request, 1, &handles,
+                                             &scratch);
+            }
+        }
+        if (result == RESERVATION_SUCCESS) {
+            flight_apply_make(flight, system->names, index, handles.first_name,
+                              handles.last_name);
+            flight_add_available(flight, -1);
+            passenger_insert(stripe, flight, index, hash);
+        }
+        pthread_mutex_unlock(&stripe->lock);
+    }
+    pthread_mutex_unlock(block);
+    return result;
+}
+
+/**
+ * @brief Cancels a booking; the caller holds the system lock shared
+ */
+static ReservationResult flight_cancel(ReservationSystem* system, int flight_id,
+                                       int seat_number) {
+    Flight* flight = flight_lookup(system, flight_id);
+    if (!flight) return RESERVATION_ERROR_INVALID_FLIGHT;
+    if (!flight_is_valid_seat(flight, seat_number)) {
+        return RESERVATION_ERROR_INVALID_SEAT;
+    }
+
+    int index = seat_number - 1;
+    pthread_mutex_t* block = flight_block_lock(flight, index);
+    pthread_mutex_lock(block);
+    ReservationResult result = RESERVATION_ERROR_SEAT_EMPTY;
+    if (bitmap_test(flight->occupied, index)) {
+        result = journal_log(system, JOURNAL_OP_CANCEL, flight_id, seat_number, NULL, NULL);
+        if (result == RESERVATION_SUCCESS) {
+            passenger_forget(system, flight, index);
+            flight_apply_cancel(flight, system->names, index);
+            flight_add_available(flight, 1);
+        }
+    }
+    pthread_mutex_unlock(block);
+    return result;
+}
+
+/**
+ * @brief Releases the shared lock and compacts the journal if it is due
+ */
+static void system_unlock_and_compact(ReservationSystem* system, ReservationResult result) {
+    bool compact = result == RESERVATION_SUCCESS && compact_due(system);
+    system_unlock(system);
+
+    if (compact) {
+        system_write_lock(system);
+        journal_maybe_compact(system); /* Another thread may have compacted already */
+        system_unlock(system);
+    }
+}
+
+ReservationResult reservation_flight_make(ReservationSystem* system, int flight_id,
+                                        int seat_number, const char* first_name,
+                                        const char* last_name) {
+    if (!system) return RESERVATION_ERROR_SYSTEM;
+
+    uint64_t start = stats_begin(RESERVATION_OP_MAKE);
+    system_read_lock(system);
+    ReservationResult result = flight_make(system, flight_id, seat_number,
+                                           first_name, last_name);
+    system_unlock_and_compact(system, result);
+    stats_record(system->stats, RESERVATION_OP_MAKE, result, start);
+    return result;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Tells whether an earlier item of a batch books the same passenger,
+ *        and adds the item if not
+ * @param table Item numbers + 1 placed by hash; size is a power of two
+ */
+static bool batch_repeats_passenger(int* table, size_t size, const ReservationRequest* requests,
+                                    const uint32_t* hashes, size_t item) {
+    size_t slot = hashes[item] & (size - 1);
+    for (; table[slot]; slot = (slot + 1) & (size - 1)) {
+        size_t other = (size_t)table[slot] - 1;
+        if (hashes[other] == hashes[item] &&
+            ascii_casecmp_n(requests[other].last_name, requests[item].last_name, SIZE_MAX) == 0 &&
+            ascii_casecmp_n(requests[other].first_name, requests[item].first_name,
+                            SIZE_MAX) == 0) {
+            return true;
+        }
+    }
+    table[slot] = (int)item + 1;
+    return false;
+}
+
+/**
+ * @brief Checks a batch against the seats and passengers and commits it if
+ *        every item passes; the caller holds the system lock shared and
+ *        the block and passenger stripe locks of every valid item
+ */
+static ReservationResult flight_commit_batch(ReservationSystem* system, Flight* flight,
+                                             const ReservationRequest* requests, size_t count,
+                                             const uint32_t* hashes,
+                                             ReservationResult* outcome) {
+    size_t table_size = 1;
+    while (table_size < 2 * count) {
+        table_size *= 2;
+    }
+    bool unique = system->duplicates != RESERVATION_DUPLICATES_ALLOW;
+    uint64_t* seen = calloc(BITMAP_WORDS(flight->seat_count), sizeof(uint64_t));
+    int* names = unique ? calloc(table_size, sizeof(int)) : NULL;
+    JournalRecord* records = malloc(count * sizeof(JournalRecord));
+    SeatNames* handles = malloc(count * sizeof(SeatNames));
+    if (!seen || (unique && !names) || !records || !handles) {
+        free(seen);
+        free(names);
+        free(records);
+        free(handles);
+        return RESERVATION_ERROR_MEMORY;
+    }
+
+    ReservationResult result = RESERVATION_SUCCESS;
+    size_t extra[PASSENGER_STRIPES] = { 0 };
+    for (size_t i = 0; i < count; i++) {
+        int index = requests[i].seat_number - 1;
+        if (outcome[i] == RESERVATION_SUCCESS &&
+            (bitmap_test(flight->occupied, index) || bitmap_test(seen, index))) {
+            outcome[i] = RESERVATION_ERROR_SEAT_OCCUPIED;
+        }
+        if (outcome[i] == RESERVATION_SUCCESS && unique &&
+            (passenger_is_duplicate(system, passenger_stripe(system, hashes[i]), hashes[i],
+                                    requests[i].first_name, requests[i].last_name, flight) ||
+             batch_repeats_passenger(names, table_size, requests, hashes, i))) {
+            outcome[i] = RESERVATION_ERROR_DUPLICATE_PASSENGER;
+        }
+        if (outcome[i] != RESERVATION_SUCCESS) {
+            if (result == RESERVATION_SUCCESS) result = outcome[i];
+            continue;
+        }
+        seen[index / BITMAP_WORD_BITS] |= UINT64_C(1) << (index % BITMAP_WORD_BITS);
+        extra[hashes[i] % PASSENGER_STRIPES]++;
+
+        JournalRecord record = { JOURNAL_OP_MAKE, flight->flight_id, requests[i].seat_number,
+                                 requests[i].first_name, requests[i].last_name };
+        records[i] = record;
+    }
+
+    /* Only the stripes this batch locked have extra entries */
+    for (size_t i = 0; result == RESERVATION_SUCCESS && i < PASSENGER_STRIPES; i++) {
+        if (extra[i] && !passenger_reserve(&system->passengers[i], extra[i])) {
+            result = RESERVATION_ERROR_MEMORY;
+        }
+    }
+    if (result == RESERVATION_SUCCESS) {
+        result = system->journal ? journal_append_group(system->journal, records, count)
+                                 : RESERVATION_SUCCESS;
+        if (result == RESERVATION_SUCCESS) {
+            result = names_intern_logged(system, flight->flight_id, requests, count, handles,
+                                         records);
+        }
+        for (size_t i = 0; result != RESERVATION_SUCCESS && i < count; i++) {
+            outcome[i] = result;
+        }
+    }
+    if (result == RESERVATION_SUCCESS) {
+        for (size_t i = 0; i < count; i++) {
+            int index = requests[i].seat_number - 1;
+            flight_apply_make(flight, system->names, index, handles[i].first_name,
+                              handles[i].last_name);
+            passenger_insert(passenger_stripe(system, hashes[i]), flight, index, hashes[i]);
+        }
+        flight_add_available(flight, -(int)count);
+    }
+
+    free(seen);
+    free(names);
+    free(records);
+    free(handles);
+    return result;
+}
+
+/**
+ * @brief Books a batch of seats; the caller holds the system lock shared
+ */
+static ReservationResult flight_make_batch(ReservationSystem* system, int flight_id,
+                                           const ReservationRequest* requests, size_t count,
+                                           ReservationResult* outcome) {
+    Flight* flight = flight_lookup(system, flight_id);
+    if (!flight) return RESERVATION_ERROR_INVALID_FLIGHT;
+
+    int* blocks = malloc(count * sizeof(int));
+    uint32_t* hashes = malloc(count * sizeof(uint32_t));
+    if (!blocks || !hashes) {
+        free(blocks);
+        free(hashes);
+        return RESERVATION_ERROR_MEMORY;
+    }
+
+    /* Validate what needs no lock and collect the blocks and stripes to lock */
+    size_t block_count = 0;
+    uint64_t stripes = 0;
+    for (size_t i = 0; i < count; i++) {
+        const ReservationRequest* request = &requests[i];
+        outcome[i] = RESERVATION_SUCCESS;
+        if (!flight_is_valid_seat(flight, request->seat_number)) {
+            outcome[i] = RESERVATION_ERROR_INVALID_SEAT;
+        } else if (!reservation_is_valid_name(request->first_name) ||
+                   !reservation_is_valid_name(request->last_name)) {
+            outcome[i] = RESERVATION_ERROR_INVALID_NAME;
+        } else {
+            blocks[block_count++] = (request->seat_number - 1) / BITMAP_WORD_BITS;
+            hashes[i] = passenger_hash(request->first_name, request->last_name);
+            stripes |= UINT64_C(1) << (hashes[i] % PASSENGER_STRIPES);
+        }
+    }
+
+    /* Ascending lock order keeps concurrent batches deadlock free */
+    qsort(blocks, block_count, sizeof(int), compare_ints);
+    size_t unique = 0;
+    for (size_t i = 0; i < block_count; i++) {
+        if (unique == 0 || blocks[unique - 1] != blocks[i]) {
+            blocks[unique++] = blocks[i];
+        }
+    }
+    for (size_t i = 0; i < unique; i++) {
+        pthread_mutex_lock(&flight->block_locks[blocks[i]]);
+    }
+    for (size_t i = 0; i < PASSENGER_STRIPES; i++) {
+        if (stripes >> i & 1) pthread_mutex_lock(&system->passengers[i].lock);
+    }
+
+    ReservationResult result = flight_commit_batch(system, flight, requests, count, hashes,
+                                                   outcome);
+
+    for (size_t i = PASSENGER_STRIPES; i > 0; i--) {
+        if (stripes >> (i - 1) & 1) pthread_mutex_unlock(&system->passengers[i - 1].lock);
+    }
+    for (size_t i = unique; i > 0; i--) {
+        pthread_mutex_unlock(&flight->block_locks[blocks[i - 1]]);
+    }
+    free(blocks);
+    free(hashes);
+    return result;
+}
+
+ReservationResult reservation_flight_make_batch(ReservationSystem* system, int flight_id,
+                                              const ReservationRequest* requests, size_t count,
+                                              ReservationResult* results) {
+    if (!system || (!requests && count > 0)) return RESERVATION_ERROR_SYSTEM;
+    if (count == 0) return RESERVATION_SUCCESS;
+
+    ReservationResult* outcome = results ? results : malloc(count * sizeof(ReservationResult));
+    if (!outcome) return RESERVATION_ERROR_MEMORY;
+
+    uint64_t start = stats_begin(RESERVATION_OP_MAKE);
+    system_read_lock(system);
+    ReservationResult result = flight_make_batch(system, flight_id, requests, count, outcome);
+    system_unlock_and_compact(system, result);
+    stats_record(system->stats, RESERVATION_OP_MAKE, result, start);
+
+    /* Errors that concern the whole batch are reported for every item */
+    if (result == RESERVATION_ERROR_INVALID_FLIGHT || result == RESERVATION_ERROR_MEMORY) {
+        for (size_t i = 0; i < count; i++) {
+            outcome[i] = result;
+        }
+    }
+    if (!results) free(outcome);
+    return result;
+}
+
+ReservationResult reservation_flight_cancel(ReservationSystem* system, int flight_id,
+                                          int seat_number) {
+    if (!system) return RESERVATION_ERROR_SYSTEM;
+
+    uint64_t start = stats_begin(RESERVATION_OP_CANCEL);
+    system_read_lock(system);
+    ReservationResult result = flight_cancel(system, flight_id, seat_number);
+    system_unlock_and_compact(system, result);
+    stats_record(system->stats, RESERVATION_OP_CANCEL, result, start);
+    return result;
+}
+
+ReservationResult reservation_flight_get(const ReservationSystem* system, int flight_id,
+                                       int seat_number, Reservation* reservation) {
+    if (!system || !reservation) return RESERVATION_ERROR_SYSTEM;
+
+    uint64_t start = stats_begin(RESERVATION_OP_QUERY);
+    system_read_lock(system);
+    ReservationResult result = RESERVATION_SUCCESS;
+    const Flight* flight = flight_lookup(system, flight_id);
+    if (!flight) {
+        result = RESERVATION_ERROR_INVALID_FLIGHT;
+    } else if (!flight_is_valid_seat(flight, seat_number)) {
+        result = RESERVATION_ERROR_INVALID_SEAT;
+    } else {
+        pthread_mutex_t* block = flight_block_lock(flight, seat_number - 1);
+        pthread_mutex_lock(block);
+        seat_export(flight, system->names, seat_number - 1, reservation);
+        pthread_mutex_unlock(block);
+    }
+    system_unlock(system);
+    stats_record(system->stats, RESERVATION_OP_QUERY, result, start);
+    return result;
+}
+
+bool reservation_flight_is_available(const ReservationSystem* system, int flight_id,
+                                   int seat_number) {
+    if (!system) return false;
+
+    system_read_lock(system);
+    const Flight* flight = flight_lookup(system, flight_id);
+    bool available = flight_is_valid_seat(flight, seat_number) &&
+                     !bitmap_test(flight->occupied, seat_number - 1);
+    system_unlock(system);
+    return available;
+}
+
+int reservation_flight_count_available(const ReservationSystem* system, int flight_id) {
+    if (!system) return -1;
+
+    system_read_lock(system);
+    const Flight* flight = flight_lookup(system, flight_id);
+    int count = flight ? __atomic_load_n(&flight->available, __ATOMIC_RELAXED) : -1;
+    system_unlock(system);
+    return count;
+}
+
+/**
+ * @brief Collects free seats from from_seat onward; the caller holds the
+ *        system lock
+ */
+static int flight_find_available(const Flight* flight, int from_seat, int* seats,
+                                 size_t max_seats) {
+    if (from_seat > flight->seat_count) return 0;
+
+    size_t count = 0;
+    size_t words = BITMAP_WORDS(flight->seat_count);
+    size_t w = (size_t)(from_seat - 1) / BITMAP_WORD_BITS;
+
+    /* Mask off seats before from_seat in the first word */
+    uint64_t free_bits = ~bitmap_word(flight->occupied, w) &
+                         (~UINT64_C(0) << ((from_seat - 1) % BITMAP_WORD_BITS));
+    while (count < max_seats) {
+        while (free_bits && count < max_seats) {
+            int bit = __builtin_ctzll(free_bits);
+            seats[count++] = (int)(w * BITMAP_WORD_BITS) + bit + 1;
+            free_bits &= free_bits - 1;
+        }
+        if (++w >= words) break;
+        free_bits = ~bitmap_word(flight->occupied, w);
+    }
+    return (int)count;
+}
+
+int reservation_flight_find_available(const ReservationSystem* system, int flight_id,
+                                    int from_seat, int* seats, size_t max_seats) {
+    if (!system || !seats || from_seat < 1) return -1;
+
+    system_read_lock(system);
+    const Flight* flight = flight_lookup(system, flight_id);
+    int count = flight ? flight_find_available(flight, from_seat, seats, max_seats) : -1;
+    system_unlock(system);
+    return count;
+}
+
+/*
+ * Adjacent-seat allocation.  Free runs come from word-level scans of the
+ * occupancy bitmap; each run is then cut at row ends and aisles, which is
+ * arithmetic on seat indices rather than a walk over seats.
+ */
+
+static bool layout_is_valid(const SeatLayout* layout) {
+    if (!layout) return true;
+    if (layout->seats_per_row < 0 || layout->aisle_count < 0 ||
+        layout->aisle_count > MAX_ROW_AISLES) {
+        return false;
+    }
+    for (int i = 0; i < layout->aisle_count; i++) {
+        if (layout->aisles[i] < 1 || layout->aisles[i] >= layout->seats_per_row) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the end (exclusive) of the row section containing index
+ */
+static int layout_section_end(const SeatLayout* layout, int index) {
+    if (!layout || layout->seats_per_row == 0) return INT_MAX;
+
+    int pos = index % layout->seats_per_row;
+    int end = layout->seats_per_row;
+    for (int i = 0; i < layout->aisle_count; i++) {
+        if (layout->aisles[i] > pos && layout->aisles[i] < end) end = layout->aisles[i];
+    }
+    return index - pos + end;
+}
+
+static int flight_find_adjacent(const Flight* flight, int count, const SeatLayout* layout) {
+    size_t words = BITMAP_WORDS(flight->seat_count);
+    int best = -1;
+    int best_length = INT_MAX;
+
+    int pos = bitmap_next(flight->occupied, words, 0, false);
+    while (pos < flight->seat_count) {
+        int run_end = bitmap_next(flight->occupied, words, pos, true);
+        if (run_end > flight->seat_count) run_end = flight->seat_count;
+
+        while (pos < run_end) {
+            int end = layout_section_end(layout, pos);
+            if (end > run_end) end = run_end;
+
+            int length = end - pos;
+            if (length >= count && length < best_length) {
+                if (length == count) return pos + 1; /* Exact fit */
+                best = pos;
+                best_length = length;
+            }
+            pos = end;
+        }
+        pos = bitmap_next(flight->occupied, words, run_end, false);
+    }
+    return best + 1;
+}
 
-struct ReservationSystem {
-    Reservation seats[MAX_SEATS];
-    bool initialized;
-};
+int reservation_flight_find_adjacent(const ReservationSystem* system, int flight_id,
+                                   int count, const SeatLayout* layout) {
+    if (!system || count < 1 || !layout_is_valid(layout)) return -1;
 
-ReservationSystem* reservation_system_create(void) {
-    ReservationSystem* system = malloc(sizeof(ReservationSystem));
-    if (!system) return NULL;
-    
-    for (int i = 0; i < MAX_SEATS; i++) {
-        system->seats[i].seat_number = i + 1;
-        system->seats[i].is_reserved = false;
-        strcpy(system->seats[i].first_name, "");
-        strcpy(system->seats[i].last_name, "");
+    system_read_lock(system);
+    const Flight* flight = flight_lookup(system, flight_id);
+    int first = flight ? flight_find_adjacent(flight, count, layout) : -1;
+    system_unlock(system);
+    return first;
+}
+
+ReservationResult reservation_flight_book_adjacent(ReservationSystem* system, int flight_id,
+                                                 const SeatLayout* layout,
+                                                 ReservationRequest* passengers, size_t count) {
+    if (!system || !passengers) return RESERVATION_ERROR_SYSTEM;
+    if (count < 1 || count > MAX_FLIGHT_SEATS || !layout_is_valid(layout)) {
+        return RESERVATION_ERROR_INVALID_SEAT;
     }
-    system->initialized = true;
-    return system;
+
+    /* Seats are tried on a copy, so a failed attempt leaves the caller's untouched */
+    ReservationRequest* requests = malloc(count * sizeof(ReservationRequest));
+    ReservationResult* outcome = malloc(count * sizeof(ReservationResult));
+    if (!requests || !outcome) {
+        free(requests);
+        free(outcome);
+        return RESERVATION_ERROR_MEMORY;
+    }
+    memcpy(requests, passengers, count * sizeof(ReservationRequest));
+
+    /* Another thread may take a seat between the search and the booking;
+       search again a bounded number of times */
+    uint64_t start = stats_begin(RESERVATION_OP_MAKE);
+    ReservationResult result = RESERVATION_ERROR_SEAT_OCCUPIED;
+    for (int attempt = 0; attempt < 8 && result == RESERVATION_ERROR_SEAT_OCCUPIED; attempt++) {
+        system_read_lock(system);
+        Flight* flight = flight_lookup(system, flight_id);
+        int first = flight ? flight_find_adjacent(flight, (int)count, layout) : -1;
+        if (first < 0) {
+            result = RESERVATION_ERROR_INVALID_FLIGHT;
+        } else if (first == 0) {
+            result = RESERVATION_ERROR_NO_ADJACENT_SEATS;
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                requests[i].seat_number = first + (int)i;
+            }
+            result = flight_make_batch(system, flight_id, requests, count, outcome);
+        }
+        system_unlock_and_compact(system, result);
+    }
+    stats_record(system->stats, RESERVATION_OP_MAKE, result, start);
+    if (result == RESERVATION_SUCCESS) {
+        for (size_t i = 0; i < count; i++) {
+            passengers[i].seat_number = requests[i].seat_number;
+        }
+    }
+    free(requests);
+    free(outcome);
+    return result;
 }
 
-void reservation_system_destroy(ReservationSystem* system) {
-    if (system) {
-        free(system);
+int reservation_flight_list_available(const ReservationSystem* system, int flight_id,
+                                    int* seats, size_t max_seats) {
+    return reservation_flight_find_available(system, flight_id, 1, seats, max_seats);
+}
+
+/*
+ * Name-ordered listings.  Seats in by_name are only written before they
+ * are inserted and after they are removed, so while index_lock is held
+ * every record it references is stable.
+ */
+
+static int flight_list_sorted(Flight* flight, const NamePool* names,
+                              Reservation* reservations, size_t max_reservations) {
+    pthread_mutex_lock(&flight->index_lock);
+    size_t count = 0;
+    while (count < max_reservations && count < (size_t)flight->by_name_count) {
+        seat_export(flight, names, flight->by_name[count], &reservations[count]);
+        count++;
+    }
+    pthread_mutex_unlock(&flight->index_lock);
+    return (int)count;
+}
+
+int reservation_flight_list_sorted(const ReservationSystem* system, int flight_id,
+                                 Reservation* reservations, size_t max_reservations) {
+    if (!system || !reservations) return -1;
+
+    system_read_lock(system);
+    Flight* flight = flight_lookup(system, flight_id);
+    int count = flight ? flight_list_sorted(flight, system->names, reservations,
+                                            max_reservations) : -1;
+    system_unlock(system);
+    return count;
+}
+
+static int flight_find_by_last_name(Flight* flight, const NamePool* names, const char* prefix,
+                                    Reservation* reservations, size_t max_reservations) {
+    pthread_mutex_lock(&flight->index_lock);
+
+    /* Entries sharing a case-folded prefix are contiguous in the index */
+    size_t len = strlen(prefix);
+    int low = 0;
+    int high = flight->by_name_count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        const char* last = names_get(names, flight->seats[flight->by_name[mid]].last_name);
+        if (ascii_casecmp_n(last, prefix, len) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    size_t count = 0;
+    for (int pos = low; pos < flight->by_name_count && count < max_reservations; pos++) {
+        int index = flight->by_name[pos];
+        if (ascii_casecmp_n(names_get(names, flight->seats[index].last_name), prefix,
+                            len) != 0) {
+            break;
+        }
+        seat_export(flight, names, index, &reservations[count++]);
+    }
+    pthread_mutex_unlock(&flight->index_lock);
+    return (int)count;
+}
+
+int reservation_flight_find_by_last_name(const ReservationSystem* system, int flight_id,
+                                       const char* prefix, Reservation* reservations,
+                                       size_t max_reservations) {
+    if (!system || !prefix || !reservations) return -1;
+
+    system_read_lock(system);
+    Flight* flight = flight_lookup(system, flight_id);
+    int count = flight ? flight_find_by_last_name(flight, system->names, prefix,
+                                                  reservations, max_reservations) : -1;
+    system_unlock(system);
+    return count;
+}
+
+ReservationResult reservation_cursor_open(const ReservationSystem* system, int flight_id,
+                                          ReservationCursor* cursor) {
+    if (!cursor) return RESERVATION_ERROR_SYSTEM;
+    *cursor = (ReservationCursor){ 0 };
+    if (!system) return RESERVATION_ERROR_SYSTEM;
+
+    system_read_lock(system);
+    const Flight* flight = flight_lookup(system, flight_id);
+    if (!flight) {
+        system_unlock(system);
+        return RESERVATION_ERROR_INVALID_FLIGHT;
+    }
+    cursor->system = system;
+    cursor->flight = flight;
+    return RESERVATION_SUCCESS;
+}
+
+const ReservationView* reservation_cursor_next(ReservationCursor* cursor) {
+    if (!cursor || !cursor->system) return NULL;
+
+    const Flight* flight = cursor->flight;
+    size_t words = BITMAP_WORDS(flight->seat_count);
+    while (!cursor->pending) {
+        if (cursor->locked) {
+            pthread_mutex_unlock(&flight->block_locks[cursor->word++]);
+            cursor->locked = false;
+        }
+        /* Blocks with no reserved seat are passed without taking their lock */
+        while (cursor->word < words &&
+               !(bitmap_word(flight->occupied, cursor->word) &
+                 bitmap_seat_mask(flight->seat_count, cursor->word))) {
+            cursor->word++;
+        }
+        if (cursor->word >= words) return NULL;
+
+        /* Seats may have been cancelled since the unlocked read */
+        pthread_mutex_lock(&flight->block_locks[cursor->word]);
+        cursor->locked = true;
+        cursor->pending = bitmap_word(flight->occupied, cursor->word) &
+                          bitmap_seat_mask(flight->seat_count, cursor->word);
+    }
+
+    int bit = __builtin_ctzll(cursor->pending);
+    cursor->pending &= cursor->pending - 1;
+
+    /* Names stay put until a compaction, which needs the system lock */
+    int index = (int)(cursor->word * BITMAP_WORD_BITS) + bit;
+    const NamePool* names = cursor->system->names;
+    cursor->view.seat_number = index + 1;
+    cursor->view.first_name = names_get(names, flight->seats[index].first_name);
+    cursor->view.last_name = names_get(names, flight->seats[index].last_name);
+    return &cursor->view;
+}
+
+void reservation_cursor_close(ReservationCursor* cursor) {
+    if (!cursor || !cursor->system) return;
+
+    const Flight* flight = cursor->flight;
+    if (cursor->locked) {
+        pthread_mutex_unlock(&flight->block_locks[cursor->word]);
+    }
+    system_unlock(cursor->system);
+    *cursor = (ReservationCursor){ 0 };
+}
+
+ReservationResult reservation_snapshot_open(const ReservationSystem* system, int flight_id,
+                                            ReservationSnapshot** snapshot) {
+    if (!system || !snapshot) return RESERVATION_ERROR_SYSTEM;
+    *snapshot = NULL;
+
+    system_read_lock(system);
+    Flight* flight = flight_lookup(system, flight_id);
+    ReservationResult result = flight ? RESERVATION_SUCCESS : RESERVATION_ERROR_INVALID_FLIGHT;
+    if (flight) {
+        size_t words = BITMAP_WORDS(flight->seat_count);
+        ReservationSnapshot* opened = calloc(1, sizeof(ReservationSnapshot));
+        if (opened) {
+            opened->blocks = calloc(words, sizeof(SeatBlock)); /* Pages untouched until used */
+            opened->preserved = calloc(words, 1);
+        }
+        if (!opened || !opened->blocks || !opened->preserved) {
+            snapshot_free(opened);
+            result = RESERVATION_ERROR_MEMORY;
+        } else {
+            opened->system = system;
+            opened->flight = flight;
+            opened->seat_count = flight->seat_count;
+            flight_lock_blocks(flight);
+            opened->next = flight->snapshots;
+            flight->snapshots = opened;
+            flight_unlock_blocks(flight);
+            __atomic_fetch_add(&((ReservationSystem*)system)->snapshot_count, 1,
+                               __ATOMIC_RELAXED);
+            *snapshot = opened;
+        }
+    }
+    system_unlock(system);
+    return result;
+}
+
+ReservationResult reservation_snapshot_get(const ReservationSnapshot* snapshot, int seat_number,
+                                           Reservation* reservation) {
+    if (!snapshot || !reservation) return RESERVATION_ERROR_SYSTEM;
+
+    const ReservationSystem* system = snapshot->system;
+    uint64_t start = stats_begin(RESERVATION_OP_QUERY);
+    ReservationResult result = RESERVATION_ERROR_INVALID_SEAT;
+    if (seat_number >= 1 && seat_number <= snapshot->seat_count) {
+        int index = seat_number - 1;
+        SeatBlock scratch;
+        system_read_lock(system);
+        const SeatBlock* block = snapshot_block(snapshot, (size_t)index / BITMAP_WORD_BITS,
+                                                &scratch, true);
+        seat_names_export(system->names, &block->seats[index % BITMAP_WORD_BITS], seat_number,
+                          reservation);
+        system_unlock(system);
+        result = RESERVATION_SUCCESS;
+    }
+    stats_record(system->stats, RESERVATION_OP_QUERY, result, start);
+    return result;
+}
+
+int reservation_snapshot_count_available(const ReservationSnapshot* snapshot) {
+    if (!snapshot) return -1;
+
+    int count = 0;
+    SeatBlock scratch;
+    system_read_lock(snapshot->system);
+    for (size_t w = 0; w < BITMAP_WORDS(snapshot->seat_count); w++) {
+        count += __builtin_popcountll(~snapshot_block(snapshot, w, &scratch, false)->occupied);
+    }
+    system_unlock(snapshot->system);
+    return count;
+}
+
+int reservation_snapshot_get_all(const ReservationSnapshot* snapshot,
+                                 Reservation* reservations, size_t max_seats) {
+    if (!snapshot || !reservations || max_seats < (size_t)snapshot->seat_count) return -1;
+
+    const ReservationSystem* system = snapshot->system;
+    SeatBlock scratch;
+    system_read_lock(system);
+    for (size_t w = 0; w < BITMAP_WORDS(snapshot->seat_count); w++) {
+        const SeatBlock* block = snapshot_block(snapshot, w, &scratch, true);
+        int first = (int)(w * BITMAP_WORD_BITS);
+        for (int i = 0; i < block_seats(snapshot->seat_count, w); i++) {
+            seat_names_export(system->names, &block->seats[i], first + i + 1,
+                              &reservations[first + i]);
+        }
+    }
+    system_unlock(system);
+    return snapshot->seat_count;
+}
+
+void reservation_snapshot_close(ReservationSnapshot* snapshot) {
+    if (!snapshot) return;
+
+    ReservationSystem* system = (ReservationSystem*)snapshot->system;
+    system_read_lock(system);
+    Flight* flight = snapshot->flight;
+    if (flight) {
+        flight_lock_blocks(flight);
+        ReservationSnapshot** link = &flight->snapshots;
+        while (*link != snapshot) {
+            link = &(*link)->next;
+        }
+        *link = snapshot->next;
+        flight_unlock_blocks(flight);
+    }
+    __atomic_fetch_sub(&system->snapshot_count, 1, __ATOMIC_RELAXED);
+    system_unlock(system);
+    snapshot_free(snapshot);
+}
+
+static int compare_seats(const void* a, const void* b) {
+    const ReservationSeat* x = a;
+    const ReservationSeat* y = b;
+    if (x->flight_id != y->flight_id) {
+        return (x->flight_id > y->flight_id) - (x->flight_id < y->flight_id);
+    }
+    return (x->seat_number > y->seat_number) - (x->seat_number < y->seat_number);
+}
+
+int reservation_find_passenger(const ReservationSystem* system, int flight_id,
+                               const char* first_name, const char* last_name,
+                               ReservationSeat* seats, size_t max_seats) {
+    if (!system || (!seats && max_seats > 0) || !reservation_is_valid_name(first_name) ||
+        !reservation_is_valid_name(last_name)) {
+        return -1;
+    }
+
+    uint64_t start = stats_begin(RESERVATION_OP_QUERY);
+    uint32_t hash = passenger_hash(first_name, last_name);
+    PassengerStripe* stripe = passenger_stripe(system, hash);
+    system_read_lock(system);
+    const Flight* flight = flight_lookup(system, flight_id);
+    int found = -1;
+    if (flight || flight_id == RESERVATION_ANY_FLIGHT) {
+        pthread_mutex_lock(&stripe->lock);
+        found = (int)passenger_find(system->names, stripe, hash, first_name, last_name, flight,
+                                    seats, max_seats);
+        pthread_mutex_unlock(&stripe->lock);
+    }
+    system_unlock(system);
+    stats_record(system->stats, RESERVATION_OP_QUERY,
+                 found < 0 ? RESERVATION_ERROR_INVALID_FLIGHT : RESERVATION_SUCCESS, start);
+
+    if (found > 0 && max_seats > 0) {
+        qsort(seats, (size_t)found < max_seats ? (size_t)found : max_seats,
+              sizeof(ReservationSeat), compare_seats);
     }
+    return found;
 }
 
 ReservationResult reservation_make(ReservationSystem* system, int seat_number,
@@ -39,59 +1975,54 @@ ReservationResult reservation_make(ReservationSystem* system, int seat_number,
     if (!system || !reservation_is_valid_seat(seat_number)) {
         return RESERVATION_ERROR_INVALID_SEAT;
     }
-    
-    if (!reservation_is_valid_name(first_name) || !reservation_is_valid_name(last_name)) {
-        return RESERVATION_ERROR_INVALID_NAME;
-    }
-    
-    int index = seat_number - 1;
-    if (system->seats[index].is_reserved) {
-        return RESERVATION_ERROR_SEAT_OCCUPIED;
-    }
-    
-    system->seats[index].is_reserved = true;
-    strncpy(system->seats[index].first_name, first_name, MAX_NAME_LENGTH - 1);
-    strncpy(system->seats[index].last_name, last_name, MAX_NAME_LENGTH - 1);
-    system->seats[index].first_name[MAX_NAME_LENGTH - 1] = '\0';
-    system->seats[index].last_name[MAX_NAME_LENGTH - 1] = '\0';
-    
-    return RESERVATION_SUCCESS;
+    return reservation_flight_make(system, DEFAULT_FLIGHT_ID, seat_number,
+                                   first_name, last_name);
+}
+
+ReservationResult reservation_make_batch(ReservationSystem* system,
+                                       const ReservationRequest* requests, size_t count,
+                                       ReservationResult* results) {
+    return reservation_flight_make_batch(system, DEFAULT_FLIGHT_ID, requests, count, results);
 }
 
 ReservationResult reservation_cancel(ReservationSystem* system, int seat_number) {
     if (!system || !reservation_is_valid_seat(seat_number)) {
         return RESERVATION_ERROR_INVALID_SEAT;
     }
-    
-    int index = seat_number - 1;
-    if (!system->seats[index].is_reserved) {
-        return RESERVATION_ERROR_SEAT_EMPTY;
-    }
-    
-    system->seats[index].is_reserved = false;
-    strcpy(system->seats[index].first_name, "");
-    strcpy(system->seats[index].last_name, "");
-    
-    return RESERVATION_SUCCESS;
+    return reservation_flight_cancel(system, DEFAULT_FLIGHT_ID, seat_number);
+}
+
+ReservationResult reservation_get(const ReservationSystem* system, int seat_number,
+                                Reservation* reservation) {
+    if (!system || !reservation_is_valid_seat(seat_number)) {
+        return RESERVATION_ERROR_INVALID_SEAT;
+    }
+    return reservation_flight_get(system, DEFAULT_FLIGHT_ID, seat_number, reservation);
 }
 
 bool reservation_is_available(const ReservationSystem* system, int seat_number) {
     if (!system || !reservation_is_valid_seat(seat_number)) {
         return false;
     }
-    return !system->seats[seat_number - 1].is_reserved;
+    return reservation_flight_is_available(system, DEFAULT_FLIGHT_ID, seat_number);
 }
 
 int reservation_count_available(const ReservationSystem* system) {
     if (!system) return -1;
-    
-    int count = 0;
-    for (int i = 0; i < MAX_SEATS; i++) {
-        if (!system->seats[i].is_reserved) {
-            count++;
-        }
-    }
-    return count;
+    return reservation_flight_count_available(system, DEFAULT_FLIGHT_ID);
+}
+
+int reservation_list_available(const ReservationSystem* system, int* seats,
+                             size_t max_seats) {
+    if (!system) return -1;
+    return reservation_flight_list_available(system, DEFAULT_FLIGHT_ID, seats, max_seats);
+}
+
+int reservation_list_sorted(const ReservationSystem* system, Reservation* reservations,
+                          size_t max_reservations) {
+    if (!system) return -1;
+    return reservation_flight_list_sorted(system, DEFAULT_FLIGHT_ID, reservations,
+                                          max_reservations);
 }
 
 bool reservation_is_valid_seat(int seat_number) {
@@ -111,44 +2042,493 @@ const char* reservation_error_string(ReservationResult result) {
         case RESERVATION_ERROR_INVALID_NAME: return "Invalid name";
         case RESERVATION_ERROR_FILE_IO: return "File I/O error";
         case RESERVATION_ERROR_MEMORY: return "Memory allocation error";
+        case RESERVATION_ERROR_SYSTEM: return "System error";
+        case RESERVATION_ERROR_INVALID_FLIGHT: return "Invalid flight";
+        case RESERVATION_ERROR_NO_ADJACENT_SEATS: return "No adjacent seats available";
+        case RESERVATION_ERROR_DUPLICATE_PASSENGER: return "Passenger already booked";
         default: return "Unknown error";
     }
 }
 
-ReservationResult reservation_system_load(ReservationSystem* system) {
-    if (!system) return RESERVATION_ERROR_SYSTEM;
-    
+/*
+ * Snapshot loading.  The decoder hands over one flight at a time; each is
+ * built on the heap and installed once its records are complete.
+ */
+typedef struct {
+    ReservationSystem* system;
+    Flight* pending;
+} LoadContext;
+
+static ReservationResult load_begin_flight(void* context, int flight_id, int seat_count) {
+    LoadContext* load = context;
+    load->pending = flight_create(flight_id, seat_count);
+    return load->pending ? RESERVATION_SUCCESS : RESERVATION_ERROR_MEMORY;
+}
+
+static ReservationResult load_add_seat(void* context, int index, const char* first_name,
+                                       const char* last_name) {
+    LoadContext* load = context;
+    SeatNames* seat = &load->pending->seats[index];
+    seat->first_name = names_intern(load->system->names, first_name);
+    seat->last_name = names_intern(load->system->names, last_name);
+    return seat->first_name != NAME_NONE && seat->last_name != NAME_NONE
+           ? RESERVATION_SUCCESS : RESERVATION_ERROR_MEMORY;
+}
+
+static ReservationResult load_end_flight(void* context) {
+    LoadContext* load = context;
+    Flight* flight = load->pending;
+    load->pending = NULL;
+
+    ReservationResult result = flight_rebuild_indexes(flight, load->system->names)
+                               ? flight_install(load->system, flight)
+                               : RESERVATION_ERROR_MEMORY;
+    if (result != RESERVATION_SUCCESS) flight_destroy(flight);
+    return result;
+}
+
+static ReservationResult load_snapshot(ReservationSystem* system) {
     FILE* file = fopen(RESERVATION_FILE, "rb");
     if (!file) return RESERVATION_SUCCESS; /* File doesn't exist yet */
-    
-    size_t read = fread(system->seats, sizeof(Reservation), MAX_SEATS, file);
+
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+        rewind(file);
+    }
+    unsigned char* data = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    bool ok = data && fread(data, 1, (size_t)size, file) == (size_t)size;
     fclose(file);
-    
-    return (read == MAX_SEATS) ? RESERVATION_SUCCESS : RESERVATION_ERROR_FILE_IO;
+
+    ReservationResult result = RESERVATION_ERROR_FILE_IO;
+    if (ok) {
+        LoadContext load = { system, NULL };
+        SnapshotSink sink = { load_begin_flight, load_add_seat, load_end_flight, &load };
+        result = snapshot_decode(data, (size_t)size, &sink);
+    } else if (size >= 0 && !data) {
+        result = RESERVATION_ERROR_MEMORY;
+    }
+    free(data);
+    return result;
+}
+
+/*
+ * Replay context.  Records are applied while no journal is open, so they
+ * are not logged again.  Seat records are replayed as "set" operations
+ * (a MAKE overwrites an occupied seat, a CANCEL of an empty seat is a
+ * no-op) because the base state may already contain some of them: a
+ * crash can land between writing a snapshot and truncating the journal,
+ * and a mapped store has its pages written back by the kernel at any time.
+ */
+typedef struct {
+    ReservationSystem* system;
+    size_t applied;
+} ReplayContext;
+
+static void replay_record(void* context, const JournalRecord* record) {
+    ReplayContext* replay = context;
+    ReservationSystem* system = replay->system;
+    ReservationResult result = RESERVATION_ERROR_SYSTEM;
+    Flight* flight = flight_lookup(system, record->flight_id);
+    int index = record->value - 1;
+    NameHandle first = NAME_NONE;
+    NameHandle last = NAME_NONE;
+
+    switch (record->op) {
+        case JOURNAL_OP_MAKE:
+            if (!flight_is_valid_seat(flight, record->value) ||
+                !reservation_is_valid_name(record->first_name) ||
+                !reservation_is_valid_name(record->last_name) ||
+                (first = names_intern(system->names, record->first_name)) == NAME_NONE ||
+                (last = names_intern(system->names, record->last_name)) == NAME_NONE) {
+                break;
+            }
+            if (bitmap_test(flight->occupied, index)) {
+                flight_apply_cancel(flight, system->names, index);
+                flight_add_available(flight, 1);
+            }
+            flight_apply_make(flight, system->names, index, first, last);
+            flight_add_available(flight, -1);
+            result = RESERVATION_SUCCESS;
+            break;
+        case JOURNAL_OP_CANCEL:
+            if (flight_is_valid_seat(flight, record->value) &&
+                bitmap_test(flight->occupied, index)) {
+                flight_apply_cancel(flight, system->names, index);
+                flight_add_available(flight, 1);
+                result = RESERVATION_SUCCESS;
+            }
+            break;
+        case JOURNAL_OP_FLIGHT_ADD:
+            result = flight_add(system, record->flight_id, record->value);
+            break;
+        case JOURNAL_OP_FLIGHT_REMOVE:
+            result = flight_remove(system, record->flight_id);
+            break;
+        case JOURNAL_OP_GROUP:
+            break; /* Expanded into its members by journal_replay */
+    }
+    if (result == RESERVATION_SUCCESS) {
+        replay->applied++;
+    }
+}
+
+/**
+ * @brief Moves every heap-allocated flight into the mapped store
+ */
+static ReservationResult migrate_to_store(ReservationSystem* system, ReservationStore* store) {
+    for (size_t i = 0; i < system->flight_capacity; i++) {
+        const Flight* heap = system->flights[i];
+        if (!heap || heap->store) continue;
+
+        Flight* flight = flight_create_mapped(store, heap->flight_id, heap->seat_count);
+        if (!flight) return RESERVATION_ERROR_FILE_IO;
+
+        memcpy(flight->seats, heap->seats, (size_t)heap->seat_count * sizeof(SeatNames));
+        memcpy(flight->occupied, heap->occupied,
+               BITMAP_WORDS(heap->seat_count) * sizeof(uint64_t));
+        memcpy(flight->by_name, heap->by_name, (size_t)heap->by_name_count * sizeof(int));
+        flight->by_name_count = heap->by_name_count;
+        for (int n = 0; n < flight->by_name_count; n++) {
+            flight_write_record(flight, system->names, flight->by_name[n]);
+        }
+        flight_install(system, flight);
+    }
+    return RESERVATION_SUCCESS;
+}
+
+/**
+ * @brief Opens the mapped store, seeding it from the snapshot on first use
+ */
+static ReservationResult load_mapped(ReservationSystem* system) {
+    bool created, clean;
+    ReservationStore* store = store_open(RESERVATION_MAP_FILE, &created, &clean,
+                                         system->stats);
+    if (!store) return RESERVATION_ERROR_FILE_IO;
+    system->store = store;
+
+    /* A new store starts from the stream snapshot, if there is one */
+    ReservationResult result = created ? load_snapshot(system) : RESERVATION_SUCCESS;
+
+    for (int slot = 0; result == RESERVATION_SUCCESS && slot < store_slot_count(store); slot++) {
+        StoreFlight mapped;
+        if (!store_attach(store, slot, &mapped)) continue;
+
+        Flight* flight = flight_attach(store, &mapped);
+        if (!flight) {
+            store_remove_flight(store, mapped.slot);
+            result = RESERVATION_ERROR_MEMORY;
+            continue;
+        }
+        result = flight_load_records(flight, system->names, clean);
+        if (result == RESERVATION_SUCCESS && !clean &&
+            !flight_rebuild_indexes(flight, system->names)) {
+            result = RESERVATION_ERROR_MEMORY;
+        }
+        if (result != RESERVATION_SUCCESS) {
+            flight_destroy(flight);
+        } else {
+            result = flight_install(system, flight);
+        }
+    }
+
+    /* Flights that only exist in memory (the default flight of a new store,
+       or anything added before the load) move into the store */
+    return result == RESERVATION_SUCCESS ? migrate_to_store(system, store) : result;
+}
+
+ReservationResult reservation_system_set_storage(ReservationSystem* system,
+                                               ReservationStorage storage) {
+    if (!system) return RESERVATION_ERROR_SYSTEM;
+
+    system_write_lock(system);
+    ReservationResult result = RESERVATION_ERROR_SYSTEM;
+    if (!system->store) {
+        system->storage = storage;
+        result = RESERVATION_SUCCESS;
+    }
+    system_unlock(system);
+    return result;
+}
+
+/**
+ * @brief Loads persistent state; the caller holds the system lock exclusively
+ */
+static ReservationResult system_load(ReservationSystem* system) {
+    if (system->store) return RESERVATION_SUCCESS; /* Mapped state is always live */
+
+    /* Reloading: stop logging until the replayed state is settled */
+    journal_close(system->journal);
+    system->journal = NULL;
+
+    ReservationResult result = system->storage == RESERVATION_STORAGE_MAPPED
+                               ? load_mapped(system)
+                               : load_snapshot(system);
+    if (result != RESERVATION_SUCCESS) return result;
+
+    ReplayContext replay = { system, 0 };
+    result = journal_replay(RESERVATION_JOURNAL_FILE, replay_record, &replay);
+    if (result != RESERVATION_SUCCESS) return result;
+
+    /* Fold replayed records into a fresh snapshot before logging resumes */
+    if (replay.applied > 0) {
+        result = system_save(system);
+        if (result != RESERVATION_SUCCESS) return result;
+    }
+
+    system->journal = journal_open(RESERVATION_JOURNAL_FILE, &system->durability,
+                                   system->stats);
+    if (!system->journal) return RESERVATION_ERROR_FILE_IO;
+
+    return journal_reset(system->journal);
+}
+
+ReservationResult reservation_system_load(ReservationSystem* system) {
+    if (!system) return RESERVATION_ERROR_SYSTEM;
+
+    uint64_t start = stats_begin(RESERVATION_OP_LOAD);
+    system_write_lock(system);
+    /* Flights are replaced wholesale, so the passenger index starts over */
+    passenger_clear(system);
+    ReservationResult result = system_load(system);
+    ReservationResult indexed = passenger_rebuild(system);
+    if (result == RESERVATION_SUCCESS) result = indexed;
+    system_unlock(system);
+    stats_record(system->stats, RESERVATION_OP_LOAD, result, start);
+    return result;
+}
+
+void reservation_system_set_durability(ReservationSystem* system,
+                                       const ReservationDurability* durability) {
+    if (system && durability) {
+        system_write_lock(system);
+        system->durability = *durability;
+        journal_set_durability(system->journal, durability);
+        system_unlock(system);
+    }
+}
+
+void reservation_system_set_duplicates(ReservationSystem* system,
+                                       ReservationDuplicates duplicates) {
+    if (system) {
+        system_write_lock(system);
+        system->duplicates = duplicates;
+        system_unlock(system);
+    }
+}
+
+ReservationResult reservation_system_flush(ReservationSystem* system) {
+    if (!system) return RESERVATION_ERROR_SYSTEM;
+
+    system_read_lock(system);
+    ReservationResult result = system->journal ? journal_sync(system->journal)
+                                               : RESERVATION_SUCCESS;
+    system_unlock(system);
+    return result;
+}
+
+/**
+ * @brief Makes a rename in the directory holding path durable
+ */
+static bool sync_parent_directory(const char* path, ReservationStatsCollector* stats) {
+    const char* slash = strrchr(path, '/');
+    char directory[PATH_MAX] = ".";
+    if (slash) {
+        size_t length = slash == path ? 1 : (size_t)(slash - path);
+        if (length >= sizeof(directory)) return false;
+        memcpy(directory, path, length);
+        directory[length] = '\0';
+    }
+
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    stats_add_sync(stats);
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief Replaces path with data atomically
+ *
+ * The data goes to temp_path, preallocated to its final size, is synced,
+ * and is then renamed over path, so a crash or a full disk leaves either
+ * the old file or the new one, never a partial write.
+ */
+static bool write_file_atomic(const char* path, const char* temp_path,
+                              const unsigned char* data, size_t length,
+                              ReservationStatsCollector* stats) {
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return false;
+
+    /* Fails up front on a full disk; unsupported filesystems just skip it */
+    int error = length ? posix_fallocate(fd, 0, (off_t)length) : 0;
+    bool ok = error == 0 || error == EINVAL || error == EOPNOTSUPP;
+    for (size_t done = 0; ok && done < length; ) {
+        ssize_t written = write(fd, data + done, length - done);
+        if (written < 0 && errno == EINTR) continue;
+        ok = written > 0;
+        if (ok) done += (size_t)written;
+    }
+    stats_add_write(stats, STATS_WRITE_SNAPSHOT, length);
+    stats_add_sync(stats);
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    ok = ok && rename(temp_path, path) == 0;
+
+    if (!ok) {
+        unlink(temp_path);
+        return false;
+    }
+    return sync_parent_directory(path, stats);
+}
+
+static ReservationResult snapshot_write(const ReservationSystem* system) {
+    if (system->store) {
+        /* Only pages touched since the last sync are written */
+        store_record_name_counts(system);
+        ReservationResult result = store_sync(system->store);
+        if (result != RESERVATION_SUCCESS) return result;
+        return system->journal ? journal_reset(system->journal) : RESERVATION_SUCCESS;
+    }
+
+    SnapshotFlight* flights = malloc((system->flight_count + 1) * sizeof(SnapshotFlight));
+    if (!flights) return RESERVATION_ERROR_MEMORY;
+
+    size_t count = 0;
+    for (size_t i = 0; i < system->flight_capacity; i++) {
+        const Flight* flight = system->flights[i];
+        if (flight) {
+            SnapshotFlight view = { flight->flight_id, flight->seat_count,
+                                    flight->occupied, flight->seats };
+            flights[count++] = view;
+        }
+    }
+
+    unsigned char* data = NULL;
+    size_t length = 0;
+    ReservationResult result = snapshot_encode(flights, count, system->names, &data, &length);
+    free(flights);
+    if (result != RESERVATION_SUCCESS) return result;
+
+    /* The snapshot must be on disk before the journal may be dropped */
+    bool ok = write_file_atomic(RESERVATION_FILE, RESERVATION_TEMP_FILE, data, length,
+                                system->stats);
+    free(data);
+    if (!ok) return RESERVATION_ERROR_FILE_IO;
+
+    return system->journal ? journal_reset(system->journal) : RESERVATION_SUCCESS;
+}
+
+/**
+ * @brief Interns the names of every reserved seat into another pool, and
+ *        points the seats at them when apply is set
+ */
+static bool names_move(ReservationSystem* system, NamePool* target, bool apply) {
+    for (size_t i = 0; i < system->flight_capacity; i++) {
+        Flight* flight = system->flights[i];
+        for (int n = 0; flight && n < flight->by_name_count; n++) {
+            SeatNames* seat = &flight->seats[flight->by_name[n]];
+            NameHandle first = names_intern(target, names_get(system->names, seat->first_name));
+            NameHandle last = names_intern(target, names_get(system->names, seat->last_name));
+            if (first == NAME_NONE || last == NAME_NONE) return false;
+            if (apply) {
+                seat->first_name = first;
+                seat->last_name = last;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Drops names no seat uses once the pool has doubled since the last
+ *        compaction; the caller holds the system lock exclusively
+ *
+ * The live names are copied to a fresh pool first, so running out of
+ * memory leaves every handle as it was; the second pass only looks up.
+ */
+static void names_maybe_compact(ReservationSystem* system) {
+    if (__atomic_load_n(&system->snapshot_count, __ATOMIC_RELAXED) > 0) {
+        return; /* Their copies hold handles into this pool */
+    }
+
+    size_t base = system->names_compacted > NAMES_COMPACT_MIN_BYTES ? system->names_compacted
+                                                                     : NAMES_COMPACT_MIN_BYTES;
+    if (names_size(system->names) < 2 * base) return;
+
+    NamePool* fresh = names_create();
+    if (!fresh || !names_move(system, fresh, false)) {
+        names_destroy(fresh);
+        return;
+    }
+    names_move(system, fresh, true);
+    names_destroy(system->names);
+    system->names = fresh;
+    system->names_compacted = names_size(fresh);
+}
+
+/**
+ * @brief Writes a snapshot; the caller holds the system lock exclusively
+ */
+static ReservationResult system_write_snapshot(const ReservationSystem* system) {
+    uint64_t start = stats_begin(RESERVATION_OP_SAVE);
+    ReservationResult result = snapshot_write(system);
+    stats_record(system->stats, RESERVATION_OP_SAVE, result, start);
+    return result;
+}
+
+/**
+ * @brief Drops unused names, then writes a snapshot; the caller holds the
+ *        system lock exclusively on behalf of a change or a load
+ *
+ * Only these paths own the system mutably.  reservation_system_save takes
+ * a const system and leaves the pool alone; since only changes grow it,
+ * the compaction a change triggers is where names are dropped.
+ */
+static ReservationResult system_save(ReservationSystem* system) {
+    names_maybe_compact(system);
+    return system_write_snapshot(system);
 }
 
 ReservationResult reservation_system_save(const ReservationSystem* system) {
     if (!system) return RESERVATION_ERROR_SYSTEM;
-    
-    FILE* file = fopen(RESERVATION_FILE, "wb");
-    if (!file) return RESERVATION_ERROR_FILE_IO;
-    
-    size_t written = fwrite(system->seats, sizeof(Reservation), MAX_SEATS, file);
-    fclose(file);
-    
-    return (written == MAX_SEATS) ? RESERVATION_SUCCESS : RESERVATION_ERROR_FILE_IO;
+
+    system_write_lock(system);
+    ReservationResult result = system_write_snapshot(system);
+    system_unlock(system);
+    return result;
+}
+
+ReservationResult reservation_system_get_stats(const ReservationSystem* system,
+                                             ReservationStats* stats) {
+    if (!system || !stats) return RESERVATION_ERROR_SYSTEM;
+    stats_collect(system->stats, stats);
+    return RESERVATION_SUCCESS;
+}
+
+void reservation_system_reset_stats(ReservationSystem* system) {
+    if (system) stats_reset(system->stats);
+}
+
+ReservationResult reservation_system_dump_stats(ReservationSystem* system, FILE* out,
+                                              unsigned int interval_ms,
+                                              ReservationStatsFormat format) {
+    if (!system || (interval_ms > 0 && !out)) return RESERVATION_ERROR_SYSTEM;
+    return stats_dump(system->stats, out, interval_ms, format) ? RESERVATION_SUCCESS
+                                                               : RESERVATION_ERROR_SYSTEM;
 }
 
-int reservation_get_all_seats(const ReservationSystem* system, 
-                            Reservation* reservations, 
+int reservation_get_all_seats(const ReservationSystem* system,
+                            Reservation* reservations,
                             size_t max_seats) {
-    if (!system || !reservations || max_seats < MAX_SEATS) {
+    if (!system || !reservations) return -1;
+
+    ReservationSnapshot* snapshot;
+    if (reservation_snapshot_open(system, DEFAULT_FLIGHT_ID, &snapshot) != RESERVATION_SUCCESS) {
         return -1;
     }
-    
-    for (int i = 0; i < MAX_SEATS; i++) {
-        reservations[i] = system->seats[i];
-    }
-    
-    return MAX_SEATS;
+    int count = reservation_snapshot_get_all(snapshot, reservations, max_seats);
+    reservation_snapshot_close(snapshot);
+    return count;
 }
@@ -0,0 +1,236 @@
+/**
+ * @file test_batch.c
+ * @brief All-or-nothing batch booking tests
+ * @author Jaden Mardini
+ *
+ * A batch either books every one of its seats or none of them: when one
+ * item fails, when a crash tears its journal record, and when batches
+ * over the same seats race each other.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reservation_system.h"
+#include "test_util.h"
+#include <pthread.h>
+
+#define RACE_ROUNDS 32
+#define RACE_THREADS 8
+#define RACE_BATCH 3
+#define RACE_SEATS (RACE_THREADS + RACE_BATCH)
+
+/**
+ * @brief One bad item fails the batch, reports itself and books nothing
+ */
+static void test_failed_item(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_make(system, 3, "Taken", "Seat"), RESERVATION_SUCCESS);
+
+    ReservationRequest requests[] = {
+        { 1, "Ada", "Lovelace" }, { 2, "Alan", "Turing" },
+        { 3, "Grace", "Hopper" }, { 4, "Edsger", "Dijkstra" }
+    };
+    ReservationResult results[4];
+    CHECK_EQ(reservation_make_batch(system, requests, 4, results),
+             RESERVATION_ERROR_SEAT_OCCUPIED);
+    CHECK_EQ(results[0], RESERVATION_SUCCESS);
+    CHECK_EQ(results[1], RESERVATION_SUCCESS);
+    CHECK_EQ(results[2], RESERVATION_ERROR_SEAT_OCCUPIED);
+    CHECK_EQ(results[3], RESERVATION_SUCCESS);
+    CHECK_EQ(reservation_count_available(system), MAX_SEATS - 1);
+    CHECK_EQ(reservation_find_passenger(system, DEFAULT_FLIGHT_ID, "Ada", "Lovelace", NULL, 0),
+             0);
+
+    /* The same seat twice fails the second time */
+    ReservationRequest twice[] = { { 5, "Ken", "Thompson" }, { 5, "Dennis", "Ritchie" } };
+    CHECK_EQ(reservation_make_batch(system, twice, 2, results), RESERVATION_ERROR_SEAT_OCCUPIED);
+    CHECK_EQ(results[0], RESERVATION_SUCCESS);
+    CHECK_EQ(results[1], RESERVATION_ERROR_SEAT_OCCUPIED);
+
+    ReservationRequest invalid[] = { { 6, "Ken", "Thompson" }, { MAX_SEATS + 1, "A", "B" } };
+    CHECK_EQ(reservation_make_batch(system, invalid, 2, NULL), RESERVATION_ERROR_INVALID_SEAT);
+    CHECK_EQ(reservation_count_available(system), MAX_SEATS - 1);
+    reservation_system_destroy(system);
+
+    /* Nothing of the failed batches reached the journal */
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_count_available(system), MAX_SEATS - 1);
+    reservation_system_destroy(system);
+}
+
+/**
+ * @brief A batch replays whole, and a torn batch record replays not at all
+ */
+static void test_group_replay(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_make(system, 10, "Anita", "Borg"), RESERVATION_SUCCESS);
+    ReservationRequest first[] = { { 1, "Ada", "Lovelace" }, { 2, "Alan", "Turing" } };
+    CHECK_EQ(reservation_make_batch(system, first, 2, NULL), RESERVATION_SUCCESS);
+    off_t intact = test_journal_size();
+    ReservationRequest second[] = {
+        { 5, "Grace", "Hopper" }, { 6, "Edsger", "Dijkstra" }, { 7, "Ken", "Thompson" }
+    };
+    CHECK_EQ(reservation_make_batch(system, second, 3, NULL), RESERVATION_SUCCESS);
+    off_t full = test_journal_size();
+    reservation_system_destroy(system);
+
+    /* Cut into the middle of the second batch, past its first records */
+    CHECK(full > intact);
+    CHECK_EQ(truncate(RESERVATION_JOURNAL_FILE, intact + (full - intact) * 2 / 3), 0);
+
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 10, "Anita", "Borg"));
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 1, "Ada", "Lovelace"));
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 2, "Alan", "Turing"));
+    for (int seat = 5; seat <= 7; seat++) {
+        CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, seat));
+    }
+    CHECK_EQ(reservation_count_available(system), MAX_SEATS - 3);
+    reservation_system_destroy(system);
+}
+
+/**
+ * @brief Adjacent booking sets the seat numbers only when it succeeds
+ */
+static void test_adjacent_seat_numbers(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_flight_add(system, 1, 6), RESERVATION_SUCCESS);
+    CHECK_EQ(reservation_flight_make(system, 1, 3, "Taken", "Seat"), RESERVATION_SUCCESS);
+
+    /* Seats 1-2 and 4-6 are free, so no block of four fits */
+    ReservationRequest party[] = {
+        { -7, "Ada", "Lovelace" }, { -7, "Alan", "Turing" },
+        { -7, "Grace", "Hopper" }, { -7, "Edsger", "Dijkstra" }
+    };
+    CHECK_EQ(reservation_flight_book_adjacent(system, 1, NULL, party, 4),
+             RESERVATION_ERROR_NO_ADJACENT_SEATS);
+    for (int i = 0; i < 4; i++) {
+        CHECK_EQ(party[i].seat_number, -7);
+    }
+    CHECK_EQ(reservation_flight_book_adjacent(system, 2, NULL, party, 4),
+             RESERVATION_ERROR_INVALID_FLIGHT);
+    CHECK_EQ(party[0].seat_number, -7);
+
+    CHECK_EQ(reservation_flight_book_adjacent(system, 1, NULL, party, 3), RESERVATION_SUCCESS);
+    for (int i = 0; i < 3; i++) {
+        CHECK_EQ(party[i].seat_number, 4 + i);
+    }
+    CHECK_EQ(party[3].seat_number, -7);
+    reservation_system_destroy(system);
+}
+
+typedef struct {
+    ReservationSystem* system;
+    pthread_barrier_t* barrier;
+    int index;
+    ReservationResult results[RACE_ROUNDS];
+} BatchRacer;
+
+static const char* const FIRST_NAMES[RACE_THREADS] = {
+    "Ada", "Alan", "Grace", "Edsger", "Barbara", "Ken", "Dennis", "Frances"
+};
+
+/* Each round is its own flight; thread i books seats i+1..i+RACE_BATCH */
+static void* race_batches(void* arg) {
+    BatchRacer* racer = arg;
+    ReservationRequest requests[RACE_BATCH];
+    for (int i = 0; i < RACE_BATCH; i++) {
+        requests[i].seat_number = racer->index + 1 + i;
+        requests[i].first_name = FIRST_NAMES[racer->index];
+        requests[i].last_name = "Racer";
+    }
+    for (int round = 0; round < RACE_ROUNDS; round++) {
+        pthread_barrier_wait(racer->barrier);
+        racer->results[round] =
+            reservation_flight_make_batch(racer->system, round + 1, requests, RACE_BATCH, NULL);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Checks every round: a batch that succeeded holds all its seats,
+ *        a failed one none, and no seat is held outside a winning batch
+ */
+static void check_batch_race(const ReservationSystem* system, const BatchRacer* racers) {
+    for (int round = 0; round < RACE_ROUNDS; round++) {
+        int flight_id = round + 1;
+        int held = 0;
+        for (int i = 0; i < RACE_THREADS; i++) {
+            ReservationResult result = racers[i].results[round];
+            CHECK(result == RESERVATION_SUCCESS || result == RESERVATION_ERROR_SEAT_OCCUPIED);
+            for (int seat = i + 1; seat <= i + RACE_BATCH; seat++) {
+                Reservation reservation;
+                bool mine = strcmp(test_seat_holder(system, flight_id, seat, &reservation),
+                                   FIRST_NAMES[i]) == 0;
+                CHECK_EQ(mine, result == RESERVATION_SUCCESS);
+            }
+            held += result == RESERVATION_SUCCESS ? RACE_BATCH : 0;
+        }
+        CHECK(held > 0);
+        CHECK_EQ(reservation_flight_count_available(system, flight_id), RACE_SEATS - held);
+    }
+}
+
+/**
+ * @brief Overlapping batches racing for the same seats stay all or nothing
+ */
+static void test_racing_batches(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    ReservationDurability durability = { 0, 0, 0 };
+    reservation_system_set_durability(system, &durability);
+    for (int round = 0; round < RACE_ROUNDS; round++) {
+        CHECK_EQ(reservation_flight_add(system, round + 1, RACE_SEATS), RESERVATION_SUCCESS);
+    }
+
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, RACE_THREADS);
+    static BatchRacer racers[RACE_THREADS];
+    pthread_t threads[RACE_THREADS];
+    for (int i = 0; i < RACE_THREADS; i++) {
+        racers[i].system = system;
+        racers[i].barrier = &barrier;
+        racers[i].index = i;
+        if (pthread_create(&threads[i], NULL, race_batches, &racers[i]) != 0) {
+            fprintf(stderr, "Error: Cannot start racing threads\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < RACE_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+
+    check_batch_race(system, racers);
+    reservation_system_destroy(system);
+
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    check_batch_race(system, racers);
+    reservation_system_destroy(system);
+}
+
+int main(void) {
+    test_begin();
+    RUN_TEST(test_failed_item);
+    RUN_TEST(test_group_replay);
+    RUN_TEST(test_adjacent_seat_numbers);
+    RUN_TEST(test_racing_batches);
+    return test_end();
+}
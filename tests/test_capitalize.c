@@ -0,0 +1,234 @@
+/**
+ * @file test_capitalize.c
+ * @brief Capitalization across block and chunk boundaries
+ * @author Jaden Mardini
+ *
+ * Streams the same text through capitalization with small blocks, so
+ * words straddle many block boundaries: sequentially, on several
+ * threads, through a pipe in odd-sized writes, and as part of a chain.
+ * Every run must match a byte-at-a-time reference.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "converter_chain.h"
+#include "converter_stream.h"
+#include "converter_transform.h"
+#include "test_util.h"
+#include <fcntl.h>
+#include <pthread.h>
+
+#define INPUT_SIZE ((size_t)300 << 10)
+#define PIPE_PIECE 777
+
+static const char INPUT_PATH[] = "capitalize_input.txt";
+static const char OUTPUT_PATH[] = "capitalize_output.txt";
+
+static bool word_byte(unsigned char c) {
+    unsigned char folded = c | 0x20;
+    return (folded >= 'a' && folded <= 'z') || (c >= '0' && c <= '9') || c == '\'';
+}
+
+/**
+ * @brief Reference: uppercase a letter after a non-word byte, else lowercase
+ */
+static void capitalize_reference(unsigned char* data, size_t length) {
+    bool in_word = false;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = data[i];
+        unsigned char folded = c | 0x20;
+        if (folded >= 'a' && folded <= 'z') {
+            data[i] = in_word ? folded : (unsigned char)(folded & ~0x20);
+        }
+        in_word = word_byte(c);
+    }
+}
+
+/**
+ * @brief Text of words of every length, mixed case, digits and apostrophes
+ */
+static unsigned char* make_input(void) {
+    static const char alphabet[] = "aBcDeFgHiJkLmNoPqRsTuVwXyZ0189'";
+    static const char separators[] = " \n\t.,-;\r\"";
+    unsigned char* data = malloc(INPUT_SIZE);
+    if (!data) return NULL;
+
+    uint32_t seed = 12345;
+    size_t pos = 0;
+    while (pos < INPUT_SIZE) {
+        seed = seed * 1103515245u + 12345u;
+        /* Mostly short words, now and then one longer than a block */
+        size_t word = (seed >> 16) % 97 == 0 ? 5000 + (seed >> 8) % 3000 : (seed >> 16) % 12;
+        for (size_t i = 0; i < word && pos < INPUT_SIZE; i++) {
+            seed = seed * 1103515245u + 12345u;
+            data[pos++] = (unsigned char)alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+        }
+        if (pos < INPUT_SIZE) {
+            data[pos++] = (unsigned char)separators[(seed >> 20) % (sizeof(separators) - 1)];
+        }
+    }
+    return data;
+}
+
+/**
+ * @brief Converts INPUT_PATH (or source_fd) into OUTPUT_PATH and compares
+ */
+static void check_run(int source_fd, const StreamTransform* transform, size_t block_size,
+                      unsigned int threads, const unsigned char* expected, size_t length) {
+    int dest_fd = open(OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(source_fd >= 0 && dest_fd >= 0);
+    if (source_fd < 0 || dest_fd < 0) return;
+
+    StreamOptions options = { block_size, threads, NULL, NULL };
+    uint64_t written = 0;
+    CHECK(stream_convert(source_fd, dest_fd, transform, &options, &written));
+    close(dest_fd);
+    CHECK_EQ(written, length);
+
+    size_t got = 0;
+    unsigned char* output = test_read_file(OUTPUT_PATH, &got);
+    CHECK(output != NULL && got == length && memcmp(output, expected, length) == 0);
+    if (output && got == length && memcmp(output, expected, length) != 0) {
+        size_t at = 0;
+        while (output[at] == expected[at]) at++;
+        fprintf(stderr, "  block %zu, %u threads: first difference at byte %zu\n", block_size,
+                threads, at);
+    }
+    free(output);
+}
+
+/**
+ * @brief Sequential and parallel runs agree with the reference at any block size
+ */
+static void test_chunked(void) {
+    unsigned char* input = make_input();
+    unsigned char* expected = malloc(INPUT_SIZE);
+    CHECK(input && expected);
+    if (!input || !expected) {
+        free(input);
+        free(expected);
+        return;
+    }
+    memcpy(expected, input, INPUT_SIZE);
+    capitalize_reference(expected, INPUT_SIZE);
+    CHECK(test_write_file(INPUT_PATH, input, INPUT_SIZE));
+
+    static const size_t block_sizes[] = { 4096, 4099, 65536 };
+    static const unsigned int thread_counts[] = { 1, 4 };
+    for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+        for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+            Chain chain;
+            StreamTransform transform;
+            chain_init(&chain);
+            CHECK(chain_add_capitalize(&chain));
+            chain_stream(&chain, &transform);
+            CHECK(transform.apply == transform_capitalize && transform.resume != NULL);
+
+            int source_fd = open(INPUT_PATH, O_RDONLY);
+            check_run(source_fd, &transform, block_sizes[b], thread_counts[t], expected,
+                      INPUT_SIZE);
+            if (source_fd >= 0) close(source_fd);
+        }
+    }
+    free(input);
+    free(expected);
+}
+
+typedef struct {
+    int fd;
+    const unsigned char* data;
+    size_t length;
+} PipeWriter;
+
+static void* write_pieces(void* arg) {
+    PipeWriter* writer = arg;
+    for (size_t pos = 0; pos < writer->length; ) {
+        size_t piece = writer->length - pos < PIPE_PIECE ? writer->length - pos : PIPE_PIECE;
+        ssize_t written = write(writer->fd, writer->data + pos, piece);
+        if (written <= 0) break;
+        pos += (size_t)written;
+    }
+    close(writer->fd);
+    return NULL;
+}
+
+/**
+ * @brief Reads of arbitrary size from a pipe carry the state between them
+ */
+static void test_pipe(void) {
+    unsigned char* input = make_input();
+    unsigned char* expected = malloc(INPUT_SIZE);
+    CHECK(input && expected);
+    int fds[2];
+    if (!input || !expected || pipe(fds) != 0) {
+        CHECK(false);
+        free(input);
+        free(expected);
+        return;
+    }
+    memcpy(expected, input, INPUT_SIZE);
+    capitalize_reference(expected, INPUT_SIZE);
+
+    Chain chain;
+    StreamTransform transform;
+    chain_init(&chain);
+    CHECK(chain_add_capitalize(&chain));
+    chain_stream(&chain, &transform);
+
+    PipeWriter writer = { fds[1], input, INPUT_SIZE };
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, write_pieces, &writer) == 0);
+    check_run(fds[0], &transform, 4096, 4, expected, INPUT_SIZE);
+    pthread_join(thread, NULL);
+    close(fds[0]);
+    free(input);
+    free(expected);
+}
+
+/**
+ * @brief Capitalization keeps its state inside a chain filter, across tiles
+ *        and blocks, with a CRLF stage after it
+ */
+static void test_in_chain(void) {
+    unsigned char* input = make_input();
+    unsigned char* expected = malloc(INPUT_SIZE);
+    CHECK(input && expected);
+    if (!input || !expected) {
+        free(input);
+        free(expected);
+        return;
+    }
+    memcpy(expected, input, INPUT_SIZE);
+    capitalize_reference(expected, INPUT_SIZE);
+    size_t length = 0;
+    for (size_t i = 0; i < INPUT_SIZE; i++) {
+        if (!(expected[i] == '\r' && i + 1 < INPUT_SIZE && expected[i + 1] == '\n')) {
+            expected[length++] = expected[i];
+        }
+    }
+    CHECK(test_write_file(INPUT_PATH, input, INPUT_SIZE));
+
+    static const size_t block_sizes[] = { 4096, 65537 };
+    for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+        Chain chain;
+        StreamTransform transform;
+        chain_init(&chain);
+        CHECK(chain_add_capitalize(&chain) && chain_add_crlf(&chain));
+        chain_stream(&chain, &transform);
+        CHECK(transform.filter != NULL);
+
+        int source_fd = open(INPUT_PATH, O_RDONLY);
+        check_run(source_fd, &transform, block_sizes[b], 1, expected, length);
+        if (source_fd >= 0) close(source_fd);
+    }
+    free(input);
+    free(expected);
+}
+
+int main(void) {
+    test_begin();
+    RUN_TEST(test_chunked);
+    RUN_TEST(test_pipe);
+    RUN_TEST(test_in_chain);
+    return test_end();
+}
@@ -0,0 +1,225 @@
+/**
+ * @file test_chain.c
+ * @brief Transform chain folding and boundary tests
+ * @author Jaden Mardini
+ *
+ * Checks which stages a chain folds together, then feeds CRLF and trim
+ * chains their input split at every position, and streams long blank
+ * runs across tile and block boundaries.  Output must not depend on
+ * where the input was cut.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "converter_chain.h"
+#include "converter_stream.h"
+#include "converter_transform.h"
+#include "test_util.h"
+#include <fcntl.h>
+
+static const char INPUT_PATH[] = "chain_input.txt";
+static const char OUTPUT_PATH[] = "chain_output.txt";
+
+/**
+ * @brief Reference CRLF stage: drops every CR directly before an LF
+ */
+static size_t crlf_reference(unsigned char* data, size_t length) {
+    size_t kept = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!(data[i] == '\r' && i + 1 < length && data[i + 1] == '\n')) data[kept++] = data[i];
+    }
+    return kept;
+}
+
+/**
+ * @brief Reference trim stage: drops spaces and tabs before every LF and at the end
+ */
+static size_t trim_reference(unsigned char* data, size_t length) {
+    size_t kept = 0;
+    size_t line = 0;
+    for (size_t i = 0; i <= length; i++) {
+        if (i == length || data[i] == '\n') {
+            size_t end = i;
+            while (end > line && (data[end - 1] == ' ' || data[end - 1] == '\t')) end--;
+            memmove(data + kept, data + line, end - line);
+            kept += end - line;
+            if (i < length) data[kept++] = '\n';
+            line = i + 1;
+        }
+    }
+    return kept;
+}
+
+/**
+ * @brief Runs a filter over input cut into two calls at split, then flushes
+ */
+static size_t run_split(const StreamTransform* transform, const unsigned char* input,
+                        size_t length, size_t split, unsigned char* output) {
+    size_t count = transform->filter(output, input, split, transform->context);
+    count += transform->filter(output + count, input + split, length - split,
+                               transform->context);
+    count += transform->filter(output + count, NULL, 0, transform->context);
+    return count;
+}
+
+/**
+ * @brief Neighbouring maps and deletions fold into one stage
+ */
+static void test_folding(void) {
+    Chain chain;
+    StreamTransform transform;
+
+    chain_init(&chain);
+    CHECK(chain_add_lowercase(&chain) && chain_add_uppercase(&chain));
+    CHECK_EQ(chain.stage_count, 1);
+    chain_stream(&chain, &transform);
+    CHECK(transform.apply == transform_uppercase && transform.filter == NULL);
+
+    bool set[256] = { false };
+    set['X'] = true;
+    chain_init(&chain);
+    CHECK(chain_add_uppercase(&chain) && chain_add_delete(&chain, set) &&
+          chain_add_lowercase(&chain));
+    CHECK_EQ(chain.stage_count, 1);
+    chain_stream(&chain, &transform);
+    CHECK(transform.filter != NULL);
+
+    static const char input[] = "Extra, Xylophone: xX!";
+    unsigned char output[sizeof(input) + STREAM_FILTER_SLACK];
+    size_t count = run_split(&transform, (const unsigned char*)input, sizeof(input) - 1, 7,
+                             output);
+    CHECK(count == strlen("etra, ylophone: !") &&
+          memcmp(output, "etra, ylophone: !", count) == 0);
+
+    /* A stateful stage ends a run of maps */
+    chain_init(&chain);
+    CHECK(chain_add_uppercase(&chain) && chain_add_trim(&chain) && chain_add_lowercase(&chain));
+    CHECK_EQ(chain.stage_count, 3);
+}
+
+/**
+ * @brief Output is the same wherever one filter call ends and the next begins
+ */
+static void check_every_split(bool crlf, bool trim, const char* text) {
+    const unsigned char* input = (const unsigned char*)text;
+    size_t length = strlen(text);
+    unsigned char expected[256];
+    unsigned char output[256 + STREAM_FILTER_SLACK];
+    memcpy(expected, input, length);
+    size_t expected_length = length;
+    if (crlf) expected_length = crlf_reference(expected, expected_length);
+    if (trim) expected_length = trim_reference(expected, expected_length);
+
+    for (size_t split = 0; split <= length; split++) {
+        Chain chain;
+        StreamTransform transform;
+        chain_init(&chain);
+        CHECK(!crlf || chain_add_crlf(&chain));
+        CHECK(!trim || chain_add_trim(&chain));
+        chain_stream(&chain, &transform);
+
+        size_t count = run_split(&transform, input, length, split, output);
+        CHECK(count == expected_length && memcmp(output, expected, count) == 0);
+        if (count != expected_length || memcmp(output, expected, count) != 0) {
+            fprintf(stderr, "  split at %zu of \"%s\"\n", split, text);
+            break;
+        }
+    }
+}
+
+static void test_crlf(void) {
+    check_every_split(true, false, "a\r\nb\r\r\nc\rd\r\n\r\ne\r");
+    check_every_split(true, false, "\r\r\r\n\n\r");
+}
+
+static void test_trim(void) {
+    check_every_split(false, true, "one  \ntwo\t \t\n  three  four \n\n \t \nend   ");
+    check_every_split(false, true, "x \t y\t\n   \n\t");
+    /* CRLF first, so blanks before a CRLF line end go too */
+    check_every_split(true, true, "one  \r\ntwo \r \r\nthree\t\r\n  ");
+}
+
+/**
+ * @brief Streams a file through a trim chain and compares with the reference
+ */
+static void check_streamed_trim(const unsigned char* input, size_t length, size_t block_size) {
+    unsigned char* expected = malloc(length);
+    CHECK(expected != NULL && test_write_file(INPUT_PATH, input, length));
+    if (!expected) return;
+    memcpy(expected, input, length);
+    size_t expected_length = trim_reference(expected, length);
+
+    Chain chain;
+    StreamTransform transform;
+    chain_init(&chain);
+    CHECK(chain_add_trim(&chain));
+    chain_stream(&chain, &transform);
+
+    int source_fd = open(INPUT_PATH, O_RDONLY);
+    int dest_fd = open(OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    StreamOptions options = { block_size, 1, NULL, NULL };
+    uint64_t written = 0;
+    CHECK(source_fd >= 0 && dest_fd >= 0 &&
+          stream_convert(source_fd, dest_fd, &transform, &options, &written));
+    if (source_fd >= 0) close(source_fd);
+    if (dest_fd >= 0) close(dest_fd);
+
+    size_t got = 0;
+    unsigned char* output = test_read_file(OUTPUT_PATH, &got);
+    CHECK_EQ(written, expected_length);
+    CHECK(output != NULL && got == expected_length && memcmp(output, expected, got) == 0);
+    free(output);
+    free(expected);
+}
+
+/**
+ * @brief Appends count copies of a byte pattern
+ */
+static size_t append(unsigned char* data, size_t pos, const char* pattern, size_t count) {
+    size_t length = strlen(pattern);
+    for (size_t i = 0; i < count; i++) {
+        memcpy(data + pos, pattern, length);
+        pos += length;
+    }
+    return pos;
+}
+
+/**
+ * @brief Blank runs crossing 16 KiB tiles and block ends are trimmed exactly
+ */
+static void test_long_blank_runs(void) {
+    size_t capacity = (size_t)256 << 10;
+    unsigned char* input = malloc(capacity);
+    CHECK(input != NULL);
+    if (!input) return;
+
+    /* A trailing run crossing the first tile boundary */
+    size_t length = append(input, 0, "x", 15384);
+    length = append(input, length, " ", 1000);
+    length = append(input, length, "\n", 1);
+    /* A long run of mixed blanks that turns out to go on */
+    length = append(input, length, "y", 1);
+    length = append(input, length, " \t", 6000);
+    length = append(input, length, "y\n", 1);
+    /* A mixed run longer than a tile, ending the line */
+    length = append(input, length, "z", 1);
+    length = append(input, length, "\t   ", 6000);
+    length = append(input, length, "\n", 1);
+    /* A run at the very end of the input */
+    length = append(input, length, "end", 1);
+    length = append(input, length, " ", 20000);
+
+    check_streamed_trim(input, length, 4096);
+    check_streamed_trim(input, length, 65536);
+    check_streamed_trim(input, length, (size_t)1 << 20);
+    free(input);
+}
+
+int main(void) {
+    test_begin();
+    RUN_TEST(test_folding);
+    RUN_TEST(test_crlf);
+    RUN_TEST(test_trim);
+    RUN_TEST(test_long_blank_runs);
+    return test_end();
+}
@@ -0,0 +1,175 @@
+/**
+ * @file test_concurrency.c
+ * @brief Racing bookings from many threads
+ * @author Jaden Mardini
+ *
+ * All threads wait on a barrier before each seat, then try to book (or
+ * cancel) the same seat at once.  Exactly one of them may succeed, the
+ * seat must end up held by the winner, and the journal must replay the
+ * same outcome.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reservation_system.h"
+#include "test_util.h"
+#include <pthread.h>
+
+#define RACE_FLIGHT 1
+#define RACE_SEATS 256
+#define RACE_THREADS 8
+
+typedef struct {
+    ReservationSystem* system;
+    pthread_barrier_t* barrier;
+    int index;
+    bool cancel;                        /* Cancel every seat instead of booking it */
+    int wins[RACE_SEATS + 1];           /* 1 where this thread's call succeeded */
+    int other_errors;                   /* Failures other than the expected one */
+} Racer;
+
+/* Every round syncs nothing, so the threads race on the locks alone */
+static const ReservationDurability NO_SYNC = { 0, 0, 0 };
+
+static const char* const FIRST_NAMES[RACE_THREADS] = {
+    "Ada", "Alan", "Grace", "Edsger", "Barbara", "Ken", "Dennis", "Frances"
+};
+
+static void* race(void* arg) {
+    Racer* racer = arg;
+    ReservationResult lost = racer->cancel ? RESERVATION_ERROR_SEAT_EMPTY
+                                           : RESERVATION_ERROR_SEAT_OCCUPIED;
+    for (int seat = 1; seat <= RACE_SEATS; seat++) {
+        pthread_barrier_wait(racer->barrier);
+        ReservationResult result =
+            racer->cancel ? reservation_flight_cancel(racer->system, RACE_FLIGHT, seat)
+                          : reservation_flight_make(racer->system, RACE_FLIGHT, seat,
+                                                    FIRST_NAMES[racer->index], "Racer");
+        if (result == RESERVATION_SUCCESS) {
+            racer->wins[seat] = 1;
+        } else if (result != lost) {
+            racer->other_errors++;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs every thread over every seat
+ */
+static void run_race(ReservationSystem* system, bool cancel, Racer* racers) {
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, RACE_THREADS);
+    pthread_t threads[RACE_THREADS];
+    int started = 0;
+    for (; started < RACE_THREADS; started++) {
+        memset(&racers[started], 0, sizeof(Racer));
+        racers[started].system = system;
+        racers[started].barrier = &barrier;
+        racers[started].index = started;
+        racers[started].cancel = cancel;
+        if (pthread_create(&threads[started], NULL, race, &racers[started]) != 0) break;
+    }
+    /* A missing thread would leave the others stuck on the barrier */
+    if (started < RACE_THREADS) {
+        fprintf(stderr, "Error: Cannot start racing threads\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < RACE_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+}
+
+/**
+ * @brief Checks that each seat is held by the one thread that won it
+ */
+static void check_winners(const ReservationSystem* system, const int* winner) {
+    for (int seat = 1; seat <= RACE_SEATS; seat++) {
+        Reservation reservation;
+        const char* holder = test_seat_holder(system, RACE_FLIGHT, seat, &reservation);
+        CHECK(strcmp(holder, "") != 0 && strcmp(holder, "?") != 0);
+        if (winner[seat] >= 0) {
+            CHECK(strcmp(holder, FIRST_NAMES[winner[seat]]) == 0);
+        }
+    }
+    CHECK_EQ(reservation_flight_count_available(system, RACE_FLIGHT), 0);
+}
+
+/**
+ * @brief Of the threads booking one seat at once, exactly one succeeds
+ */
+static void test_racing_bookings(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(&NO_SYNC);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_flight_add(system, RACE_FLIGHT, RACE_SEATS), RESERVATION_SUCCESS);
+
+    static Racer racers[RACE_THREADS];
+    run_race(system, false, racers);
+
+    int winner[RACE_SEATS + 1];
+    for (int seat = 1; seat <= RACE_SEATS; seat++) {
+        int wins = 0;
+        winner[seat] = -1;
+        for (int i = 0; i < RACE_THREADS; i++) {
+            if (racers[i].wins[seat]) {
+                wins++;
+                winner[seat] = i;
+            }
+        }
+        CHECK_EQ(wins, 1);
+    }
+    for (int i = 0; i < RACE_THREADS; i++) {
+        CHECK_EQ(racers[i].other_errors, 0);
+    }
+    check_winners(system, winner);
+    reservation_system_destroy(system);
+
+    /* Replay must agree with what the threads were told */
+    system = test_open_system(&NO_SYNC);
+    CHECK(system != NULL);
+    if (!system) return;
+    check_winners(system, winner);
+    reservation_system_destroy(system);
+}
+
+/**
+ * @brief Of the threads cancelling one seat at once, exactly one succeeds
+ */
+static void test_racing_cancels(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(&NO_SYNC);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_flight_add(system, RACE_FLIGHT, RACE_SEATS), RESERVATION_SUCCESS);
+    for (int seat = 1; seat <= RACE_SEATS; seat++) {
+        CHECK_EQ(reservation_flight_make(system, RACE_FLIGHT, seat, "Linus", "Torvalds"),
+                 RESERVATION_SUCCESS);
+    }
+
+    static Racer racers[RACE_THREADS];
+    run_race(system, true, racers);
+
+    for (int seat = 1; seat <= RACE_SEATS; seat++) {
+        int wins = 0;
+        for (int i = 0; i < RACE_THREADS; i++) {
+            wins += racers[i].wins[seat];
+        }
+        CHECK_EQ(wins, 1);
+    }
+    for (int i = 0; i < RACE_THREADS; i++) {
+        CHECK_EQ(racers[i].other_errors, 0);
+    }
+    CHECK_EQ(reservation_flight_count_available(system, RACE_FLIGHT), RACE_SEATS);
+    CHECK_EQ(reservation_find_passenger(system, RACE_FLIGHT, "Linus", "Torvalds", NULL, 0), 0);
+    reservation_system_destroy(system);
+}
+
+int main(void) {
+    test_begin();
+    RUN_TEST(test_racing_bookings);
+    RUN_TEST(test_racing_cancels);
+    return test_end();
+}
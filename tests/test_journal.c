@@ -0,0 +1,237 @@
+/**
+ * @file test_journal.c
+ * @brief Journal replay and sync policy tests
+ * @author Jaden Mardini
+ *
+ * Bookings are made without a snapshot save, so a reload sees them only
+ * through journal replay.  The journal is then damaged the way a crash
+ * in the middle of an append would leave it.  The program is linked with
+ * fdatasync and ftruncate wrapped, so a test can make them fail.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reservation_system.h"
+#include "test_util.h"
+#include <time.h>
+
+static bool fail_sync = false;
+static bool fail_truncate = false;
+
+int __real_fdatasync(int fd);
+int __real_ftruncate(int fd, off_t length);
+
+int __wrap_fdatasync(int fd) {
+    if (fail_sync) {
+        errno = EIO;
+        return -1;
+    }
+    return __real_fdatasync(fd);
+}
+
+int __wrap_ftruncate(int fd, off_t length) {
+    if (fail_truncate) {
+        errno = EIO;
+        return -1;
+    }
+    return __real_ftruncate(fd, length);
+}
+
+/**
+ * @brief A record cut short by a crash is dropped, the ones before it kept
+ */
+static void test_torn_tail(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_make(system, 1, "Ada", "Lovelace"), RESERVATION_SUCCESS);
+    CHECK_EQ(reservation_make(system, 2, "Alan", "Turing"), RESERVATION_SUCCESS);
+    off_t intact = test_journal_size();
+    CHECK_EQ(reservation_make(system, 3, "Grace", "Hopper"), RESERVATION_SUCCESS);
+    off_t full = test_journal_size();
+    reservation_system_destroy(system);
+
+    CHECK(intact > 0 && full > intact);
+    CHECK_EQ(truncate(RESERVATION_JOURNAL_FILE, full - 3), 0);
+
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 1, "Ada", "Lovelace"));
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 2, "Alan", "Turing"));
+    CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, 3));
+    CHECK_EQ(reservation_make(system, 4, "Edsger", "Dijkstra"), RESERVATION_SUCCESS);
+    reservation_system_destroy(system);
+
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 2, "Alan", "Turing"));
+    CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, 3));
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 4, "Edsger", "Dijkstra"));
+    CHECK_EQ(reservation_count_available(system), MAX_SEATS - 3);
+    reservation_system_destroy(system);
+}
+
+/**
+ * @brief Bytes that do not form a record end the replay without an error
+ */
+static void test_corrupt_tail(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_make(system, 5, "Barbara", "Liskov"), RESERVATION_SUCCESS);
+    CHECK_EQ(reservation_cancel(system, 5), RESERVATION_SUCCESS);
+    CHECK_EQ(reservation_make(system, 6, "Ken", "Thompson"), RESERVATION_SUCCESS);
+    reservation_system_destroy(system);
+
+    FILE* journal = fopen(RESERVATION_JOURNAL_FILE, "ab");
+    CHECK(journal != NULL);
+    if (!journal) return;
+    fputs("\x20\x00\x00\x00garbage that is not a record", journal);
+    fclose(journal);
+
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, 5));
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 6, "Ken", "Thompson"));
+    CHECK_EQ(reservation_count_available(system), MAX_SEATS - 1);
+    reservation_system_destroy(system);
+}
+
+/**
+ * @brief Saving folds the journal into the snapshot and empties it
+ */
+static void test_save_truncates(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    off_t empty = test_journal_size();
+    CHECK_EQ(reservation_make(system, 7, "Dennis", "Ritchie"), RESERVATION_SUCCESS);
+    CHECK(test_journal_size() > empty);
+    CHECK_EQ(reservation_system_save(system), RESERVATION_SUCCESS);
+    CHECK_EQ(test_journal_size(), empty);
+    reservation_system_destroy(system);
+
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 7, "Dennis", "Ritchie"));
+    reservation_system_destroy(system);
+}
+
+/**
+ * @brief A booking whose sync fails is reported failed, taken back out of
+ *        the journal and not replayed
+ */
+static void test_failed_sync(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_make(system, 1, "Ada", "Lovelace"), RESERVATION_SUCCESS);
+    off_t before = test_journal_size();
+
+    fail_sync = true;
+    CHECK_EQ(reservation_make(system, 2, "Alan", "Turing"), RESERVATION_ERROR_FILE_IO);
+    ReservationRequest batch[] = { { 3, "Grace", "Hopper" }, { 4, "Edsger", "Dijkstra" } };
+    CHECK_EQ(reservation_make_batch(system, batch, 2, NULL), RESERVATION_ERROR_FILE_IO);
+    CHECK_EQ(reservation_cancel(system, 1), RESERVATION_ERROR_FILE_IO);
+    fail_sync = false;
+    CHECK_EQ(test_journal_size(), before);
+    CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, 2));
+    CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, 3));
+    CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, 4));
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 1, "Ada", "Lovelace"));
+
+    /* The journal carries on once syncs work again */
+    CHECK_EQ(reservation_make(system, 5, "Ken", "Thompson"), RESERVATION_SUCCESS);
+    reservation_system_destroy(system);
+
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 1, "Ada", "Lovelace"));
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 5, "Ken", "Thompson"));
+    CHECK_EQ(reservation_count_available(system), MAX_SEATS - 2);
+    reservation_system_destroy(system);
+}
+
+/**
+ * @brief A failed append that cannot be cut off stops the journal
+ */
+static void test_failed_truncate(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+
+    fail_sync = true;
+    fail_truncate = true;
+    CHECK_EQ(reservation_make(system, 1, "Ada", "Lovelace"), RESERVATION_ERROR_FILE_IO);
+    fail_sync = false;
+    fail_truncate = false;
+    CHECK_EQ(reservation_make(system, 2, "Alan", "Turing"), RESERVATION_ERROR_FILE_IO);
+    CHECK_EQ(reservation_system_flush(system), RESERVATION_ERROR_FILE_IO);
+    CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, 1));
+    CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, 2));
+
+    /* A save folds the journal away and clears the failure */
+    CHECK_EQ(reservation_system_save(system), RESERVATION_SUCCESS);
+    CHECK_EQ(reservation_make(system, 3, "Grace", "Hopper"), RESERVATION_SUCCESS);
+    reservation_system_destroy(system);
+
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, 1));
+    CHECK(test_seat_free(system, DEFAULT_FLIGHT_ID, 2));
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, 3, "Grace", "Hopper"));
+    reservation_system_destroy(system);
+}
+
+#ifndef RESERVATION_NO_STATS
+/**
+ * @brief With only an interval set, the last record of a burst is synced
+ *        once the interval passes, without another append
+ */
+static void test_interval_sync(void) {
+    test_clear();
+    ReservationSystem* system = reservation_system_create();
+    CHECK(system != NULL);
+    if (!system) return;
+    ReservationDurability durability = { 0, 50, 0 };
+    reservation_system_set_durability(system, &durability);
+    CHECK_EQ(reservation_system_load(system), RESERVATION_SUCCESS);
+
+    ReservationStats before, after;
+    CHECK_EQ(reservation_system_get_stats(system, &before), RESERVATION_SUCCESS);
+    CHECK_EQ(reservation_make(system, 8, "Frances", "Allen"), RESERVATION_SUCCESS);
+    CHECK_EQ(reservation_make(system, 9, "John", "Backus"), RESERVATION_SUCCESS);
+    CHECK_EQ(reservation_system_get_stats(system, &after), RESERVATION_SUCCESS);
+    CHECK_EQ(after.syncs, before.syncs);
+
+    struct timespec pause = { 0, 200 * 1000000L };
+    nanosleep(&pause, NULL);
+    CHECK_EQ(reservation_system_get_stats(system, &after), RESERVATION_SUCCESS);
+    CHECK_EQ(after.syncs, before.syncs + 1);
+    reservation_system_destroy(system);
+}
+#endif
+
+int main(void) {
+    test_begin();
+    RUN_TEST(test_torn_tail);
+    RUN_TEST(test_corrupt_tail);
+    RUN_TEST(test_save_truncates);
+    RUN_TEST(test_failed_sync);
+    RUN_TEST(test_failed_truncate);
+#ifndef RESERVATION_NO_STATS
+    RUN_TEST(test_interval_sync);
+#endif
+    return test_end();
+}
@@ -0,0 +1,89 @@
+/**
+ * @file test_output.c
+ * @brief Atomic output replacement tests
+ * @author Jaden Mardini
+ *
+ * Writes through stream_output_open and stream_output_commit over files
+ * that already exist, checking what is replaced and what carries over.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "converter_stream.h"
+#include "test_util.h"
+#include <sys/stat.h>
+
+/**
+ * @brief Writes text to path through a temporary file and rename
+ */
+static bool write_output(const char* path, const char* text) {
+    StreamOutput output;
+    if (!stream_output_open(&output, path, strlen(text))) return false;
+    if (write(output.fd, text, strlen(text)) != (ssize_t)strlen(text)) {
+        stream_output_abort(&output);
+        return false;
+    }
+    return stream_output_commit(&output, strlen(text), true);
+}
+
+static bool file_holds(const char* path, const char* text) {
+    size_t length = 0;
+    unsigned char* data = test_read_file(path, &length);
+    bool same = data && length == strlen(text) && memcmp(data, text, length) == 0;
+    free(data);
+    return same;
+}
+
+/**
+ * @brief An existing file is replaced with its permissions kept
+ */
+static void test_replace_keeps_mode(void) {
+    test_clear();
+    CHECK(test_write_file("plain.txt", "old", 3));
+    CHECK_EQ(chmod("plain.txt", 0640), 0);
+    CHECK(write_output("plain.txt", "new contents"));
+    CHECK(file_holds("plain.txt", "new contents"));
+
+    struct stat info;
+    CHECK_EQ(stat("plain.txt", &info), 0);
+    CHECK_EQ(info.st_mode & 07777, 0640);
+    CHECK_EQ(info.st_uid, getuid());
+}
+
+/**
+ * @brief Writing to a symbolic link replaces its target and keeps the link
+ */
+static void test_symlink_target(void) {
+    test_clear();
+    CHECK(test_write_file("target.txt", "old", 3));
+    CHECK_EQ(chmod("target.txt", 0600), 0);
+    CHECK_EQ(symlink("target.txt", "link.txt"), 0);
+    CHECK(write_output("link.txt", "through the link"));
+
+    struct stat info;
+    CHECK_EQ(lstat("link.txt", &info), 0);
+    CHECK(S_ISLNK(info.st_mode));
+    CHECK(file_holds("target.txt", "through the link"));
+    CHECK_EQ(stat("target.txt", &info), 0);
+    CHECK_EQ(info.st_mode & 07777, 0600);
+}
+
+/**
+ * @brief A dangling link is refused, leaving no file behind
+ */
+static void test_dangling_symlink(void) {
+    test_clear();
+    CHECK_EQ(symlink("missing.txt", "dangling.txt"), 0);
+    errno = 0;
+    CHECK(!write_output("dangling.txt", "nowhere"));
+    CHECK_EQ(errno, ENOENT);
+    CHECK_EQ(access("missing.txt", F_OK), -1);
+}
+
+int main(void) {
+    test_begin();
+    RUN_TEST(test_replace_keeps_mode);
+    RUN_TEST(test_symlink_target);
+    RUN_TEST(test_dangling_symlink);
+    return test_end();
+}
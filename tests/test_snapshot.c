@@ -0,0 +1,163 @@
+/**
+ * @file test_snapshot.c
+ * @brief Snapshot format migration tests
+ * @author Jaden Mardini
+ *
+ * Older snapshots are written here byte by byte, loaded, saved again in
+ * the current format and reloaded, checking the seats at every step.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reservation_system.h"
+#include "test_util.h"
+
+#define SNAPSHOT_MAGIC 0x53565352u
+#define LEGACY_FLIGHT 7
+#define LEGACY_SEATS 5
+
+static void put_u32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static void put_seat(unsigned char* out, int seat, const char* first_name,
+                     const char* last_name) {
+    Reservation reservation;
+    memset(&reservation, 0, sizeof(reservation));
+    reservation.seat_number = seat;
+    if (first_name) {
+        reservation.is_reserved = true;
+        strcpy(reservation.first_name, first_name);
+        strcpy(reservation.last_name, last_name);
+    }
+    memcpy(out, &reservation, sizeof(reservation));
+}
+
+static uint32_t snapshot_version(void) {
+    size_t length = 0;
+    unsigned char* data = test_read_file(RESERVATION_FILE, &length);
+    uint32_t version = 0;
+    if (data && length >= 8) {
+        version = (uint32_t)data[4] | (uint32_t)data[5] << 8 | (uint32_t)data[6] << 16 |
+                  (uint32_t)data[7] << 24;
+    }
+    free(data);
+    return version;
+}
+
+static void check_legacy_flight(const ReservationSystem* system) {
+    CHECK_EQ(reservation_flight_seat_count(system, LEGACY_FLIGHT), LEGACY_SEATS);
+    CHECK(test_seat_held_by(system, LEGACY_FLIGHT, 2, "Ada", "Byron"));
+    CHECK(test_seat_held_by(system, LEGACY_FLIGHT, 5, "Charles", "Babbage"));
+    CHECK_EQ(reservation_flight_count_available(system, LEGACY_FLIGHT), LEGACY_SEATS - 2);
+    CHECK_EQ(reservation_find_passenger(system, LEGACY_FLIGHT, "Ada", "Byron", NULL, 0), 1);
+}
+
+/**
+ * @brief A version 1 snapshot of raw records loads and is rewritten as version 2
+ */
+static void test_v1_to_v2(void) {
+    test_clear();
+    size_t record = sizeof(Reservation);
+    size_t length = 20 + LEGACY_SEATS * record;
+    unsigned char* file = calloc(1, length);
+    CHECK(file != NULL);
+    if (!file) return;
+    put_u32(file, SNAPSHOT_MAGIC);
+    put_u32(file + 4, 1);
+    put_u32(file + 8, 1);
+    put_u32(file + 12, LEGACY_FLIGHT);
+    put_u32(file + 16, LEGACY_SEATS);
+    unsigned char* seats = file + 20;
+    for (int i = 0; i < LEGACY_SEATS; i++) {
+        put_seat(seats + i * record, i + 1, NULL, NULL);
+    }
+    put_seat(seats + 1 * record, 2, "Ada", "Byron");
+    put_seat(seats + 4 * record, 5, "Charles", "Babbage");
+    CHECK(test_write_file(RESERVATION_FILE, file, length));
+    free(file);
+    CHECK_EQ(snapshot_version(), 1);
+
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    check_legacy_flight(system);
+    CHECK_EQ(reservation_system_save(system), RESERVATION_SUCCESS);
+    reservation_system_destroy(system);
+    CHECK_EQ(snapshot_version(), 2);
+
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    check_legacy_flight(system);
+    reservation_system_destroy(system);
+}
+
+/**
+ * @brief A headerless file of MAX_SEATS raw records becomes the default flight
+ */
+static void test_headerless(void) {
+    test_clear();
+    size_t record = sizeof(Reservation);
+    unsigned char* file = calloc(MAX_SEATS, record);
+    CHECK(file != NULL);
+    if (!file) return;
+    for (int i = 0; i < MAX_SEATS; i++) {
+        put_seat(file + i * record, i + 1, NULL, NULL);
+    }
+    put_seat(file + (MAX_SEATS - 1) * record, MAX_SEATS, "Hedy", "Lamarr");
+    CHECK(test_write_file(RESERVATION_FILE, file, MAX_SEATS * record));
+    free(file);
+
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, MAX_SEATS, "Hedy", "Lamarr"));
+    CHECK_EQ(reservation_count_available(system), MAX_SEATS - 1);
+    CHECK_EQ(reservation_system_save(system), RESERVATION_SUCCESS);
+    reservation_system_destroy(system);
+    CHECK_EQ(snapshot_version(), 2);
+
+    system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK(test_seat_held_by(system, DEFAULT_FLIGHT_ID, MAX_SEATS, "Hedy", "Lamarr"));
+    reservation_system_destroy(system);
+}
+
+/**
+ * @brief A snapshot with a bad checksum is refused rather than half loaded
+ */
+static void test_corrupt_v2(void) {
+    test_clear();
+    ReservationSystem* system = test_open_system(NULL);
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_make(system, 3, "Anita", "Borg"), RESERVATION_SUCCESS);
+    CHECK_EQ(reservation_system_save(system), RESERVATION_SUCCESS);
+    reservation_system_destroy(system);
+
+    size_t length = 0;
+    unsigned char* data = test_read_file(RESERVATION_FILE, &length);
+    CHECK(data != NULL && length > 12);
+    if (!data) return;
+    data[length - 5] ^= 0x01;
+    CHECK(test_write_file(RESERVATION_FILE, data, length));
+    free(data);
+
+    system = reservation_system_create();
+    CHECK(system != NULL);
+    if (!system) return;
+    CHECK_EQ(reservation_system_load(system), RESERVATION_ERROR_FILE_IO);
+    reservation_system_destroy(system);
+}
+
+int main(void) {
+    test_begin();
+    RUN_TEST(test_v1_to_v2);
+    RUN_TEST(test_headerless);
+    RUN_TEST(test_corrupt_v2);
+    return test_end();
+}
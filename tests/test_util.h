@@ -0,0 +1,183 @@
+/**
+ * @file test_util.h
+ * @brief Check macros and fixtures shared by the test programs
+ * @author Jaden Mardini
+ *
+ * Every test program is a plain executable run by make test.  Checks
+ * report the failing expression and keep going; the program exits
+ * non-zero if any check failed.  Tests run inside a scratch directory,
+ * since the reservation system keeps its files in the working directory.
+ * The reservation fixtures are only linked into the programs that use them.
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "reservation_system.h"
+
+static int test_failures = 0;
+static char test_scratch[] = "/tmp/rsv_test_XXXXXX";
+
+#define CHECK(condition)                                                            \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,        \
+                    #condition);                                                    \
+            test_failures++;                                                        \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                  \
+    do {                                                                            \
+        long long actual_ = (long long)(actual);                                    \
+        long long expected_ = (long long)(expected);                                \
+        if (actual_ != expected_) {                                                 \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__,         \
+                    __LINE__, #actual, actual_, expected_);                         \
+            test_failures++;                                                        \
+        }                                                                           \
+    } while (0)
+
+#define RUN_TEST(test)                                                              \
+    do {                                                                            \
+        int before_ = test_failures;                                                \
+        test();                                                                     \
+        printf("%s %s\n", test_failures == before_ ? "PASS" : "FAIL", #test);      \
+    } while (0)
+
+/**
+ * @brief Creates a scratch directory and makes it the working directory
+ */
+static inline void test_begin(void) {
+    if (!mkdtemp(test_scratch) || chdir(test_scratch) != 0) {
+        fprintf(stderr, "Error: Cannot enter a scratch directory: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Deletes every file left in the scratch directory
+ */
+static inline void test_clear(void) {
+    DIR* directory = opendir(".");
+    if (!directory) return;
+
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            unlink(entry->d_name);
+        }
+    }
+    closedir(directory);
+}
+
+/**
+ * @brief Removes the scratch directory and returns the exit status
+ */
+static inline int test_end(void) {
+    test_clear();
+    if (chdir("/") == 0) rmdir(test_scratch);
+    return test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Reads a whole file into a malloc'd buffer
+ * @return Buffer (NUL-terminated, caller frees) or NULL
+ */
+static inline unsigned char* test_read_file(const char* path, size_t* length) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    unsigned char* data = NULL;
+    size_t size = 0, capacity = 0;
+    for (;;) {
+        if (size + 4096 + 1 > capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            unsigned char* grown = realloc(data, capacity);
+            if (!grown) {
+                free(data);
+                fclose(file);
+                return NULL;
+            }
+            data = grown;
+        }
+        size_t got = fread(data + size, 1, 4096, file);
+        size += got;
+        if (got == 0) break;
+    }
+    fclose(file);
+    data[size] = '\0';
+    *length = size;
+    return data;
+}
+
+/**
+ * @brief Writes length bytes to a new file
+ */
+static inline bool test_write_file(const char* path, const void* data, size_t length) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    bool ok = fwrite(data, 1, length, file) == length;
+    return fclose(file) == 0 && ok;
+}
+
+/**
+ * @brief Creates and loads a reservation system from the scratch directory
+ * @param durability Policy applied before the load, or NULL for the defaults
+ * @return System, or NULL if it could not be created or loaded
+ */
+static inline ReservationSystem* test_open_system(const ReservationDurability* durability) {
+    ReservationSystem* system = reservation_system_create();
+    if (!system) return NULL;
+    if (durability) reservation_system_set_durability(system, durability);
+    if (reservation_system_load(system) != RESERVATION_SUCCESS) {
+        reservation_system_destroy(system);
+        return NULL;
+    }
+    return system;
+}
+
+/**
+ * @brief Gets the size of the journal file, or -1 if there is none
+ */
+static inline off_t test_journal_size(void) {
+    struct stat info;
+    return stat(RESERVATION_JOURNAL_FILE, &info) == 0 ? info.st_size : -1;
+}
+
+/**
+ * @brief Gets the first name holding a seat, "" for a free seat, or "?"
+ *        if the seat cannot be read
+ * @param reservation Storage for the seat, which the result points into
+ */
+static inline const char* test_seat_holder(const ReservationSystem* system, int flight_id,
+                                           int seat, Reservation* reservation) {
+    if (reservation_flight_get(system, flight_id, seat, reservation) != RESERVATION_SUCCESS) {
+        return "?";
+    }
+    return reservation->is_reserved ? reservation->first_name : "";
+}
+
+static inline bool test_seat_held_by(const ReservationSystem* system, int flight_id, int seat,
+                                     const char* first_name, const char* last_name) {
+    Reservation reservation;
+    return reservation_flight_get(system, flight_id, seat, &reservation) ==
+               RESERVATION_SUCCESS &&
+           reservation.is_reserved && strcmp(reservation.first_name, first_name) == 0 &&
+           strcmp(reservation.last_name, last_name) == 0;
+}
+
+static inline bool test_seat_free(const ReservationSystem* system, int flight_id, int seat) {
+    Reservation reservation;
+    return strcmp(test_seat_holder(system, flight_id, seat, &reservation), "") == 0;
+}
+
+#endif /* TEST_UTIL_H */